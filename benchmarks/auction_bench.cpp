@@ -0,0 +1,54 @@
+#include <vector>
+
+#include "bench.h"
+#include "orderbook.h"
+
+using namespace exchange;
+
+// Orders arriving before the open, with buy and sell prices overlapping
+//     across a band of 20 ticks so that most of them cross
+const int OPENING_ORDERS = 2000;
+
+std::vector<Order> opening_orders() {
+    Client bob("bob");
+    Client alice("alice");
+
+    std::vector<Order> orders;
+    orders.reserve(OPENING_ORDERS);
+    for (int i = 0; i < OPENING_ORDERS; i++) {
+        double offset = ((i * 7919) % 20) * 0.01;
+        if (i % 2 == 0) {
+            orders.emplace_back("ABC", 99.95 + offset, 10 + i % 7, BUY, bob);
+        } else {
+            orders.emplace_back("ABC", 99.85 + offset, 10 + i % 5, SELL, alice);
+        }
+    }
+
+    return orders;
+}
+
+BENCHMARK(open_continuous_matching) {
+    for (long i = 0; i < iterations; i++) {
+        std::vector<Order> orders = opening_orders();
+        Orderbook ob("ABC");
+
+        for (auto& o : orders) {
+            ob.submit_order(o);
+        }
+        bench::do_not_optimize(ob.get_trades()->size());
+    }
+}
+
+BENCHMARK(open_call_auction_uncross) {
+    for (long i = 0; i < iterations; i++) {
+        std::vector<Order> orders = opening_orders();
+        Orderbook ob("ABC");
+
+        ob.start_auction();
+        for (auto& o : orders) {
+            ob.submit_order(o);
+        }
+        ob.uncross(CONTINUOUS);
+        bench::do_not_optimize(ob.get_trades()->size());
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <string>
+#include <vector>
+
+namespace bench {
+    // A benchmark body runs its operation the given number of times
+    typedef void (*BenchmarkFunction)(long iterations);
+
+    struct Benchmark {
+        std::string name;
+        BenchmarkFunction function;
+    };
+
+    std::vector<Benchmark>& registry();
+
+    // Time between the two isn't counted, for setup a benchmark has to
+    //     redo before every iteration
+    void pause_timing();
+    void resume_timing();
+
+    struct Registrar {
+        Registrar(const char* name, BenchmarkFunction function) {
+            registry().push_back({name, function});
+        }
+    };
+
+    // Stops the compiler from optimising away a value computed in a benchmark
+    template <typename T>
+    inline void do_not_optimize(T const& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+}
+
+#define BENCHMARK(name) \
+    static void name(long iterations); \
+    static bench::Registrar name##_registrar(#name, name); \
+    static void name(long iterations)
+
+#endif
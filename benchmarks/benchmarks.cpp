@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "bench.h"
+
+namespace bench {
+    std::vector<Benchmark>& registry() {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    static std::chrono::steady_clock::time_point paused_at;
+    static std::chrono::steady_clock::duration paused_for;
+
+    void pause_timing() {
+        paused_at = std::chrono::steady_clock::now();
+    }
+
+    void resume_timing() {
+        paused_for += std::chrono::steady_clock::now() - paused_at;
+    }
+}
+
+double time_iterations(bench::BenchmarkFunction function, long iterations) {
+    bench::paused_for = std::chrono::steady_clock::duration::zero();
+
+    auto start = std::chrono::steady_clock::now();
+    function(iterations);
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start - bench::paused_for).count();
+}
+
+int main(int argc, char **argv) {
+    /*
+     * Runs every registered benchmark, or only those whose name contains
+     * the first argument, and reports the time per iteration.
+     *
+     * Iterations are doubled until a run takes at least MIN_SECONDS, then
+     * the median of RUNS runs of that many is reported so one run disturbed
+     * by the rest of the machine doesn't skew it.
+     */
+    const double MIN_SECONDS = 0.5;
+    const int RUNS = 5;
+
+    const char* filter = (argc > 1) ? argv[1] : "";
+
+    for (auto& b : bench::registry()) {
+        if (std::strstr(b.name.c_str(), filter) == nullptr) {
+            continue;
+        }
+
+        long iterations = 1;
+        double elapsed = time_iterations(b.function, iterations);
+        while (elapsed < MIN_SECONDS) {
+            iterations *= 2;
+            elapsed = time_iterations(b.function, iterations);
+        }
+
+        std::vector<double> runs;
+        for (int r = 0; r < RUNS; r++) {
+            runs.push_back(time_iterations(b.function, iterations));
+        }
+        std::sort(runs.begin(), runs.end());
+        elapsed = runs[RUNS / 2];
+
+        std::cout << std::left << std::setw(48) << b.name
+                  << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+                  << (elapsed * 1e9 / iterations) << " ns/op"
+                  << std::setw(14) << iterations << " iterations"
+                  << std::endl;
+    }
+}
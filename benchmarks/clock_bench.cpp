@@ -0,0 +1,67 @@
+#include <chrono>
+
+#include "bench.h"
+#include "clock.h"
+#include "orderbook.h"
+
+using namespace exchange;
+
+// Each iteration reads the clock this many times through the Clock interface
+const int CLOCK_READS = 100;
+
+static void read_clock(long iterations, Clock& clock) {
+    for (long i = 0; i < iterations; i++) {
+        for (int j = 0; j < CLOCK_READS; j++) {
+            Timestamp now = clock.now();
+            bench::do_not_optimize(now);
+        }
+    }
+}
+
+BENCHMARK(clock_system_now) {
+    SystemClock clock;
+    read_clock(iterations, clock);
+}
+
+BENCHMARK(clock_tsc_now) {
+    TscClock clock;
+    read_clock(iterations, clock);
+}
+
+BENCHMARK(clock_cached_now) {
+    SystemClock source;
+    CachedClock clock(source);
+    read_clock(iterations, clock);
+}
+
+static void cross_orders(long iterations, Clock& clock) {
+    /*
+     * A resting order and an order that trades with it, which is where a
+     * book reads its clock: once for the order and its trades together.
+     */
+    Orderbook ob("ABC");
+    ob.set_clock(&clock);
+    Client alice("alice");
+    Client bob("bob");
+
+    for (long i = 0; i < iterations; i++) {
+        Order sell("ABC", 100.00, 10, SELL, alice);
+        Order buy("ABC", 100.00, 10, BUY, bob);
+        ob.submit_order(sell);
+        ob.submit_order(buy);
+
+        // Keep the trade list from growing across iterations
+        for (Trade* t : *ob.get_trades()) { delete t; }
+        ob.get_trades()->clear();
+    }
+}
+
+BENCHMARK(clock_book_system) {
+    SystemClock clock;
+    cross_orders(iterations, clock);
+}
+
+BENCHMARK(clock_book_virtual) {
+    VirtualClock clock;
+    cross_orders(iterations, clock);
+}
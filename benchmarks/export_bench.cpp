@@ -0,0 +1,60 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "trade.h"
+#include "trade_export.h"
+
+using namespace exchange;
+
+// Trades exported per iteration
+const int EXPORT_TRADES = 1000;
+
+static std::vector<Trade> export_bench_trades() {
+    Client alice("alice");
+    Client bob("bob");
+    Timestamp time(std::chrono::seconds(1540176957));
+
+    std::vector<Trade> trades;
+    trades.reserve(EXPORT_TRADES);
+    for (int i = 0; i < EXPORT_TRADES; i++) {
+        trades.emplace_back("ABC", 100.00 + (i % 7) * 0.01, 10 + i % 3, (i % 2 == 0) ? BUY : SELL,
+                            alice, bob, time + std::chrono::microseconds(i * 13));
+    }
+
+    return trades;
+}
+
+BENCHMARK(export_text_serialize) {
+    // What getting trades out cost before, a string per trade
+    std::vector<Trade> trades = export_bench_trades();
+
+    for (long i = 0; i < iterations; i++) {
+        size_t bytes = 0;
+        for (auto& t : trades) {
+            bytes += Trade::serialize(t).size();
+        }
+        bench::do_not_optimize(bytes);
+    }
+}
+
+BENCHMARK(export_columnar_on_trade) {
+    // The cost the exporter adds to the matching thread, the writer thread
+    //     encodes and writes the batches alongside
+    std::vector<Trade> trades = export_bench_trades();
+    std::string path = "/tmp/localtrader_export_bench.ltx";
+
+    TradeExporter exporter;
+    exporter.open(path, false);
+
+    for (long i = 0; i < iterations; i++) {
+        for (auto& t : trades) {
+            exporter.on_trade(t);
+        }
+    }
+
+    exporter.close();
+    std::remove(path.c_str());
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "book_side.h"
+#include "order.h"
+
+using namespace exchange;
+
+// Resting orders per side, the ticks between their levels in a dense and
+//     a sparse book, and the orders that sweep through them
+const int LADDER_RESTING_ORDERS = 1000;
+const int DENSE_LEVELS = 50;
+const int SPARSE_SPACING = 25;
+const int LADDER_TAKERS = 100;
+
+// Orders added and cancelled near the top of a standing book
+const int CHURN_ORDERS = 1000;
+
+static std::vector<Order> ladder_bench_orders(int spacing) {
+    /*
+     * Resting orders on both sides of 100.00, DENSE_LEVELS levels deep,
+     * with spacing ticks between levels, then takers sweeping a few levels
+     * of the other side.
+     */
+    Client bob("bob");
+
+    std::vector<Order> orders;
+    orders.reserve(2 * LADDER_RESTING_ORDERS + LADDER_TAKERS);
+    for (int i = 0; i < LADDER_RESTING_ORDERS; i++) {
+        int ticks = 1 + (i % DENSE_LEVELS) * spacing;
+        orders.emplace_back("ABC", (10000 - ticks) / 100.0, 10, BUY, bob);
+        orders.emplace_back("ABC", (10000 + ticks) / 100.0, 10, SELL, bob);
+    }
+
+    for (int i = 0; i < LADDER_TAKERS; i++) {
+        bool buy = (i % 2 == 0);
+        int reach = 1 + 5 * spacing;
+        orders.emplace_back("ABC", (10000 + (buy ? reach : -reach)) / 100.0, 150, buy ? BUY : SELL, bob);
+    }
+
+    return orders;
+}
+
+template <typename Side>
+static long sweep(Order& taker, Side& resting) {
+    double limit = Side::limit_of(taker);
+
+    long traded = 0;
+    while (taker.effective_size() > 0 && !resting.empty()) {
+        if (!Side::reaches(resting.best_price(), limit)) { break; }
+
+        int trade_size = std::min(taker.effective_size(), resting.best_order()->effective_size());
+        taker.fill(trade_size);
+        resting.fill_best(trade_size);
+
+        traded += trade_size;
+    }
+
+    return traded;
+}
+
+template <template <OrderSide> class Side>
+static void run_sweeps(long iterations, int spacing) {
+    // Build both sides and sweep through them, as a book does from empty
+    std::vector<Order> templates = ladder_bench_orders(spacing);
+    BookConfig config;
+
+    for (long i = 0; i < iterations; i++) {
+        std::vector<Order> orders = templates;
+        Side<BUY> bids(config);
+        Side<SELL> asks(config);
+
+        for (int j = 0; j < 2 * LADDER_RESTING_ORDERS; j++) {
+            if (orders[j].is_buy()) {
+                bids.add(orders[j]);
+            } else {
+                asks.add(orders[j]);
+            }
+        }
+
+        long traded = 0;
+        for (size_t j = 2 * LADDER_RESTING_ORDERS; j < orders.size(); j++) {
+            if (orders[j].is_buy()) {
+                traded += sweep(orders[j], asks);
+            } else {
+                traded += sweep(orders[j], bids);
+            }
+        }
+        bench::do_not_optimize(traded);
+    }
+}
+
+template <template <OrderSide> class Side>
+static void run_churn(long iterations, int spacing) {
+    /*
+     * A standing book with orders added and cancelled at random levels near
+     * its top, and the top read after each, which is what a busy book does
+     * most of the time.
+     */
+    std::vector<Order> resting = ladder_bench_orders(spacing);
+    resting.erase(resting.begin() + 2 * LADDER_RESTING_ORDERS, resting.end());
+    BookConfig config;
+
+    Side<BUY> bids(config);
+    Side<SELL> asks(config);
+    for (auto& o : resting) {
+        if (o.is_buy()) {
+            bids.add(o);
+        } else {
+            asks.add(o);
+        }
+    }
+
+    Client bob("bob");
+    std::mt19937 random(11);
+    std::uniform_int_distribution<int> level(0, 9);
+
+    std::vector<Order> templates;
+    templates.reserve(CHURN_ORDERS);
+    for (int i = 0; i < CHURN_ORDERS; i++) {
+        int ticks = 1 + level(random) * spacing;
+        templates.emplace_back("ABC", (10000 - ticks) / 100.0, 5, BUY, bob);
+    }
+
+    for (long i = 0; i < iterations; i++) {
+        std::vector<Order> orders = templates;
+
+        double best = 0.0;
+        for (auto& o : orders) {
+            bids.add(o);
+            best += bids.best_price();
+        }
+
+        int quantity;
+        for (auto& o : orders) {
+            bids.remove(o, &quantity);
+            best += bids.best_price();
+        }
+        bench::do_not_optimize(best);
+    }
+}
+
+BENCHMARK(ladder_dense_sweep_tree) { run_sweeps<TreeSide>(iterations, 1); }
+BENCHMARK(ladder_dense_sweep_ladder) { run_sweeps<LadderSide>(iterations, 1); }
+BENCHMARK(ladder_sparse_sweep_tree) { run_sweeps<TreeSide>(iterations, SPARSE_SPACING); }
+BENCHMARK(ladder_sparse_sweep_ladder) { run_sweeps<LadderSide>(iterations, SPARSE_SPACING); }
+
+BENCHMARK(ladder_dense_churn_tree) { run_churn<TreeSide>(iterations, 1); }
+BENCHMARK(ladder_dense_churn_ladder) { run_churn<LadderSide>(iterations, 1); }
+BENCHMARK(ladder_sparse_churn_tree) { run_churn<TreeSide>(iterations, SPARSE_SPACING); }
+BENCHMARK(ladder_sparse_churn_ladder) { run_churn<LadderSide>(iterations, SPARSE_SPACING); }
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "exchange.h"
+#include "orderbook.h"
+#include "risk.h"
+
+using namespace exchange;
+
+const int CLIENTS = 100;
+
+RiskLimits bench_limits() {
+    RiskLimits limits;
+    limits.max_order_size = 1000;
+    limits.price_band = 0.1;
+    limits.max_open_quantity = 1000000000;
+    limits.max_position = 1000000000;
+    limits.max_messages_per_second = 1000000000;
+
+    return limits;
+}
+
+std::vector<Order*> bench_orders(TimeInForce tif) {
+    std::vector<Order*> orders;
+    for (int i = 0; i < CLIENTS; i++) {
+        Client c("client" + std::to_string(i));
+        Order* o = new Order("ABC", 100.00 + (i % 5), 10, (i % 2 == 0) ? BUY : SELL, c);
+        o->set_time_in_force(tif);
+        orders.push_back(o);
+    }
+
+    return orders;
+}
+
+BENCHMARK(risk_check) {
+    RiskChecker risk(bench_limits());
+    std::vector<Order*> orders = bench_orders(GTC);
+    Timestamp now = std::chrono::high_resolution_clock::now();
+
+    for (long i = 0; i < iterations; i++) {
+        Order* o = orders[i % CLIENTS];
+        RiskResult result = risk.check(*o, 99.00, 101.00, now);
+        bench::do_not_optimize(result);
+
+        // Release the quantity again so the counters stay bounded
+        risk.on_order_closed(*o);
+    }
+}
+
+BENCHMARK(risk_check_with_fill_update) {
+    RiskChecker risk(bench_limits());
+    std::vector<Order*> orders = bench_orders(GTC);
+    Timestamp now = std::chrono::high_resolution_clock::now();
+
+    Client maker("maker");
+    Trade t("ABC", 100.00, 10, BUY, maker, orders[0]->get_client());
+
+    for (long i = 0; i < iterations; i++) {
+        Order* o = orders[i % CLIENTS];
+        RiskResult result = risk.check(*o, 99.00, 101.00, now);
+        bench::do_not_optimize(result);
+
+        risk.on_trade(t);
+    }
+}
+
+// IOC orders into an empty book exercise the order path without the book
+//     growing, so these two measure the cost the risk stage adds
+BENCHMARK(order_path_orderbook) {
+    Orderbook ob("ABC");
+    std::vector<Order*> orders = bench_orders(IOC);
+
+    for (long i = 0; i < iterations; i++) {
+        bool accepted = ob.submit_order(*orders[i % CLIENTS]);
+        bench::do_not_optimize(accepted);
+    }
+}
+
+BENCHMARK(order_path_exchange_with_risk) {
+    Exchange e;
+    e.add_instrument("ABC");
+    e.get_risk().set_limits(bench_limits());
+    std::vector<Order*> orders = bench_orders(IOC);
+
+    for (long i = 0; i < iterations; i++) {
+        bool accepted = e.submit_order(*orders[i % CLIENTS]);
+        bench::do_not_optimize(accepted);
+    }
+}
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "bench.h"
+#include "book_side.h"
+#include "order.h"
+
+using namespace exchange;
+
+// Resting orders per side, spread over 50 price levels, and the orders
+//     that sweep through them from alternating sides
+const int RESTING_ORDERS = 1000;
+const int TAKERS = 100;
+
+// One side of the book as it was before it was specialised: resting orders
+//     in arrival order, searched for the best with Order::operator< before
+//     every fill, and the quantity at each price in a map of its own
+template <typename Compare>
+struct LegacySide {
+    std::vector<Order*> orders;
+    std::map<double, int, Compare> levels;
+
+    void add(Order& o) {
+        orders.push_back(&o);
+        levels[o.get_price()] += o.effective_size();
+    }
+
+    bool crossed_by(Order& taker) const {
+        if (levels.empty()) { return false; }
+        return taker.is_market() || !Compare()(taker.get_price(), levels.begin()->first);
+    }
+
+    Order* best() const {
+        Order* best = nullptr;
+        for (auto o : orders) {
+            if (best == nullptr || *o < *best) {
+                best = o;
+            }
+        }
+
+        return best;
+    }
+
+    void reduce_level(double price, int size) {
+        auto level = levels.find(price);
+        if (level == levels.end()) { return; }
+
+        level->second -= size;
+        if (level->second <= 0) { levels.erase(level); }
+    }
+};
+
+template <typename Compare>
+long match_legacy(Order& taker, LegacySide<Compare>& resting) {
+    long traded = 0;
+    while (taker.effective_size() > 0 && resting.crossed_by(taker)) {
+        Order* maker = resting.best();
+        int trade_size = std::min(taker.effective_size(), maker->effective_size());
+
+        taker.fill(trade_size);
+        maker->fill(trade_size);
+        resting.reduce_level(maker->get_price(), trade_size);
+
+        if (maker->get_status() == FILLED) {
+            resting.orders.erase(std::find(resting.orders.begin(), resting.orders.end(), maker));
+        }
+
+        traded += trade_size;
+    }
+
+    return traded;
+}
+
+template <OrderSide S>
+long match_templated(Order& taker, BookSide<S>& resting) {
+    double limit = BookSide<S>::limit_of(taker);
+
+    long traded = 0;
+    while (taker.effective_size() > 0 && !resting.empty()) {
+        if (!BookSide<S>::reaches(resting.best_price(), limit)) { break; }
+
+        int trade_size = std::min(taker.effective_size(), resting.best_order()->effective_size());
+
+        taker.fill(trade_size);
+        resting.fill_best(trade_size);
+
+        traded += trade_size;
+    }
+
+    return traded;
+}
+
+std::vector<Order> side_bench_orders() {
+    Client bob("bob");
+
+    std::vector<Order> orders;
+    orders.reserve(2 * RESTING_ORDERS + TAKERS);
+    for (int i = 0; i < RESTING_ORDERS; i++) {
+        orders.emplace_back("ABC", 99.99 - (i % 50) * 0.01, 10, BUY, bob);
+        orders.emplace_back("ABC", 100.01 + (i % 50) * 0.01, 10, SELL, bob);
+    }
+
+    // Each taker sweeps a few levels of the other side
+    for (int i = 0; i < TAKERS; i++) {
+        bool buy = (i % 2 == 0);
+        orders.emplace_back("ABC", buy ? 100.05 : 99.95, 150, buy ? BUY : SELL, bob);
+    }
+
+    return orders;
+}
+
+// Both benchmarks time the takers' matching only. Each round starts from
+//     fresh copies of the orders on a freshly built book, untimed.
+
+BENCHMARK(side_match_legacy) {
+    std::vector<Order> templates = side_bench_orders();
+
+    for (long i = 0; i < iterations; i++) {
+        bench::pause_timing();
+        std::vector<Order> orders = templates;
+        LegacySide<std::greater<double>> bids;
+        LegacySide<std::less<double>> asks;
+
+        for (int j = 0; j < 2 * RESTING_ORDERS; j++) {
+            if (orders[j].is_buy()) {
+                bids.add(orders[j]);
+            } else {
+                asks.add(orders[j]);
+            }
+        }
+        bench::resume_timing();
+
+        long traded = 0;
+        for (size_t j = 2 * RESTING_ORDERS; j < orders.size(); j++) {
+            if (orders[j].is_buy()) {
+                traded += match_legacy(orders[j], asks);
+            } else {
+                traded += match_legacy(orders[j], bids);
+            }
+        }
+        bench::do_not_optimize(traded);
+    }
+}
+
+BENCHMARK(side_match_templated) {
+    std::vector<Order> templates = side_bench_orders();
+
+    for (long i = 0; i < iterations; i++) {
+        bench::pause_timing();
+        std::vector<Order> orders = templates;
+        BookSide<BUY> bids;
+        BookSide<SELL> asks;
+
+        for (int j = 0; j < 2 * RESTING_ORDERS; j++) {
+            if (orders[j].is_buy()) {
+                bids.add(orders[j]);
+            } else {
+                asks.add(orders[j]);
+            }
+        }
+        bench::resume_timing();
+
+        long traded = 0;
+        for (size_t j = 2 * RESTING_ORDERS; j < orders.size(); j++) {
+            if (orders[j].is_buy()) {
+                traded += match_templated(orders[j], asks);
+            } else {
+                traded += match_templated(orders[j], bids);
+            }
+        }
+        bench::do_not_optimize(traded);
+    }
+}
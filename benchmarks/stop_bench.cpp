@@ -0,0 +1,39 @@
+#include <vector>
+
+#include "bench.h"
+#include "orderbook.h"
+
+using namespace exchange;
+
+// Sell stops one tick apart under a ladder of bids, so one trade at the
+//     top starts a cascade that triggers every stop in turn
+void stop_cascade(long iterations, int stop_count) {
+    Client bob("bob");
+    Client alice("alice");
+
+    for (long i = 0; i < iterations; i++) {
+        std::vector<Order> orders;
+        orders.reserve(2 * stop_count + 1);
+        for (int j = 0; j < stop_count; j++) {
+            orders.emplace_back("ABC", 1000.00 - j * 0.01, 5, BUY, alice);
+            orders.emplace_back("ABC", 0.00, 5, SELL, bob);
+            orders.back().set_type(MARKET);
+            orders.back().set_stop_price(1000.00 - j * 0.01);
+        }
+        orders.emplace_back("ABC", 1000.00, 5, SELL, alice);
+
+        Orderbook ob("ABC");
+        for (auto& o : orders) {
+            ob.submit_order(o);
+        }
+        bench::do_not_optimize(ob.get_trades()->size());
+    }
+}
+
+BENCHMARK(stop_cascade_1000) {
+    stop_cascade(iterations, 1000);
+}
+
+BENCHMARK(stop_cascade_10000) {
+    stop_cascade(iterations, 10000);
+}
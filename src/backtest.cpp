@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "backtest.h"
+#include "trade_export.h"
+
+struct backtest_config {
+    std::string recording;
+
+    // Defaults to one thread per core
+    size_t threads = 0;
+
+    // The merged trade tape as text, one trade message per line
+    std::string tape_file;
+
+    // The merged trade tape in the columnar export format
+    std::string export_file;
+
+    exchange::BookConfig book;
+
+    // Print every instrument rather than just the totals
+    bool by_instrument = false;
+};
+
+bool parse_option(const std::string& arg, const std::string& name, std::string& value) {
+    /*
+     * Matches command line arguments of the form --name=value.
+     */
+    std::string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+bool parse_layout(const std::string& value, exchange::BookLayout& layout) {
+    if (value == "tree") {
+        layout = exchange::TREE_LAYOUT;
+    } else if (value == "ladder") {
+        layout = exchange::LADDER_LAYOUT;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void print_stats(const exchange::InstrumentStats& s) {
+    std::cout << std::left << std::setw(12) << s.instrument << std::right
+              << std::setw(12) << s.orders << std::setw(10) << s.rejected
+              << std::setw(10) << s.cancels << std::setw(12) << s.trades
+              << std::setw(14) << s.volume << std::fixed << std::setprecision(4)
+              << std::setw(12) << s.get_vwap() << std::setw(12) << s.high
+              << std::setw(12) << s.low << std::setw(12) << s.last << std::endl;
+}
+
+bool write_tape(const exchange::Backtest& backtest, const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Failed to open tape file " << path << std::endl;
+        return false;
+    }
+
+    for (auto& entry : backtest.get_tape()) {
+        file << exchange::Trade::serialize(*entry.trade) << '\n';
+    }
+
+    return true;
+}
+
+bool write_export(const exchange::Backtest& backtest, const std::string& path) {
+    exchange::TradeExporter exporter;
+    if (!exporter.open(path, false)) {
+        return false;
+    }
+
+    for (auto& entry : backtest.get_tape()) {
+        exporter.on_trade(*entry.trade);
+    }
+
+    exporter.close();
+    return true;
+}
+
+int main(int argc, char** argv) {
+    backtest_config config;
+    config.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int a = 1; a < argc; a++) {
+        std::string arg(argv[a]);
+        std::string value;
+
+        if (parse_option(arg, "threads", value)) {
+            config.threads = std::max(1, std::stoi(value));
+        } else if (parse_option(arg, "tape", value)) {
+            config.tape_file = value;
+        } else if (parse_option(arg, "export-file", value)) {
+            config.export_file = value;
+        } else if (parse_option(arg, "book-layout", value) && parse_layout(value, config.book.layout)) {
+            continue;
+        } else if (parse_option(arg, "ticks-per-unit", value)) {
+            config.book.ticks_per_unit = std::max(1L, std::stol(value));
+        } else if (arg == "--by-instrument") {
+            config.by_instrument = true;
+        } else if (arg.compare(0, 2, "--") != 0 && config.recording.empty()) {
+            config.recording = arg;
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (config.recording.empty()) {
+        std::cerr << "Usage: backtest <recording> [--threads=<n>] [--tape=<file>] [--export-file=<file>]"
+                  << " [--book-layout=tree|ladder] [--ticks-per-unit=<n>] [--by-instrument]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream recording(config.recording);
+    if (!recording) {
+        std::cerr << "Failed to open recording " << config.recording << std::endl;
+        return 1;
+    }
+
+    exchange::Backtest backtest(config.book);
+
+    auto start = std::chrono::steady_clock::now();
+    backtest.load(recording);
+
+    std::cout << "Loaded " << backtest.get_event_count() << " events for "
+              << backtest.get_instrument_count() << " instruments, skipping "
+              << backtest.get_skipped_count() << " lines, in " << std::fixed << std::setprecision(1)
+              << elapsed_ms(start) << " ms" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    backtest.run(config.threads);
+    double run_ms = elapsed_ms(start);
+
+    std::cout << "Replayed on " << config.threads << " threads in " << run_ms << " ms ("
+              << std::setprecision(0) << backtest.get_event_count() / std::max(run_ms, 1e-3) * 1000
+              << " events/s, " << backtest.get_steals() << " instruments stolen)" << std::endl;
+
+    exchange::InstrumentStats total;
+    total.instrument = "total";
+    for (auto& s : backtest.get_stats()) {
+        total.orders += s.orders;
+        total.rejected += s.rejected;
+        total.cancels += s.cancels;
+        total.trades += s.trades;
+        total.volume += s.volume;
+        total.notional += s.notional;
+    }
+
+    std::cout << std::endl << std::left << std::setw(12) << "instrument" << std::right
+              << std::setw(12) << "orders" << std::setw(10) << "rejected" << std::setw(10) << "cancels"
+              << std::setw(12) << "trades" << std::setw(14) << "volume" << std::setw(12) << "vwap"
+              << std::setw(12) << "high" << std::setw(12) << "low" << std::setw(12) << "last" << std::endl;
+
+    if (config.by_instrument) {
+        for (auto& s : backtest.get_stats()) {
+            print_stats(s);
+        }
+    }
+    print_stats(total);
+
+    if (!config.tape_file.empty() && !write_tape(backtest, config.tape_file)) {
+        return 1;
+    }
+
+    if (!config.export_file.empty() && !write_export(backtest, config.export_file)) {
+        return 1;
+    }
+}
@@ -0,0 +1,116 @@
+#include <cmath>
+
+#include "book_mirror.h"
+
+namespace exchange {
+    static long long to_ticks(double price) {
+        return std::llround(price * MD_PRICE_SCALE);
+    }
+
+    static double to_price(long long ticks) {
+        return ticks / MD_PRICE_SCALE;
+    }
+
+    void BookMirror::apply(const MdMessage& m) {
+        if (m.type == MD_TRADE) {
+            books[m.instrument].last_price = m.price;
+            return;
+        }
+
+        if (m.type != MD_LEVEL) {
+            return;
+        }
+
+        MirroredBook& book = books[m.instrument];
+        long long ticks = to_ticks(m.price);
+
+        if (m.side == BUY) {
+            if (m.quantity == 0) {
+                book.bids.erase(ticks);
+            } else {
+                book.bids[ticks] = m.quantity;
+            }
+        } else {
+            if (m.quantity == 0) {
+                book.asks.erase(ticks);
+            } else {
+                book.asks[ticks] = m.quantity;
+            }
+        }
+    }
+
+    const BookMirror::MirroredBook* BookMirror::find(const std::string& instrument) const {
+        auto it = books.find(instrument);
+        return it == books.end() ? nullptr : &it->second;
+    }
+
+    double BookMirror::get_best_bid(const std::string& instrument) const {
+        const MirroredBook* book = find(instrument);
+        if (book == nullptr || book->bids.empty()) { return 0.0; }
+
+        return to_price(book->bids.begin()->first);
+    }
+
+    double BookMirror::get_best_offer(const std::string& instrument) const {
+        const MirroredBook* book = find(instrument);
+        if (book == nullptr || book->asks.empty()) { return 0.0; }
+
+        return to_price(book->asks.begin()->first);
+    }
+
+    int BookMirror::get_quantity_at(const std::string& instrument, OrderSide side, double price) const {
+        const MirroredBook* book = find(instrument);
+        if (book == nullptr) { return 0; }
+
+        long long ticks = to_ticks(price);
+        if (side == BUY) {
+            auto it = book->bids.find(ticks);
+            return it == book->bids.end() ? 0 : it->second;
+        }
+
+        auto it = book->asks.find(ticks);
+        return it == book->asks.end() ? 0 : it->second;
+    }
+
+    size_t BookMirror::get_depth(const std::string& instrument, OrderSide side, size_t count,
+                                 std::vector<std::pair<double, int>>& out) const {
+        /*
+         * Returns the number of levels added to out, best price first.
+         */
+        const MirroredBook* book = find(instrument);
+        if (book == nullptr) { return 0; }
+
+        size_t added = 0;
+        if (side == BUY) {
+            for (auto it = book->bids.begin(); it != book->bids.end() && added < count; ++it, added++) {
+                out.emplace_back(to_price(it->first), it->second);
+            }
+        } else {
+            for (auto it = book->asks.begin(); it != book->asks.end() && added < count; ++it, added++) {
+                out.emplace_back(to_price(it->first), it->second);
+            }
+        }
+
+        return added;
+    }
+
+    double BookMirror::get_last_price(const std::string& instrument) const {
+        const MirroredBook* book = find(instrument);
+        return book == nullptr ? 0.0 : book->last_price;
+    }
+
+    bool MarketDataClient::open(const std::string& group, uint16_t port, const std::string& interface,
+                                const std::string& publisher_address, uint16_t request_port) {
+        return subscriber.open(group, port, interface, publisher_address, request_port);
+    }
+
+    void MarketDataClient::handle(const MdMessage& m) {
+        mirror.apply(m);
+
+        if (m.type == MD_LEVEL) {
+            listener.on_level(m.instrument, m.side, m.price, m.quantity);
+        } else if (m.type == MD_TRADE) {
+            listener.on_trade(m.instrument, m.side, m.price, m.quantity);
+        }
+    }
+}
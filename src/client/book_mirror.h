@@ -0,0 +1,97 @@
+#ifndef BOOK_MIRROR_H
+#define BOOK_MIRROR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "md_feed.h"
+#include "order.h"
+
+namespace exchange {
+    class BookMirror {
+        /*
+         * A local copy of the price levels of every instrument on the UDP
+         * market data feed, built from its level messages.
+         *
+         * The feed only carries changes, so the mirror is complete for
+         * levels that changed since it started listening. Started along
+         * with the exchange it matches the exchange's books exactly.
+         */
+        public:
+            void apply(const MdMessage& m);
+
+            // Zero when the side is empty
+            double get_best_bid(const std::string& instrument) const;
+            double get_best_offer(const std::string& instrument) const;
+
+            int get_quantity_at(const std::string& instrument, OrderSide side, double price) const;
+
+            // The best count levels of a side as price and quantity
+            size_t get_depth(const std::string& instrument, OrderSide side, size_t count,
+                             std::vector<std::pair<double, int>>& out) const;
+
+            double get_last_price(const std::string& instrument) const;
+        private:
+            struct MirroredBook {
+                // Keyed by price in ticks of 1 / MD_PRICE_SCALE, so prices
+                //     from the feed are compared exactly
+                std::map<long long, int, std::greater<long long>> bids;
+                std::map<long long, int> asks;
+
+                double last_price = 0.0;
+            };
+
+            const MirroredBook* find(const std::string& instrument) const;
+
+            std::unordered_map<std::string, MirroredBook> books;
+    };
+
+    class MarketDataListener {
+        /*
+         * Receives the feed as MarketDataClient applies it to its mirror.
+         */
+        public:
+            virtual ~MarketDataListener() {}
+
+            // Called once the mirror has the new quantity at the level
+            virtual void on_level(const std::string& /* instrument */, OrderSide /* side */,
+                                  double /* price */, int /* quantity */) {}
+
+            // side is the side of the taker
+            virtual void on_trade(const std::string& /* instrument */, OrderSide /* side */,
+                                  double /* price */, int /* quantity */) {}
+    };
+
+    class MarketDataClient {
+        /*
+         * Follows the UDP feed, recovering gaps through the publisher's
+         * retransmission port, and keeps a BookMirror of it up to date.
+         */
+        public:
+            MarketDataClient(MarketDataListener& listener)
+                : listener(listener), subscriber([this](const MdMessage& m) { handle(m); }) {}
+
+            bool open(const std::string& group, uint16_t port, const std::string& interface,
+                      const std::string& publisher_address, uint16_t request_port);
+
+            // Handle everything that has arrived, returning the packets received
+            int poll() { return subscriber.poll(); }
+
+            const BookMirror& get_mirror() const { return mirror; }
+            long get_lost() const { return subscriber.get_lost(); }
+        private:
+            void handle(const MdMessage& m);
+
+            MarketDataListener& listener;
+            BookMirror mirror;
+            MdSubscriber subscriber;
+    };
+}
+
+#endif
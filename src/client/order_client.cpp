@@ -0,0 +1,264 @@
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "order_client.h"
+
+namespace exchange {
+    static bool set_nonblocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    static bool starts_with(const std::string& payload, const char* prefix) {
+        return payload.compare(0, std::strlen(prefix), prefix) == 0;
+    }
+
+    OrderClient::~OrderClient() {
+        disconnect();
+    }
+
+    bool OrderClient::connect(const std::string& address, uint16_t port) {
+        sockaddr_in remote;
+        std::memset(&remote, 0, sizeof(remote));
+        remote.sin_family = AF_INET;
+        remote.sin_port = htons(port);
+
+        if (inet_pton(AF_INET, address.c_str(), &remote.sin_addr) != 1) {
+            std::cerr << "Invalid exchange address " << address << std::endl;
+            return false;
+        }
+
+        disconnect();
+
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0 || ::connect(fd, (sockaddr*) &remote, sizeof(remote)) < 0) {
+            std::cerr << "Failed to connect to exchange: " << strerror(errno) << std::endl;
+            disconnect();
+            return false;
+        }
+
+        // Orders are small and latency sensitive
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        set_nonblocking(fd);
+        return true;
+    }
+
+    void OrderClient::disconnect() {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+
+        // Nothing sent on the old connection will be replied to
+        decoder = FrameDecoder();
+        write_buffer.clear();
+        waiting.clear();
+        order_ids.clear();
+        client_order_ids.clear();
+        cancel_on_ack.clear();
+    }
+
+    uint64_t OrderClient::submit(const Order& o) {
+        if (!is_connected()) {
+            return 0;
+        }
+
+        uint64_t client_order_id = next_client_order_id++;
+        send(Order::serialize(o));
+        waiting.push_back({ORDER_REQUEST, client_order_id, ""});
+
+        return client_order_id;
+    }
+
+    bool OrderClient::cancel(uint64_t client_order_id) {
+        /*
+         * Cancel an order by its client order ID. Returns false when the
+         * order isn't known to be live.
+         */
+        if (!is_connected()) {
+            return false;
+        }
+
+        auto it = order_ids.find(client_order_id);
+        if (it != order_ids.end()) {
+            send("c|" + std::to_string(it->second));
+            waiting.push_back({CANCEL_REQUEST, client_order_id, ""});
+            return true;
+        }
+
+        // Still waiting for its ACK, so cancel it once that arrives
+        for (auto& r : waiting) {
+            if (r.kind == ORDER_REQUEST && r.client_order_id == client_order_id) {
+                cancel_on_ack.insert(client_order_id);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool OrderClient::query(const std::string& message) {
+        if (!is_connected()) {
+            return false;
+        }
+
+        send(message);
+        waiting.push_back({QUERY_REQUEST, 0, message});
+
+        return true;
+    }
+
+    uint64_t OrderClient::get_order_id(uint64_t client_order_id) const {
+        auto it = order_ids.find(client_order_id);
+        return it == order_ids.end() ? 0 : it->second;
+    }
+
+    void OrderClient::send(const std::string& payload) {
+        write_buffer += encode_frame(payload);
+    }
+
+    bool OrderClient::flush() {
+        /*
+         * Write as much of what is queued as the socket takes. Returns
+         * false when the connection has failed.
+         */
+        size_t sent = 0;
+        while (fd >= 0 && sent < write_buffer.size()) {
+            ssize_t written = ::send(fd, write_buffer.data() + sent, write_buffer.size() - sent, MSG_NOSIGNAL);
+
+            if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+
+            if (written <= 0) {
+                disconnect();
+                listener.on_disconnect();
+                return false;
+            }
+
+            sent += written;
+        }
+
+        write_buffer.erase(0, sent);
+        return is_connected();
+    }
+
+    size_t OrderClient::poll() {
+        if (!flush()) {
+            return 0;
+        }
+
+        size_t handled = 0;
+        char data[16384];
+        std::string payload;
+
+        for (;;) {
+            ssize_t received = read(fd, data, sizeof(data));
+
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+
+            if (received <= 0 || !decoder.append(data, received)) {
+                // The exchange has gone or sent something unreadable
+                disconnect();
+                listener.on_disconnect();
+                return handled;
+            }
+
+            while (decoder.next(payload)) {
+                handle(payload);
+                handled++;
+            }
+        }
+
+        // Cancels held back for an ACK go out straight away
+        flush();
+        return handled;
+    }
+
+    void OrderClient::handle(const std::string& payload) {
+        // Fills aren't replies, every other message answers the oldest
+        //     message still waiting
+        if (starts_with(payload, "f|")) {
+            handle_fill(payload);
+            return;
+        }
+
+        if (waiting.empty()) {
+            return;
+        }
+
+        Request r = waiting.front();
+        waiting.pop_front();
+
+        if (r.kind == QUERY_REQUEST) {
+            listener.on_reply(r.query, payload);
+        } else if (r.kind == CANCEL_REQUEST) {
+            // Either way the order can no longer fill
+            forget(r.client_order_id);
+            listener.on_cancel(r.client_order_id, payload.back() == 'A');
+        } else if (starts_with(payload, "ACK|") && std::isdigit((unsigned char) payload[4])) {
+            uint64_t order_id = std::strtoull(payload.c_str() + 4, nullptr, 10);
+            order_ids[r.client_order_id] = order_id;
+            client_order_ids[order_id] = r.client_order_id;
+
+            listener.on_ack(r.client_order_id, order_id);
+
+            if (cancel_on_ack.erase(r.client_order_id) > 0) {
+                cancel(r.client_order_id);
+            }
+        } else {
+            // Anything but an ACK with an order ID, including REJ|PARSE for
+            //     an order the exchange couldn't read
+            cancel_on_ack.erase(r.client_order_id);
+            listener.on_reject(r.client_order_id, starts_with(payload, "REJ|") ? payload.substr(4) : payload);
+        }
+    }
+
+    void OrderClient::handle_fill(const std::string& payload) {
+        // f|id|price|size|remaining
+        std::stringstream ss(payload.substr(2));
+        uint64_t order_id;
+        double price;
+        int size, remaining;
+        char sep;
+
+        if (!(ss >> order_id >> sep >> price >> sep >> size >> sep >> remaining)) {
+            return;
+        }
+
+        auto it = client_order_ids.find(order_id);
+        if (it == client_order_ids.end()) {
+            return;
+        }
+
+        uint64_t client_order_id = it->second;
+        if (remaining == 0) {
+            forget(client_order_id);
+        }
+
+        listener.on_fill(client_order_id, price, size, remaining);
+    }
+
+    void OrderClient::forget(uint64_t client_order_id) {
+        auto it = order_ids.find(client_order_id);
+        if (it != order_ids.end()) {
+            client_order_ids.erase(it->second);
+            order_ids.erase(it);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef ORDER_CLIENT_H
+#define ORDER_CLIENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "order.h"
+#include "tcp_gateway.h"
+
+namespace exchange {
+    class OrderClientListener {
+        /*
+         * Receives what the exchange sends back to an OrderClient. Called
+         * from OrderClient::poll on whichever thread polls it.
+         *
+         * Orders are identified by the client order ID submit returned,
+         * whether or not the exchange has acknowledged them yet.
+         */
+        public:
+            virtual ~OrderClientListener() {}
+
+            virtual void on_ack(uint64_t /* client_order_id */, uint64_t /* order_id */) {}
+            virtual void on_reject(uint64_t /* client_order_id */, const std::string& /* reason */) {}
+
+            // Called for every fill of an order, remaining is what is still
+            //     unfilled, so zero means the order is done
+            virtual void on_fill(uint64_t /* client_order_id */, double /* price */, int /* size */,
+                                 int /* remaining */) {}
+
+            virtual void on_cancel(uint64_t /* client_order_id */, bool /* accepted */) {}
+
+            // Called with the reply to each query, e.g. bbbo or st|ABC
+            virtual void on_reply(const std::string& /* query */, const std::string& /* reply */) {}
+
+            virtual void on_disconnect() {}
+    };
+
+    class OrderClient {
+        /*
+         * An order entry session over the exchange's TCP framing that lets
+         * any number of orders be outstanding at once.
+         *
+         * The exchange replies to a session's messages in the order they
+         * were sent, so each reply is matched to the oldest message still
+         * waiting for one. Orders are given client order IDs when they are
+         * submitted and the exchange's order ID is mapped back to them once
+         * it is known, so fills and cancels are reported against the
+         * client order ID. An order cancelled before its ACK arrives is
+         * cancelled as soon as it does.
+         *
+         * Messages are queued and written by flush or poll, so a burst of
+         * orders goes out in as few writes as possible. Nothing blocks.
+         */
+        public:
+            OrderClient(OrderClientListener& listener) : listener(listener) {}
+            ~OrderClient();
+
+            OrderClient(const OrderClient&) = delete;
+            OrderClient& operator =(const OrderClient&) = delete;
+
+            bool connect(const std::string& address, uint16_t port);
+            void disconnect();
+            bool is_connected() const { return fd >= 0; }
+
+            // Returns the client order ID, or 0 when not connected
+            uint64_t submit(const Order& o);
+
+            bool cancel(uint64_t client_order_id);
+            bool query(const std::string& message);
+
+            bool flush();
+
+            // Write what is queued and handle everything that has arrived,
+            //     returning the number of messages handled
+            size_t poll();
+
+            // Messages sent that haven't been replied to yet
+            size_t get_outstanding() const { return waiting.size(); }
+
+            // The exchange's ID for an order, or 0 until it is acknowledged
+            uint64_t get_order_id(uint64_t client_order_id) const;
+        private:
+            enum RequestKind {
+                ORDER_REQUEST,
+                CANCEL_REQUEST,
+                QUERY_REQUEST
+            };
+
+            struct Request {
+                RequestKind kind;
+                uint64_t client_order_id;
+                std::string query;
+            };
+
+            void send(const std::string& payload);
+            void handle(const std::string& payload);
+            void handle_fill(const std::string& payload);
+            void forget(uint64_t client_order_id);
+
+            OrderClientListener& listener;
+
+            int fd = -1;
+            FrameDecoder decoder;
+            std::string write_buffer;
+
+            std::deque<Request> waiting;
+            uint64_t next_client_order_id = 1;
+
+            // Between client order IDs and the exchange's IDs for orders
+            //     that can still fill
+            std::unordered_map<uint64_t, uint64_t> order_ids;
+            std::unordered_map<uint64_t, uint64_t> client_order_ids;
+            std::unordered_set<uint64_t> cancel_on_ack;
+    };
+}
+
+#endif
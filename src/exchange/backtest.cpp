@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <utility>
+
+#include "backtest.h"
+#include "clock.h"
+#include "listener.h"
+#include "orderbook.h"
+#include "thread_pool.h"
+
+namespace exchange {
+    class ReplayListener : public BookListener {
+        /*
+         * Records the trades of a partition's book against the event being
+         * replayed and notes the orders that are finished with.
+         */
+        public:
+            ReplayListener(InstrumentStats& stats, std::vector<uint64_t>& trade_events)
+                : stats(stats), trade_events(trade_events) {}
+
+            void on_trade(const Trade& t) override {
+                trade_events.push_back(event);
+
+                double price = t.get_price();
+                stats.trades++;
+                stats.volume += t.get_size();
+                stats.notional += price * t.get_size();
+                stats.high = (stats.trades == 1) ? price : std::max(stats.high, price);
+                stats.low = (stats.trades == 1) ? price : std::min(stats.low, price);
+                stats.last = price;
+            }
+
+            void on_fill(Order& o, const Trade&) override {
+                if (o.get_status() == FILLED) {
+                    finished.push_back(&o);
+                }
+            }
+
+            void on_order_closed(Order& o) override {
+                finished.push_back(&o);
+            }
+
+            uint64_t event = 0;
+
+            // Orders the book is done with since they were last cleared
+            std::vector<const Order*> finished;
+        private:
+            InstrumentStats& stats;
+            std::vector<uint64_t>& trade_events;
+    };
+
+    static bool is_live(Order& o) {
+        OrderStatus status = o.get_status();
+        return status == UNFILLED || status == PARTIALLY_FILLED;
+    }
+
+    Backtest::~Backtest() {
+        for (auto& p : partitions) {
+            for (Trade* t : p->trades) { delete t; }
+        }
+    }
+
+    uint32_t Backtest::partition(const std::string& instrument) {
+        auto it = partition_indexes.find(instrument);
+        if (it != partition_indexes.end()) {
+            return it->second;
+        }
+
+        uint32_t index = partitions.size();
+        partitions.emplace_back(new Partition());
+        partitions.back()->instrument = instrument;
+        partition_indexes[instrument] = index;
+
+        return index;
+    }
+
+    bool Backtest::add(const std::string& line) {
+        /*
+         * Hand a line of the recording to the partition of its instrument.
+         * Cancels go to the partition of the order they cancel.
+         */
+        RecordedEvent e;
+        e.time_ns = last_time;
+        e.payload = line;
+
+        if (!line.empty() && std::isdigit((unsigned char) line[0])) {
+            size_t space = line.find(' ');
+            if (space == std::string::npos) {
+                skipped++;
+                return false;
+            }
+
+            e.time_ns = std::strtoll(line.c_str(), nullptr, 10);
+            e.payload = line.substr(space + 1);
+        }
+
+        const std::string& payload = e.payload;
+        std::string type = payload.substr(0, 3);
+        uint32_t index;
+
+        if (payload.compare(0, 2, "o|") == 0) {
+            size_t end = payload.find('|', 2);
+            if (end == std::string::npos || end == 2) {
+                skipped++;
+                return false;
+            }
+
+            index = partition(payload.substr(2, end - 2));
+            order_partitions.push_back(index);
+            e.order_id = order_partitions.size();
+        } else if (payload.compare(0, 2, "c|") == 0) {
+            // Cancels of orders the recording doesn't have can't be placed
+            uint64_t id = std::strtoull(payload.c_str() + 2, nullptr, 10);
+            if (id == 0 || id > order_partitions.size()) {
+                skipped++;
+                return false;
+            }
+
+            index = order_partitions[id - 1];
+        } else if (type == "au|" || type == "op|" || type == "cl|") {
+            index = partition(payload.substr(3));
+        } else {
+            skipped++;
+            return false;
+        }
+
+        last_time = e.time_ns;
+        e.index = next_index++;
+        partitions[index]->events.push_back(std::move(e));
+
+        return true;
+    }
+
+    size_t Backtest::load(std::istream& in) {
+        size_t added = 0;
+        std::string line;
+
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+
+            if (add(line)) {
+                added++;
+            }
+        }
+
+        return added;
+    }
+
+    void Backtest::run(size_t threads) {
+        /*
+         * Run every partition, then merge their trades into one tape in
+         * the order of the events that made them.
+         */
+        tape.clear();
+        stats.clear();
+
+        // The busiest instruments go first so that the long tasks aren't
+        //     left until the end
+        std::vector<Partition*> order;
+        for (auto& p : partitions) {
+            for (Trade* t : p->trades) { delete t; }
+            p->trades.clear();
+            p->trade_events.clear();
+            order.push_back(p.get());
+        }
+
+        std::stable_sort(order.begin(), order.end(), [](const Partition* a, const Partition* b) {
+            return a->events.size() > b->events.size();
+        });
+
+        {
+            WorkStealingPool pool(threads);
+            for (Partition* p : order) {
+                pool.submit([this, p]() { run_partition(*p); });
+            }
+
+            pool.wait();
+            steals = pool.get_steals();
+        }
+
+        size_t trade_count = 0;
+        for (auto& p : partitions) {
+            trade_count += p->trades.size();
+            stats.push_back(p->stats);
+        }
+
+        std::sort(stats.begin(), stats.end(), [](const InstrumentStats& a, const InstrumentStats& b) {
+            return a.instrument < b.instrument;
+        });
+
+        // Each event belongs to one partition, so a stable sort keeps the
+        //     trades of an event in the order its book made them
+        tape.reserve(trade_count);
+        for (auto& p : partitions) {
+            for (size_t i = 0; i < p->trades.size(); i++) {
+                tape.push_back({p->trade_events[i], p->trades[i]});
+            }
+        }
+
+        std::stable_sort(tape.begin(), tape.end(), [](const TapeEntry& a, const TapeEntry& b) {
+            return a.event < b.event;
+        });
+    }
+
+    void Backtest::run_partition(Partition& p) {
+        /*
+         * Replay one instrument's events through a book of its own. Orders
+         * are freed as soon as the book is done with them, so memory use
+         * follows the orders live at once rather than the whole day.
+         */
+        p.stats = InstrumentStats();
+        p.stats.instrument = p.instrument;
+
+        // Declared before the book so that they outlive it
+        std::unordered_map<uint64_t, std::unique_ptr<Order>> live;
+        std::unordered_map<const Order*, uint64_t> ids;
+
+        VirtualClock clock;
+        ReplayListener listener(p.stats, p.trade_events);
+
+        Orderbook book(p.instrument, config);
+        book.set_clock(&clock);
+        book.add_listener(&listener);
+
+        for (auto& e : p.events) {
+            clock.set(Timestamp(std::chrono::duration_cast<Timestamp::duration>(
+                std::chrono::nanoseconds(e.time_ns))));
+            listener.event = e.index;
+
+            // Kept until the end of the event in case it doesn't stay live
+            std::unique_ptr<Order> submitted;
+
+            if (e.order_id != 0) {
+                p.stats.orders++;
+
+                std::pair<Order*, bool> parsed = Order::deserialize(e.payload);
+                submitted.reset(parsed.first);
+
+                if (!parsed.second || !book.submit_order(*submitted)) {
+                    p.stats.rejected++;
+                } else if (is_live(*submitted)) {
+                    ids[submitted.get()] = e.order_id;
+                    live[e.order_id] = std::move(submitted);
+                }
+            } else if (e.payload.compare(0, 2, "c|") == 0) {
+                uint64_t id = std::strtoull(e.payload.c_str() + 2, nullptr, 10);
+                auto it = live.find(id);
+
+                if (it == live.end() || !is_live(*it->second)) {
+                    p.stats.cancels_rejected++;
+                } else {
+                    p.stats.cancels++;
+                    it->second->cancel();
+
+                    ids.erase(it->second.get());
+                    live.erase(it);
+                }
+            } else {
+                std::string type = e.payload.substr(0, 2);
+                if (type == "au") {
+                    book.start_auction();
+                } else if (type == "op") {
+                    book.uncross(CONTINUOUS);
+                } else {
+                    book.uncross(CLOSED);
+                }
+            }
+
+            for (const Order* o : listener.finished) {
+                auto it = ids.find(o);
+                if (it != ids.end()) {
+                    live.erase(it->second);
+                    ids.erase(it);
+                }
+            }
+            listener.finished.clear();
+        }
+
+        // Trades are allocated by the book and owned by the backtest from here
+        p.trades = *book.get_trades();
+        book.get_trades()->clear();
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef BACKTEST_H
+#define BACKTEST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "book_side.h"
+#include "trade.h"
+
+namespace exchange {
+    struct RecordedEvent {
+        // Position in the recording, which orders events across instruments
+        uint64_t index = 0;
+
+        // Nanoseconds since the epoch
+        long long time_ns = 0;
+
+        // The ID given to an order, or 0 for other messages
+        uint64_t order_id = 0;
+
+        // The message as it was sent to the exchange
+        std::string payload;
+    };
+
+    struct InstrumentStats {
+        std::string instrument;
+
+        long orders = 0;
+        long rejected = 0;
+        long cancels = 0;
+        long cancels_rejected = 0;
+
+        long trades = 0;
+        long volume = 0;
+        double notional = 0.0;
+
+        // Zero until the instrument trades
+        double high = 0.0;
+        double low = 0.0;
+        double last = 0.0;
+
+        double get_vwap() const { return volume > 0 ? notional / volume : 0.0; }
+    };
+
+    struct TapeEntry {
+        // The recorded event that made the trade
+        uint64_t event;
+        const Trade* trade;
+    };
+
+    class Backtest {
+        /*
+         * Replays a recording of the messages sent to an exchange through
+         * fresh books, one per instrument, on a pool of threads.
+         *
+         * A recording has one message per line in the format of the
+         * exchange API: orders, cancels and the au, op and cl market
+         * controls. Each line may start with the time it was received in
+         * nanoseconds since the epoch and a space, otherwise it takes the
+         * time of the line before. Anything else, e.g. queries, is skipped.
+         * Orders are given IDs in the order they appear from 1, so cancels
+         * refer to an order by its position among the recording's orders.
+         *
+         * Books share nothing, so each instrument's events run as one task
+         * and the results don't depend on the number of threads: the tape
+         * is every trade in the order of the events that made them, as a
+         * single exchange replaying the recording would have made them,
+         * and the statistics are by instrument name.
+         */
+        public:
+            Backtest(const BookConfig& config = BookConfig()) : config(config) {}
+            ~Backtest();
+
+            Backtest(const Backtest&) = delete;
+            Backtest& operator =(const Backtest&) = delete;
+
+            // Returns false for a line that isn't replayed
+            bool add(const std::string& line);
+            size_t load(std::istream& in);
+
+            void run(size_t threads);
+
+            size_t get_event_count() const { return next_index; }
+            size_t get_skipped_count() const { return skipped; }
+            size_t get_instrument_count() const { return partitions.size(); }
+
+            // Filled in by run
+            const std::vector<TapeEntry>& get_tape() const { return tape; }
+            const std::vector<InstrumentStats>& get_stats() const { return stats; }
+            uint64_t get_steals() const { return steals; }
+        private:
+            struct Partition {
+                std::string instrument;
+                std::vector<RecordedEvent> events;
+
+                // Filled in when the partition runs
+                std::vector<Trade*> trades;
+                std::vector<uint64_t> trade_events;
+                InstrumentStats stats;
+            };
+
+            uint32_t partition(const std::string& instrument);
+            void run_partition(Partition& p);
+
+            BookConfig config;
+
+            // In the order their instruments first appear
+            std::vector<std::unique_ptr<Partition>> partitions;
+            std::unordered_map<std::string, uint32_t> partition_indexes;
+
+            // The partition of each order so far, indexed by order ID - 1
+            std::vector<uint32_t> order_partitions;
+
+            long long last_time = 0;
+            uint64_t next_index = 0;
+            size_t skipped = 0;
+
+            std::vector<TapeEntry> tape;
+            std::vector<InstrumentStats> stats;
+            uint64_t steals = 0;
+    };
+}
+
+#endif
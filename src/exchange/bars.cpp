@@ -0,0 +1,85 @@
+#include <algorithm>
+
+#include "bars.h"
+
+namespace exchange {
+    void BarAggregator::on_trade(const Trade& t) {
+        /*
+         * Add a trade to the last bar of every interval, starting a new bar
+         * when the trade falls after the end of the last one.
+         */
+        InstrumentBars& bars = instruments[t.get_instrument()];
+        if (bars.series.empty()) {
+            bars.series.resize(intervals_ms.size());
+        }
+
+        double price = t.get_price();
+        int size = t.get_size();
+
+        bars.stats.last = price;
+        bars.stats.volume += size;
+        bars.stats.turnover += price * size;
+
+        long time_ms = t.get_trade_time_ms();
+
+        for (size_t i = 0; i < intervals_ms.size(); i++) {
+            std::deque<Bar>& series = bars.series[i];
+            long start_ms = time_ms - time_ms % intervals_ms[i];
+
+            // Trades are reported in time order, so a trade can only start
+            //     a new bar or add to the last one
+            if (series.empty() || series.back().start_ms < start_ms) {
+                if (!series.empty() && series.size() >= max_bars) {
+                    series.pop_front();
+                }
+
+                Bar bar;
+                bar.start_ms = start_ms;
+                bar.open = price;
+                bar.high = price;
+                bar.low = price;
+                series.push_back(bar);
+            }
+
+            Bar& bar = series.back();
+            bar.high = std::max(bar.high, price);
+            bar.low = std::min(bar.low, price);
+            bar.close = price;
+            bar.volume += size;
+            bar.turnover += price * size;
+        }
+    }
+
+    bool BarAggregator::get_bars(const std::string& instrument, long interval_ms, size_t count,
+                                 std::vector<Bar>& out) {
+        /*
+         * Append the last count bars of an interval to out, oldest first.
+         *
+         * Returns false when bars aren't kept for the interval.
+         */
+        auto interval = std::find(intervals_ms.begin(), intervals_ms.end(), interval_ms);
+        if (interval == intervals_ms.end()) {
+            return false;
+        }
+
+        auto it = instruments.find(instrument);
+        if (it == instruments.end()) {
+            return true;
+        }
+
+        const std::deque<Bar>& series = it->second.series[interval - intervals_ms.begin()];
+        size_t first = series.size() - std::min(count, series.size());
+        out.insert(out.end(), series.begin() + first, series.end());
+
+        return true;
+    }
+
+    TradeStats BarAggregator::get_stats(const std::string& instrument) {
+        auto it = instruments.find(instrument);
+        if (it == instruments.end()) {
+            return TradeStats();
+        }
+
+        return it->second.stats;
+    }
+}
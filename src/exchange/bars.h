@@ -0,0 +1,73 @@
+#ifndef BARS_H
+#define BARS_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "listener.h"
+#include "trade.h"
+
+namespace exchange {
+    struct Bar {
+        // Start of the interval in milliseconds since the epoch
+        long start_ms = 0;
+
+        double open = 0.0;
+        double high = 0.0;
+        double low = 0.0;
+        double close = 0.0;
+
+        long volume = 0;
+
+        // Sum of price times size, so the VWAP is turnover / volume
+        double turnover = 0.0;
+
+        double vwap() const { return volume == 0 ? 0.0 : turnover / volume; }
+    };
+
+    struct TradeStats {
+        double last = 0.0;
+        long volume = 0;
+        double turnover = 0.0;
+
+        double vwap() const { return volume == 0 ? 0.0 : turnover / volume; }
+    };
+
+    class BarAggregator : public BookListener {
+        /*
+         * Builds OHLCV bars for every instrument as trades happen, so bars
+         * never have to be recomputed from the full trade history.
+         *
+         * Each configured interval keeps its most recent bars, oldest first.
+         * Intervals without any trades have no bar.
+         */
+        public:
+            BarAggregator(std::vector<long> intervals_ms, size_t max_bars)
+                : intervals_ms(intervals_ms), max_bars(max_bars) {}
+
+            bool get_bars(const std::string& instrument, long interval_ms, size_t count,
+                          std::vector<Bar>& out);
+            TradeStats get_stats(const std::string& instrument);
+
+            const std::vector<long>& get_intervals() const { return intervals_ms; }
+
+            void on_trade(const Trade& t) override;
+        private:
+            struct InstrumentBars {
+                TradeStats stats;
+
+                // One series of bars for each configured interval
+                std::vector<std::deque<Bar>> series;
+            };
+
+            std::vector<long> intervals_ms;
+            size_t max_bars;
+
+            std::unordered_map<std::string, InstrumentBars> instruments;
+    };
+}
+
+#endif
@@ -0,0 +1,266 @@
+#ifndef BOOK_SIDE_H
+#define BOOK_SIDE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <utility>
+
+#include "order.h"
+#include "price_ladder.h"
+
+namespace exchange {
+    template <OrderSide S>
+    struct SideTraits;
+
+    template <>
+    struct SideTraits<BUY> {
+        static constexpr OrderSide opposite = SELL;
+
+        // Bids are ranked highest price first
+        typedef std::greater<double> Compare;
+        static constexpr bool better(double a, double b) { return a > b; }
+
+        // A price no bid can be worse than
+        static constexpr double worst_price() { return std::numeric_limits<double>::lowest(); }
+    };
+
+    template <>
+    struct SideTraits<SELL> {
+        static constexpr OrderSide opposite = BUY;
+
+        // Offers are ranked lowest price first
+        typedef std::less<double> Compare;
+        static constexpr bool better(double a, double b) { return a < b; }
+
+        // A price no offer can be worse than
+        static constexpr double worst_price() { return std::numeric_limits<double>::max(); }
+    };
+
+    enum BookLayout {
+        // Levels in a tree, for any prices
+        TREE_LAYOUT,
+        // Levels in a dense array by tick, see price_ladder.h
+        LADDER_LAYOUT
+    };
+
+    struct BookConfig {
+        BookLayout layout = TREE_LAYOUT;
+
+        // Ladder books only take prices on a grid of 1 / ticks_per_unit
+        long ticks_per_unit = 100;
+
+        // Ticks a ladder covers at first, it grows to take in other prices
+        size_t ladder_ticks = 1024;
+
+        // Most ticks a ladder's levels may span, prices further from the
+        //     rest of their side are rejected
+        size_t ladder_max_ticks = 1 << 20;
+    };
+
+    template <OrderSide S>
+    class TreeLevels {
+        /*
+         * Price levels in a tree, for books with prices anywhere. Has the
+         * same interface as PriceLadder so BookSide can keep either.
+         */
+        public:
+            typedef std::map<double, PriceLevel, typename SideTraits<S>::Compare> Map;
+            typedef typename Map::value_type Entry;
+            typedef typename Map::const_iterator const_iterator;
+
+            // Where a level is, or end() when there is none
+            typedef typename Map::iterator Position;
+
+            // Takes the settings of a ladder so that either layout is built
+            //     the same way, but needs none of them
+            TreeLevels(long = 0, size_t = 0, size_t = 0) {}
+
+            bool accepts(double) const { return true; }
+
+            bool empty() const { return levels.empty(); }
+            size_t get_level_count() const { return levels.size(); }
+
+            const_iterator begin() const { return levels.begin(); }
+            const_iterator end() const { return levels.end(); }
+
+            int quantity_at(double price) const {
+                auto level = levels.find(price);
+                return level == levels.end() ? 0 : level->second.quantity;
+            }
+
+            Position best_position() { return levels.begin(); }
+            Position find(double price) { return levels.find(price); }
+            bool found(Position position) const { return position != levels.end(); }
+
+            Position insert(double price) {
+                auto level = levels.lower_bound(price);
+                if (level != levels.end() && level->first == price) {
+                    return level;
+                }
+
+                return levels.emplace_hint(level, std::piecewise_construct,
+                                           std::forward_as_tuple(price), std::forward_as_tuple());
+            }
+
+            PriceLevel& level_at(Position position) { return position->second; }
+            void vacate(Position position) { levels.erase(position); }
+
+            size_t get_memory_usage() const {
+                // A map node and the smallest block a deque allocates
+                const size_t level_size = sizeof(PriceLevel) + sizeof(double) + 4 * sizeof(void*) + 512;
+                return levels.size() * level_size;
+            }
+        private:
+            Map levels;
+    };
+
+    template <OrderSide S, typename Levels = TreeLevels<S>>
+    class BookSide {
+        /*
+         * One side of a book. How its price levels are kept, in a
+         * TreeLevels or a PriceLadder, is a template parameter like the
+         * side itself, so the matching code is compiled for one layout and
+         * never has to check which it has.
+         */
+        public:
+            typedef SideTraits<S> Traits;
+            typedef typename Levels::const_iterator const_iterator;
+
+            static constexpr OrderSide side = S;
+
+            BookSide() {}
+            BookSide(const BookConfig& config)
+                : levels(config.ticks_per_unit, config.ladder_ticks, config.ladder_max_ticks) {}
+
+            bool accepts(double price) const {
+                // Ladders only have levels for prices on their grid and
+                //     within their span
+                return levels.accepts(price);
+            }
+
+            static constexpr bool reaches(double price, double limit) {
+                /*
+                 * Returns true when a resting price on this side is at or
+                 * inside the limit of an order from the other side.
+                 */
+                return !Traits::better(limit, price);
+            }
+
+            static double limit_of(Order& taker) {
+                // Market orders trade against any price on this side
+                return taker.is_market() ? Traits::worst_price() : taker.get_price();
+            }
+
+            bool empty() const { return levels.empty(); }
+
+            size_t get_order_count() const { return order_count; }
+            size_t get_level_count() const { return levels.get_level_count(); }
+
+            double best_price() const { return levels.begin()->first; }
+
+            Order* best_order() const {
+                if (empty()) { return nullptr; }
+                return levels.begin()->second.orders.front();
+            }
+
+            int quantity_at(double price) const { return levels.quantity_at(price); }
+
+            const_iterator begin() const { return levels.begin(); }
+            const_iterator end() const { return levels.end(); }
+
+            int add(Order& o) {
+                /*
+                 * Queue an order behind the others at its price.
+                 *
+                 * Returns the new quantity at the price.
+                 */
+                PriceLevel& level = levels.level_at(levels.insert(o.get_price()));
+                level.orders.push_back(&o);
+                order_count++;
+                return level.quantity += o.effective_size();
+            }
+
+            bool remove(Order& o, int* quantity) {
+                /*
+                 * Take an order out of its price level, setting quantity to
+                 * what is left at the price.
+                 *
+                 * Returns false when the order isn't resting on this side.
+                 */
+                auto position = levels.find(o.get_price());
+                if (!levels.found(position)) { return false; }
+
+                PriceLevel& level = levels.level_at(position);
+                if (!remove_from(level, o, quantity)) { return false; }
+                if (level.orders.empty()) { levels.vacate(position); }
+
+                return true;
+            }
+
+            int fill_best(int size) {
+                /*
+                 * Fill the first order at the best price, taking it off the
+                 * book once it is completely filled.
+                 *
+                 * Returns the quantity left at the price.
+                 */
+                auto position = levels.best_position();
+                PriceLevel& level = levels.level_at(position);
+
+                int quantity = fill_front(level, size);
+                if (level.orders.empty()) { levels.vacate(position); }
+
+                return quantity;
+            }
+
+            size_t get_memory_usage() const {
+                /*
+                 * Approximate bytes held by the levels, counting the size of
+                 * what they allocate rather than asking the allocator.
+                 */
+                return levels.get_memory_usage() + order_count * sizeof(Order*);
+            }
+
+        private:
+            bool remove_from(PriceLevel& level, Order& o, int* quantity) {
+                auto it = std::find(level.orders.begin(), level.orders.end(), &o);
+                if (it == level.orders.end()) { return false; }
+
+                level.orders.erase(it);
+                order_count--;
+                *quantity = level.quantity -= o.effective_size();
+
+                return true;
+            }
+
+            int fill_front(PriceLevel& level, int size) {
+                Order* o = level.orders.front();
+
+                o->fill(size);
+                int quantity = level.quantity -= size;
+
+                if (o->get_status() == FILLED) {
+                    level.orders.pop_front();
+                    order_count--;
+                }
+
+                return quantity;
+            }
+
+            Levels levels;
+            size_t order_count = 0;
+    };
+
+    template <OrderSide S>
+    using TreeSide = BookSide<S, TreeLevels<S>>;
+
+    template <OrderSide S>
+    using LadderSide = BookSide<S, PriceLadder<S>>;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "clock.h"
+
+namespace exchange {
+    TscClock::TscClock(std::chrono::milliseconds calibration) {
+        /*
+         * Count the ticks over a short busy wait on the system clock. The
+         * wait spins rather than sleeps so that the CPU isn't put into a
+         * state where it stops the counter.
+         */
+        auto start = std::chrono::high_resolution_clock::now();
+        uint64_t start_ticks = read_counter();
+
+        auto end = start;
+        while (end - start < calibration) {
+            end = std::chrono::high_resolution_clock::now();
+        }
+        uint64_t end_ticks = read_counter();
+
+        origin = end;
+        origin_ticks = end_ticks;
+
+        if (end_ticks > start_ticks) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+            ns_per_tick = (double) elapsed.count() / (end_ticks - start_ticks);
+        }
+    }
+
+    Timestamp TscClock::now() {
+        if (ns_per_tick == 0.0) {
+            return std::chrono::high_resolution_clock::now();
+        }
+
+        uint64_t ticks = read_counter() - origin_ticks;
+        auto elapsed = std::chrono::nanoseconds((long long) (ticks * ns_per_tick));
+
+        return origin + std::chrono::duration_cast<Timestamp::duration>(elapsed);
+    }
+
+    uint64_t TscClock::read_counter() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    Clock& default_clock() {
+        static SystemClock clock;
+        return clock;
+    }
+}
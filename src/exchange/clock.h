@@ -0,0 +1,94 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+typedef std::chrono::time_point<std::chrono::high_resolution_clock> Timestamp;
+
+namespace exchange {
+    class Clock {
+        /*
+         * Where books and the exchange get the time from, so that the wall
+         * clock can be swapped for a cheaper or a simulated one.
+         *
+         * Books read their clock once per order or auction and stamp the
+         * order and all of its trades with that one reading.
+         */
+        public:
+            virtual ~Clock() {}
+
+            virtual Timestamp now() = 0;
+    };
+
+    class SystemClock : public Clock {
+        public:
+            Timestamp now() override { return std::chrono::high_resolution_clock::now(); }
+    };
+
+    class TscClock : public Clock {
+        /*
+         * Reads the CPU timestamp counter instead of asking the kernel for
+         * the time, scaled by a rate measured against the system clock when
+         * the clock is created.
+         *
+         * The counter runs at a constant rate on the CPUs we run on, but the
+         * rate is only measured once, so the clock slowly drifts away from
+         * the system clock. Where there is no counter it reads the system
+         * clock instead.
+         */
+        public:
+            TscClock(std::chrono::milliseconds calibration = std::chrono::milliseconds(10));
+
+            Timestamp now() override;
+
+            double get_ns_per_tick() const { return ns_per_tick; }
+
+        private:
+            static uint64_t read_counter();
+
+            Timestamp origin;
+            uint64_t origin_ticks = 0;
+            double ns_per_tick = 0.0;
+    };
+
+    class CachedClock : public Clock {
+        /*
+         * Returns the time read by the last call to refresh, so a batch of
+         * orders handled together costs a single read of the clock behind
+         * it.
+         */
+        public:
+            CachedClock(Clock& source) : source(source), cached(source.now()) {}
+
+            Timestamp refresh() { return cached = source.now(); }
+            Timestamp now() override { return cached; }
+
+        private:
+            Clock& source;
+            Timestamp cached;
+    };
+
+    class VirtualClock : public Clock {
+        /*
+         * A clock that only moves when told to, for replaying events at
+         * the times they originally happened and for backtests that run
+         * faster than real time.
+         */
+        public:
+            VirtualClock(Timestamp start = Timestamp()) : current(start) {}
+
+            void set(Timestamp time) { current = time; }
+            void advance(Timestamp::duration by) { current += by; }
+
+            Timestamp now() override { return current; }
+
+        private:
+            Timestamp current;
+    };
+
+    // The system clock, used by books and exchanges until given another
+    Clock& default_clock();
+}
+
+#endif
@@ -1,7 +1,89 @@
+#include <functional>
+#include <iostream>
+
 #include "exchange.h"
 
 namespace exchange {
     std::string Exchange::get_status() {
         return "Ready.";
     }
+
+    Orderbook* Exchange::add_instrument(const std::string& instrument, const BookConfig& config) {
+        auto it = books.find(instrument);
+        if (it != books.end()) {
+            return it->second.get();
+        }
+
+        // The layout is chosen per instrument when it is first added
+        Orderbook* ob = new Orderbook(instrument, config);
+        ob->set_clock(clock);
+        ob->add_listener(&risk);
+        books[instrument] = std::unique_ptr<Orderbook>(ob);
+
+        return ob;
+    }
+
+    Orderbook* Exchange::get_orderbook(const std::string& instrument) {
+        auto it = books.find(instrument);
+        if (it == books.end()) {
+            return nullptr;
+        }
+
+        return it->second.get();
+    }
+
+    void Exchange::set_clock(Clock* new_clock) {
+        clock = new_clock;
+        for (auto& book : books) {
+            book.second->set_clock(clock);
+        }
+    }
+
+    bool Exchange::submit_order(Order& o, RiskResult* risk_result) {
+        return submit_order(o, clock->now(), risk_result);
+    }
+
+    bool Exchange::submit_order(Order& o, Timestamp now, RiskResult* risk_result) {
+        /*
+         * Route an order through the pre-trade risk checks and on to the book
+         * for its instrument.
+         *
+         * Returns true when the order was accepted by the book. When the
+         * order fails a risk check its status is set to REJECTED and the
+         * failed check is written to risk_result if given.
+         */
+        Orderbook* ob = get_orderbook(o.get_instrument());
+        if (ob == nullptr) {
+            std::cerr << "Order rejected for unknown instrument "
+                      << o.get_instrument() << ".\n";
+            o.set_status(REJECTED);
+            return false;
+        }
+
+        RiskResult result = risk.check(o, ob->get_best_bid(), ob->get_best_offer(), now);
+        if (risk_result != nullptr) {
+            *risk_result = result;
+        }
+
+        if (result != RISK_OK) {
+            o.set_status(REJECTED);
+            return false;
+        }
+
+        return ob->submit_order(o);
+    }
+
+    uint64_t Exchange::checksum() {
+        /*
+         * Combined checksum of every book, in instrument order, for
+         * comparing an exchange with a replica of it.
+         */
+        uint64_t hash = 0;
+        for (auto& book : books) {
+            hash = hash * 31 + std::hash<std::string>()(book.first);
+            hash = hash * 31 + book.second->checksum();
+        }
+
+        return hash;
+    }
 }
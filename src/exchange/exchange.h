@@ -1,12 +1,43 @@
 #ifndef EXCHANGE_H
 #define EXCHANGE_H
 
+#include <map>
+#include <memory>
 #include <string>
 
+#include "order.h"
+#include "orderbook.h"
+#include "risk.h"
+
 namespace exchange {
     class Exchange {
         public:
             std::string get_status();
+
+            Orderbook* add_instrument(const std::string& instrument, const BookConfig& config = BookConfig());
+            Orderbook* get_orderbook(const std::string& instrument);
+
+            RiskChecker& get_risk() { return risk; }
+
+            // The clock for risk checks and every book, including books
+            //     added later
+            void set_clock(Clock* new_clock);
+
+            bool submit_order(Order& o, RiskResult* risk_result = nullptr);
+
+            // Submit with the time the risk checks should see, so an order
+            //     replayed later is checked exactly as it was the first time
+            bool submit_order(Order& o, Timestamp now, RiskResult* risk_result = nullptr);
+
+            uint64_t checksum();
+        private:
+            // Books are held by pointer so listeners and callers can keep
+            //     references to them as instruments are added
+            std::map<std::string, std::unique_ptr<Orderbook>> books;
+
+            RiskChecker risk;
+
+            Clock* clock = &default_clock();
     };
 }
 
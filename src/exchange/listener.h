@@ -0,0 +1,37 @@
+#ifndef LISTENER_H
+#define LISTENER_H
+
+#include <string>
+
+#include "order.h"
+#include "trade.h"
+
+namespace exchange {
+    class BookListener {
+        /*
+         * Receives events from an Orderbook as they happen. Listeners are
+         * called synchronously from the matching path so they should only
+         * do a small amount of work per event.
+         */
+        public:
+            virtual ~BookListener() {}
+
+            // Called for every trade made by the book
+            virtual void on_trade(const Trade&) {}
+
+            // Called after on_trade for the maker and then the taker of the
+            //     trade, once the fill has been applied to the order
+            virtual void on_fill(Order& /* o */, const Trade&) {}
+
+            // Called when an accepted order stops being live while it still has
+            //     unfilled quantity, e.g. when cancelled or an IOC remainder
+            virtual void on_order_closed(Order&) {}
+
+            // Called with the new total quantity whenever a price level changes,
+            //     a quantity of zero means the level is now empty
+            virtual void on_level_change(const std::string& /* instrument */, OrderSide /* side */,
+                                         double /* price */, int /* quantity */) {}
+    };
+}
+
+#endif
@@ -0,0 +1,183 @@
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "low_latency.h"
+#include "orderbook.h"
+
+namespace exchange {
+    // Explicit hugepages are 2 MiB on the platforms we run on
+    const size_t HUGEPAGE_SIZE = 2 * 1024 * 1024;
+
+    bool pin_thread(int cpu) {
+        if (cpu < 0) {
+            return true;
+        }
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (error != 0) {
+            std::cerr << "Failed to pin thread to CPU " << cpu << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool lock_memory() {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            std::cerr << "Failed to lock memory, check RLIMIT_MEMLOCK" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    void warm_up(const std::string& instrument, int orders) {
+        /*
+         * Orders alternate sides around a mid price so that about half of
+         * them trade and the rest rest and are cancelled, going through
+         * every part of the matching path.
+         */
+        Client maker("warm_up_maker");
+        Client taker("warm_up_taker");
+
+        std::vector<Order> warm_orders;
+        warm_orders.reserve(orders);
+        for (int i = 0; i < orders; i++) {
+            double offset = (i % 20) * 0.01;
+            if (i % 2 == 0) {
+                warm_orders.emplace_back(instrument.c_str(), 100.00 + offset, 10, SELL, maker);
+            } else {
+                warm_orders.emplace_back(instrument.c_str(), 99.90 + offset, 10, BUY, taker);
+            }
+        }
+
+        Orderbook book(instrument);
+        for (auto& o : warm_orders) {
+            book.submit_order(o);
+        }
+
+        for (auto& o : warm_orders) {
+            o.cancel();
+        }
+
+        for (auto t : *book.get_trades()) {
+            delete t;
+        }
+    }
+
+    void WaitStrategy::idle() {
+        if (idle_polls++ < spin_limit) {
+#if defined(__x86_64__) || defined(__i386__)
+            // Tells the core this is a spin loop, which saves power and
+            //     avoids a pipeline flush when the wait ends
+            __builtin_ia32_pause();
+#endif
+            return;
+        }
+
+        std::this_thread::yield();
+    }
+
+    void Doorbell::prepare() {
+        sleeping.store(true, std::memory_order_relaxed);
+
+        // Pairs with the fence in ring(), so either the producer sees the
+        //     consumer is about to sleep or the consumer sees its work
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void Doorbell::wait(std::chrono::steady_clock::time_point until) {
+        /*
+         * Sleep until the bell is rung or until the given time.
+         */
+        std::unique_lock<std::mutex> guard(lock);
+        bell.wait_until(guard, until, [this]() { return rung; });
+
+        rung = false;
+        sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    void Doorbell::ring() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!sleeping.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        rung = true;
+        bell.notify_one();
+    }
+
+    Arena::Arena(size_t requested, bool hugepages) {
+        size_t page = hugepages ? HUGEPAGE_SIZE : (size_t) sysconf(_SC_PAGESIZE);
+        capacity = (requested + page - 1) / page * page;
+
+        void* memory = MAP_FAILED;
+        if (hugepages) {
+            memory = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            huge = memory != MAP_FAILED;
+        }
+
+        if (memory == MAP_FAILED) {
+            memory = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                std::cerr << "Failed to map arena of " << capacity << " bytes" << std::endl;
+                capacity = 0;
+                return;
+            }
+
+            // Without reserved hugepages ask for transparent ones instead
+            if (hugepages) {
+                madvise(memory, capacity, MADV_HUGEPAGE);
+            }
+        }
+
+        base = static_cast<char*>(memory);
+
+        // Touch every page now rather than on first use
+        size_t small_page = (size_t) sysconf(_SC_PAGESIZE);
+        for (size_t offset = 0; offset < capacity; offset += small_page) {
+            base[offset] = 0;
+        }
+
+        locked = mlock(base, capacity) == 0;
+        if (!locked) {
+            std::cerr << "Failed to lock arena, check RLIMIT_MEMLOCK" << std::endl;
+        }
+    }
+
+    Arena::~Arena() {
+        for (Destructor* d = destructors; d != nullptr; d = d->next) {
+            d->run(d->object);
+        }
+
+        if (base != nullptr) {
+            munmap(base, capacity);
+        }
+    }
+
+    void* Arena::allocate(size_t size, size_t alignment) {
+        uintptr_t start = reinterpret_cast<uintptr_t>(base) + used;
+        size_t padding = (alignment - start % alignment) % alignment;
+
+        if (base == nullptr || used + padding + size > capacity) {
+            return nullptr;
+        }
+
+        used += padding + size;
+        return reinterpret_cast<void*>(start + padding);
+    }
+}
@@ -0,0 +1,141 @@
+#ifndef LOW_LATENCY_H
+#define LOW_LATENCY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+
+namespace exchange {
+    // Pin the calling thread to one CPU, a negative CPU leaves it unpinned
+    bool pin_thread(int cpu);
+
+    // Lock every current and future page of the process into memory
+    bool lock_memory();
+
+    // Run synthetic orders through a scratch book so that the matching code
+    //     and the allocator are warm before real orders arrive
+    void warm_up(const std::string& instrument, int orders);
+
+    class WaitStrategy {
+        /*
+         * Busy spins while waiting for work so that new work is picked up
+         * without a trip through the scheduler, then yields the core once
+         * nothing has turned up for spin_limit polls.
+         */
+        public:
+            WaitStrategy(long spin_limit) : spin_limit(spin_limit) {}
+
+            // Called each time a poll finds nothing to do
+            void idle();
+
+            // Called each time a poll finds work
+            void reset() { idle_polls = 0; }
+
+            bool is_spinning() const { return idle_polls <= spin_limit; }
+
+        private:
+            long spin_limit;
+            long idle_polls = 0;
+    };
+
+    class Doorbell {
+        /*
+         * Lets a consumer thread sleep until a producer hands it work,
+         * without producers taking a lock or making a system call while the
+         * consumer is awake.
+         *
+         * The consumer calls prepare() before it looks for work for the last
+         * time, then wait() if there was none, or cancel() if there was.
+         * Work added in between rings the bell rather than being slept
+         * through.
+         */
+        public:
+            void prepare();
+            void cancel() { sleeping.store(false, std::memory_order_relaxed); }
+            void wait(std::chrono::steady_clock::time_point until);
+
+            // Called by producers after adding work
+            void ring();
+
+        private:
+            std::atomic<bool> sleeping{false};
+
+            std::mutex lock;
+            std::condition_variable bell;
+            bool rung = false;
+    };
+
+    class Arena {
+        /*
+         * Bump allocator over a single block mapped when it is created.
+         *
+         * The block is backed by explicit hugepages when the system has
+         * them reserved and transparent hugepages otherwise, and every page
+         * is faulted in and locked up front so that allocating from the
+         * arena never takes a page fault. Memory is only given back when
+         * the arena is destroyed, which is also when the objects made with
+         * create() are destroyed, newest first.
+         */
+        public:
+            Arena(size_t capacity, bool hugepages);
+            ~Arena();
+
+            Arena(const Arena&) = delete;
+            Arena& operator =(const Arena&) = delete;
+
+            // Returns nullptr once the arena is full
+            void* allocate(size_t size, size_t alignment);
+
+            // Constructs a T in the arena, or returns nullptr once the arena
+            //     is full. The arena runs its destructor, so it must never
+            //     be deleted
+            template <typename T, typename... Args>
+            T* create(Args&&... args) {
+                size_t mark = used;
+                void* record = allocate(sizeof(Destructor), alignof(Destructor));
+                void* memory = (record != nullptr) ? allocate(sizeof(T), alignof(T)) : nullptr;
+                if (memory == nullptr) {
+                    used = mark;
+                    return nullptr;
+                }
+
+                T* object = new (memory) T(std::forward<Args>(args)...);
+                destructors = new (record) Destructor{destroy<T>, object, destructors};
+                return object;
+            }
+
+            bool is_valid() const { return base != nullptr; }
+            bool is_huge() const { return huge; }
+            bool is_locked() const { return locked; }
+
+            size_t get_capacity() const { return capacity; }
+            size_t get_used() const { return used; }
+
+        private:
+            // Kept in the arena ahead of each object made by create(), so
+            //     tracking them doesn't allocate either
+            struct Destructor {
+                void (*run)(void*);
+                void* object;
+                Destructor* next;
+            };
+
+            template <typename T>
+            static void destroy(void* object) { static_cast<T*>(object)->~T(); }
+
+            char* base = nullptr;
+            size_t capacity = 0;
+            size_t used = 0;
+            Destructor* destructors = nullptr;
+
+            bool huge = false;
+            bool locked = false;
+    };
+}
+
+#endif
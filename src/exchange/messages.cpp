@@ -0,0 +1,32 @@
+#include "messages.h"
+
+namespace exchange {
+    MessageType message_type(const std::string& payload) {
+        /*
+         * Tell what a message from a session is from its first field.
+         * Anything that isn't a cancel, query or market control is taken
+         * to be an order.
+         */
+        std::string type = payload.substr(0, 3);
+
+        if (payload.compare(0, 2, "c|") == 0) {
+            return CANCEL_MESSAGE;
+        }
+
+        if (payload == "bb" || payload == "bo" || payload == "bbbo" ||
+            type == "br|" || type == "st|") {
+            return QUERY_MESSAGE;
+        }
+
+        if (type == "au|" || type == "op|" || type == "cl|") {
+            return MARKET_CONTROL_MESSAGE;
+        }
+
+        return ORDER_MESSAGE;
+    }
+
+    bool may_send(SessionRole role, MessageType type) {
+        // Only operators start auctions and open or close markets
+        return type != MARKET_CONTROL_MESSAGE || role == OPERATOR_SESSION;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include <string>
+
+namespace exchange {
+    enum MessageType {
+        ORDER_MESSAGE,
+        CANCEL_MESSAGE,
+        // Top of book, bar and status requests, which change nothing
+        QUERY_MESSAGE,
+        // Auction call, market open and market close
+        MARKET_CONTROL_MESSAGE
+    };
+
+    enum SessionRole {
+        // Trading sessions on any transport
+        ORDER_ENTRY_SESSION,
+        // Sessions allowed to run the market as well as trade
+        OPERATOR_SESSION
+    };
+
+    // The reply to a message the session isn't allowed to send
+    const std::string NOT_PERMITTED_REPLY = "REJ|NOT_PERMITTED";
+
+    MessageType message_type(const std::string& payload);
+    bool may_send(SessionRole role, MessageType type);
+}
+
+#endif
@@ -0,0 +1,79 @@
+#include <sstream>
+#include <vector>
+
+#include "metrics.h"
+
+namespace exchange {
+    Metric& MetricsRegistry::counter(const std::string& name, const std::string& help,
+                                     const std::string& labels) {
+        return add(name, help, "counter", labels);
+    }
+
+    Metric& MetricsRegistry::gauge(const std::string& name, const std::string& help,
+                                   const std::string& labels) {
+        return add(name, help, "gauge", labels);
+    }
+
+    Metric& MetricsRegistry::add(const std::string& name, const std::string& help,
+                                 const std::string& type, const std::string& labels) {
+        std::lock_guard<std::mutex> guard(lock);
+
+        // Registering the same metric twice hands back the original
+        for (auto& entry : entries) {
+            if (entry.name == name && entry.labels == labels) {
+                return entry.metric;
+            }
+        }
+
+        entries.emplace_back(name, help, type, labels);
+        return entries.back().metric;
+    }
+
+    std::string MetricsRegistry::render() {
+        /*
+         * Every metric with the same name is written together under one
+         * HELP and TYPE line, in the order the names were first registered.
+         */
+        std::lock_guard<std::mutex> guard(lock);
+
+        std::vector<const std::string*> names;
+        for (auto& entry : entries) {
+            bool seen = false;
+            for (auto name : names) {
+                if (*name == entry.name) {
+                    seen = true;
+                    break;
+                }
+            }
+
+            if (!seen) {
+                names.push_back(&entry.name);
+            }
+        }
+
+        std::stringstream ss;
+        for (auto name : names) {
+            bool header = false;
+
+            for (auto& entry : entries) {
+                if (entry.name != *name) {
+                    continue;
+                }
+
+                if (!header) {
+                    ss << "# HELP " << entry.name << ' ' << entry.help << '\n';
+                    ss << "# TYPE " << entry.name << ' ' << entry.type << '\n';
+                    header = true;
+                }
+
+                ss << entry.name;
+                if (!entry.labels.empty()) {
+                    ss << '{' << entry.labels << '}';
+                }
+                ss << ' ' << entry.metric.get() << '\n';
+            }
+        }
+
+        return ss.str();
+    }
+}
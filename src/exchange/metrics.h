@@ -0,0 +1,66 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace exchange {
+    class Metric {
+        /*
+         * A counter or gauge that can be updated from any thread. Updates
+         * are relaxed atomic operations, so they never take a lock or wait
+         * for a scrape.
+         */
+        public:
+            void add(long n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+            void set(long new_value) { value.store(new_value, std::memory_order_relaxed); }
+            long get() const { return value.load(std::memory_order_relaxed); }
+
+        private:
+            std::atomic<long> value{0};
+    };
+
+    class MetricsRegistry {
+        /*
+         * Owns every metric and renders them in the Prometheus text format.
+         *
+         * Registering and rendering take a lock, but code holding a Metric
+         * updates it directly without going through the registry. Metrics
+         * live as long as the registry.
+         */
+        public:
+            // labels are written as in Prometheus, e.g. instrument="ABC"
+            Metric& counter(const std::string& name, const std::string& help,
+                            const std::string& labels = "");
+            Metric& gauge(const std::string& name, const std::string& help,
+                          const std::string& labels = "");
+
+            std::string render();
+
+        private:
+            struct Entry {
+                Entry(const std::string& name, const std::string& help, const std::string& type,
+                      const std::string& labels)
+                    : name(name), help(help), type(type), labels(labels) {}
+
+                std::string name;
+                std::string help;
+                std::string type;
+                std::string labels;
+
+                Metric metric;
+            };
+
+            Metric& add(const std::string& name, const std::string& help, const std::string& type,
+                        const std::string& labels);
+
+            std::mutex lock;
+
+            // A deque so that metrics never move once registered
+            std::deque<Entry> entries;
+    };
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace exchange {
+    template <typename T>
+    class MpscQueue {
+        /*
+         * A bounded lock-free queue for handing work from many producer
+         * threads to a single consumer thread.
+         *
+         * Each cell carries a sequence number which tells producers and the
+         * consumer whose turn it is to use the cell, so the only shared
+         * write between producers is claiming a position in the queue.
+         *
+         * Capacity is rounded up to a power of two.
+         */
+        public:
+            MpscQueue(size_t capacity) : cells(round_up(capacity)), mask(cells.size() - 1) {
+                for (size_t i = 0; i < cells.size(); i++) {
+                    cells[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            MpscQueue(const MpscQueue&) = delete;
+            MpscQueue& operator =(const MpscQueue&) = delete;
+
+            bool try_push(T&& value) {
+                /*
+                 * Add a value to the queue. Returns false when the queue is full,
+                 * in which case the value is left untouched.
+                 */
+                size_t pos = tail.load(std::memory_order_relaxed);
+
+                for (;;) {
+                    Cell& cell = cells[pos & mask];
+                    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                    long difference = (long) sequence - (long) pos;
+
+                    if (difference == 0) {
+                        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            cell.value = std::move(value);
+                            cell.sequence.store(pos + 1, std::memory_order_release);
+                            return true;
+                        }
+                    } else if (difference < 0) {
+                        return false;
+                    } else {
+                        pos = tail.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            bool try_push(const T& value) {
+                T copy(value);
+                return try_push(std::move(copy));
+            }
+
+            bool try_pop(T& value) {
+                /*
+                 * Take the oldest value from the queue. Must only be called from
+                 * the consumer thread. Returns false when the queue is empty.
+                 */
+                Cell& cell = cells[head & mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+                if (sequence != head + 1) {
+                    return false;
+                }
+
+                value = std::move(cell.value);
+                cell.sequence.store(head + cells.size(), std::memory_order_release);
+                head++;
+
+                return true;
+            }
+
+            size_t capacity() const { return cells.size(); }
+
+        private:
+            struct Cell {
+                std::atomic<size_t> sequence;
+                T value;
+            };
+
+            static size_t round_up(size_t capacity) {
+                size_t size = 1;
+                while (size < capacity) {
+                    size <<= 1;
+                }
+
+                return size;
+            }
+
+            std::vector<Cell> cells;
+            const size_t mask;
+
+            std::atomic<size_t> tail{0};
+
+            // Keep the consumer position off the cache line the producers
+            //     write to. Padding is used rather than alignas so the queue
+            //     can still be allocated with plain operator new.
+            char padding[64 - sizeof(std::atomic<size_t>)];
+
+            size_t head = 0;
+    };
+}
+
+#endif
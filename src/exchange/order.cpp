@@ -1,7 +1,7 @@
-#include <chrono>
 #include <iomanip>
 #include <sstream>
 #include "order.h"
+#include "orderbook.h"
 #include "client.h"
 
 namespace exchange {
@@ -14,47 +14,26 @@ namespace exchange {
 
         filled_amount = 0;
         status = UNFILLED;
-        order_time = std::chrono::high_resolution_clock::now();
     }
 
     bool Order::operator <(const Order& o) const {
-        if (side == BUY) {
-            if (price > o.price) {
-                return true;
-            }
-
-            if (price == o.price) {
-                if (order_time < o.order_time) {
-                    return true;
-                } else {
-                    return false;
-                }
-            }
-
-            if (price < o.price) {
-                return false;
-            }
-
-        } else if (side == SELL){
-            if (price < o.price) {
-                return true;
-            }
-
-            if (price == o.price) {
-                if (order_time < o.order_time) {
-                    return true;
-                } else {
-                    return false;
-                }
-            }
+        /*
+         * Orders with better prices come first, then earlier orders at
+         * the same price. The book itself ranks orders with the
+         * comparators in book_side.h and doesn't use this.
+         *
+         * Orders that have reached a book are ranked by the sequence the
+         * book gave them, which doesn't depend on the clock.
+         */
+        if (price != o.price) {
+            return (side == BUY) ? price > o.price : price < o.price;
+        }
 
-            if (price > o.price) {
-                return false;
-            }
+        if (sequence != 0 && o.sequence != 0) {
+            return sequence < o.sequence;
         }
 
-        // Unreachable
-        throw 0;
+        return order_time < o.order_time;
     }
 
     bool Order::operator >(const Order& o) const { return (*this < o); }
@@ -68,6 +47,12 @@ namespace exchange {
     }
 
     void Order::cancel() {
+        if (book != nullptr) {
+            // Take the order off the book so its resting quantity is
+            //     no longer counted in the book's price levels
+            book->remove_order(*this);
+        }
+
         status = CANCELLED;
     }
 
@@ -118,6 +103,24 @@ namespace exchange {
         ss << (o.side == BUY ? "BUY" : "SELL") << '|';
         ss << o.get_client().get_name();
 
+        // Execution instructions are only sent when they differ from
+        //     a plain resting limit order
+        std::string instructions;
+        if (o.type == MARKET) { instructions += "MKT,"; }
+        if (o.tif == IOC) { instructions += "IOC,"; }
+        if (o.tif == FOK) { instructions += "FOK,"; }
+        if (o.post_only) { instructions += "POST,"; }
+        if (o.stop_price > 0.0) {
+            std::stringstream stop;
+            stop << std::fixed << std::setprecision(4) << o.stop_price;
+            instructions += "STOP=" + stop.str() + ",";
+        }
+
+        if (!instructions.empty()) {
+            instructions.pop_back();
+            ss << '|' << instructions;
+        }
+
         return ss.str();
     }
 
@@ -158,10 +161,43 @@ namespace exchange {
         }
 
         std::string client_name;
-        std::getline(ss, client_name);
+        std::getline(ss, client_name, '|');
+
+        OrderType type = LIMIT;
+        TimeInForce tif = GTC;
+        bool post_only = false;
+        double stop_price = 0.0;
+
+        // Optional comma separated execution instructions
+        std::string instruction;
+        while (std::getline(ss, instruction, ',')) {
+            if (instruction == "MKT") {
+                type = MARKET;
+            } else if (instruction == "GTC") {
+                tif = GTC;
+            } else if (instruction == "IOC") {
+                tif = IOC;
+            } else if (instruction == "FOK") {
+                tif = FOK;
+            } else if (instruction == "POST") {
+                post_only = true;
+            } else if (instruction.compare(0, 5, "STOP=") == 0) {
+                std::stringstream stop(instruction.substr(5));
+                if (!(stop >> stop_price) || stop_price <= 0.0) {
+                    // Stop prices must be positive numbers
+                    return {nullptr, false};
+                }
+            } else {
+                // Unknown execution instruction
+                return {nullptr, false};
+            }
+        }
 
-        Client* c = new Client(client_name);
-        Order* o = new Order(instrument.c_str(), price, size, side, *c);
+        Order* o = new Order(instrument.c_str(), price, size, side, Client(client_name));
+        o->set_type(type);
+        o->set_time_in_force(tif);
+        o->set_post_only(post_only);
+        o->set_stop_price(stop_price);
 
         return {o, true};
     }
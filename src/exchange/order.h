@@ -3,16 +3,20 @@
 
 #include <string>
 #include <chrono>
+#include <cstdint>
 #include "client.h"
 
 typedef std::chrono::time_point<std::chrono::high_resolution_clock> Timestamp;
 
 namespace exchange {
+    class Orderbook;
+
     enum OrderStatus {
         UNFILLED,
         PARTIALLY_FILLED,
         FILLED,
-        CANCELLED
+        CANCELLED,
+        REJECTED
     };
 
     enum OrderSide {
@@ -20,6 +24,20 @@ namespace exchange {
         SELL
     };
 
+    enum OrderType {
+        LIMIT,
+        MARKET
+    };
+
+    enum TimeInForce {
+        // Rest any unfilled remainder on the book
+        GTC,
+        // Fill what is immediately available and cancel the remainder
+        IOC,
+        // Fill the whole order immediately or cancel all of it
+        FOK
+    };
+
     class Order {
         public:
             Order(const char* instrument, double price, int size, OrderSide side, Client client);
@@ -40,15 +58,41 @@ namespace exchange {
             bool is_buy() { return side == BUY; }
             bool is_sell() { return side == SELL; }
 
+            void set_type(OrderType new_type) { type = new_type; }
+            OrderType get_type() const { return type; }
+            bool is_market() const { return type == MARKET; }
+
+            void set_time_in_force(TimeInForce new_tif) { tif = new_tif; }
+            TimeInForce get_time_in_force() const { return tif; }
+
+            void set_post_only(bool flag) { post_only = flag; }
+            bool is_post_only() const { return post_only; }
+
+            // Stop orders wait off the book until a trade reaches their
+            //     stop price, then enter as a market or limit order
+            void set_stop_price(double new_stop_price) { stop_price = new_stop_price; }
+            double get_stop_price() const { return stop_price; }
+            bool is_stop() const { return stop_price > 0.0; }
+            bool is_triggered() const { return triggered; }
+
             double get_price() { return price; }
             OrderSide get_side() { return side; }
             Client get_client() const { return client; }
+
+            // Time the order reached its book, from the book's clock
+            Timestamp get_order_time() const { return order_time; }
+
+            // Position in the order of arrival at the book, which decides
+            //     time priority, or 0 before the order is submitted
+            uint64_t get_sequence() const { return sequence; }
             int get_size() { return size; }
 
             static std::string serialize(const Order& o);
             static std::pair<Order*, bool> deserialize(const std::string& o_serialized);
 
         private:
+            friend class Orderbook;
+
             std::string instrument;
             double price;
 
@@ -58,9 +102,20 @@ namespace exchange {
             OrderSide side;
             OrderStatus status;
 
+            OrderType type = LIMIT;
+            TimeInForce tif = GTC;
+            bool post_only = false;
+
+            double stop_price = 0.0;
+            bool triggered = false;
+
             Client client;
 
             Timestamp order_time;
+            uint64_t sequence = 0;
+
+            // The book this order is resting on, if any
+            Orderbook* book = nullptr;
     };
 }
 
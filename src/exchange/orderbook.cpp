@@ -1,6 +1,9 @@
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 
+#include "low_latency.h"
 #include "orderbook.h"
 
 namespace exchange {
@@ -9,145 +12,669 @@ namespace exchange {
     }
 
     bool Orderbook::submit_order(Order& o) {
+        event_time = clock->now();
+
+        return process_order(o);
+    }
+
+    bool Orderbook::process_order(Order& o) {
+        /*
+         * Submit an order to the book, matching it against resting orders
+         * on the other side and handling its execution instructions.
+         *
+         * Returns false when the order is rejected. Orders that are accepted
+         * but cancelled by their time in force (an unfillable FOK or the
+         * remainder of an IOC or market order) still return true.
+         *
+         * During an auction call orders rest without matching and only
+         * plain limit orders are accepted. A closed book rejects everything,
+         * and a ladder book rejects limit prices off its tick grid.
+         *
+         * Stop orders wait off the book until a trade reaches their stop
+         * price, or trigger at once if the last trade already has.
+         */
         if (o.get_instrument() != instrument) {
             std::cerr << "Order rejected for instrument mismatch with Orderbook.\n";
             return false;
         }
 
-        if (o.is_buy()) {
-            buy_orders.push_back(&o);
-        } else {
-            sell_orders.push_back(&o);
+        if (metrics.orders != nullptr) {
+            metrics.orders->add();
+        }
+
+        if (phase == CLOSED) {
+            close_order(o, REJECTED);
+            return false;
+        }
+
+        // Ladder books only have levels on their tick grid and within
+        //     the span of their ladders
+        if (!o.is_market() && !can_rest(o)) {
+            close_order(o, REJECTED);
+            return false;
+        }
+
+        // Time priority follows arrival at the book rather than the clock
+        o.sequence = ++sequence;
+        o.order_time = event_time;
+
+        if (o.is_stop() && !o.is_triggered()) {
+            stops.add(o);
+            o.book = this;
+
+            if (phase == CONTINUOUS && !trades.empty()) {
+                double last_price = trades.back()->get_price();
+                stops.trigger(last_price, last_price, triggered_stops);
+                run_stops();
+            }
+
+            return true;
+        }
+
+        if (phase == AUCTION) {
+            // Orders only collect during an auction call, so anything that
+            //     has to trade immediately can't be accepted
+            if (o.is_market() || o.get_time_in_force() != GTC) {
+                close_order(o, REJECTED);
+                return false;
+            }
+
+            rest_order(o);
+            return true;
+        }
+
+        bool accepted = execute_order(o);
+        run_stops();
+
+        return accepted;
+    }
+
+    bool Orderbook::execute_order(Order& o) {
+        /*
+         * Match an order in continuous trading and then rest or cancel what
+         * is left of it, queueing any stops its trades trigger.
+         *
+         * Returns false when the order is rejected.
+         */
+
+        // Post-only orders must only ever add liquidity
+        if (o.is_post_only() && crosses(o)) {
+            close_order(o, REJECTED);
+            return false;
+        }
+
+        // Fill-or-kill orders are checked against the aggregated price levels
+        //     up front so that the book is never touched when they can't fill
+        if (o.get_time_in_force() == FOK && !can_fill(o)) {
+            close_order(o, CANCELLED);
+            return true;
         }
 
-        match_orders(o.get_side());
+        size_t first_trade = trades.size();
+        match_orders(o);
 
+        if (o.effective_size() > 0) {
+            // A triggered stop's limit can have drifted out of a ladder's
+            //     span since the stop was accepted
+            if (o.is_market() || o.get_time_in_force() != GTC || !can_rest(o)) {
+                close_order(o, CANCELLED);
+            } else {
+                rest_order(o);
+            }
+        }
+
+        trigger_stops(first_trade);
         return true;
     }
 
-    double Orderbook::get_best_bid() {
-        double bb = 0.0;
+    void Orderbook::trigger_stops(size_t first_trade) {
+        /*
+         * Queue the stops triggered by the trades from first_trade onwards.
+         *
+         * Only the highest and lowest prices traded matter, so a sweep
+         * through many levels costs one index lookup per side.
+         */
+        if (first_trade >= trades.size()) { return; }
 
-        for (auto o : buy_orders) {
-            if (o->is_cancelled()) { continue; }
-            bb = std::max(bb, o->get_price());
+        double low = trades[first_trade]->get_price();
+        double high = low;
+        for (size_t i = first_trade + 1; i < trades.size(); i++) {
+            low = std::min(low, trades[i]->get_price());
+            high = std::max(high, trades[i]->get_price());
         }
 
-        return bb;
+        stops.trigger(low, high, triggered_stops);
     }
 
-    double Orderbook::get_best_offer() {
-        double bo = std::numeric_limits<double>::max();
+    void Orderbook::run_stops() {
+        /*
+         * Match triggered stops one at a time in the order they triggered.
+         *
+         * Stops triggered by those trades join the back of the queue, so a
+         * cascade handles each stop once instead of rescanning every
+         * waiting stop after each trade.
+         */
+        while (!triggered_stops.empty()) {
+            Order* o = triggered_stops.front();
+            triggered_stops.pop_front();
 
-        for (auto o : sell_orders) {
-            if (o->is_cancelled()) { continue; }
-            bo = std::min(bo, o->get_price());
+            o->triggered = true;
+            o->book = nullptr;
+            execute_order(*o);
         }
+    }
 
-        return bo;
+    double Orderbook::get_best_bid() {
+        return with_sides([](auto& bids, auto&) {
+            return bids.empty() ? 0.0 : bids.best_price();
+        });
     }
 
-    bool Orderbook::is_matched() {
+    double Orderbook::get_best_offer() {
+        return with_sides([](auto&, auto& asks) {
+            return asks.empty() ? std::numeric_limits<double>::max() : asks.best_price();
+        });
+    }
+
+    int Orderbook::get_quantity_at(OrderSide side, double price) {
         /*
-         * Returns true when there are matched orders in the book.
+         * Returns the total resting quantity at a price level.
          */
-        return get_best_bid() >= get_best_offer();
+        return with_sides([side, price](auto& bids, auto& asks) {
+            return (side == BUY) ? bids.quantity_at(price) : asks.quantity_at(price);
+        });
     }
 
     Order* Orderbook::get_best_buy() {
         /*
          * Returns a pointer to the most aggressive buy order in the book.
          */
+        return with_sides([](auto& bids, auto&) { return bids.best_order(); });
+    }
+
+    Order* Orderbook::get_best_sell() {
+        /*
+         * Returns a pointer to the most aggressive sell order in the book.
+         */
+        return with_sides([](auto&, auto& asks) { return asks.best_order(); });
+    }
+
+    // The side of an order and the layout of the book are only looked at
+    //     once, here, to pick which specialisation of the book code to run
 
-        Order* best_buy = nullptr;
-        for (auto o : buy_orders) {
-            if (best_buy == nullptr) {
-                best_buy = o;
-                continue;
+    bool Orderbook::crosses(Order& taker) {
+        return with_sides([this, &taker](auto& bids, auto& asks) {
+            return taker.is_buy() ? crosses(taker, asks) : crosses(taker, bids);
+        });
+    }
+
+    bool Orderbook::can_fill(Order& taker) {
+        return with_sides([this, &taker](auto& bids, auto& asks) {
+            return taker.is_buy() ? can_fill(taker, asks) : can_fill(taker, bids);
+        });
+    }
+
+    void Orderbook::match_orders(Order& taker) {
+        with_sides([this, &taker](auto& bids, auto& asks) {
+            if (taker.is_buy()) {
+                match_orders(taker, asks);
+            } else {
+                match_orders(taker, bids);
             }
+        });
+    }
+
+    bool Orderbook::can_rest(Order& o) {
+        return with_sides([&o](auto& bids, auto& asks) {
+            return o.is_buy() ? bids.accepts(o.get_price()) : asks.accepts(o.get_price());
+        });
+    }
 
-            if (*o < *best_buy) {
-                best_buy = o;
+    void Orderbook::rest_order(Order& o) {
+        with_sides([this, &o](auto& bids, auto& asks) {
+            if (o.is_buy()) {
+                rest_order(o, bids);
+            } else {
+                rest_order(o, asks);
             }
+        });
+    }
+
+    // FNV-1a, which is cheap and good enough to notice books drifting apart
+    const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    static void hash_bytes(uint64_t& hash, const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * FNV_PRIME;
         }
+    }
 
-        return best_buy;
+    template <typename T>
+    static void hash_value(uint64_t& hash, T value) {
+        hash_bytes(hash, &value, sizeof(value));
     }
 
-    Order* Orderbook::get_best_sell() {
+    static void hash_order(uint64_t& hash, Order& o) {
+        std::string client = o.get_client().get_name();
+        hash_bytes(hash, client.data(), client.size());
+        hash_value(hash, o.get_sequence());
+        hash_value(hash, o.get_price());
+        hash_value(hash, o.effective_size());
+        hash_value(hash, o.get_stop_price());
+    }
+
+    template <typename Side>
+    static void hash_levels(uint64_t& hash, const Side& side) {
+        for (auto& level : side) {
+            hash_value(hash, level.first);
+            hash_value(hash, level.second.quantity);
+            for (auto o : level.second.orders) { hash_order(hash, *o); }
+        }
+    }
+
+    uint64_t Orderbook::checksum() {
         /*
-         * Returns a pointer to the most aggressive sell order in the book.
+         * Hash of everything that decides what the book does with the next
+         * order: the phase, every resting and waiting stop order in priority
+         * order, and the number of trades so far.
+         *
+         * Two books given the same orders in the same order have the same
+         * checksum, whatever the clock said when they were given them.
+         */
+        uint64_t hash = FNV_OFFSET;
+        hash_value(hash, (int) phase);
+        hash_value(hash, sequence);
+
+        with_sides([&hash](auto& bids, auto& asks) {
+            hash_levels(hash, bids);
+            hash_levels(hash, asks);
+        });
+
+        stops.for_each([&hash](Order& o) { hash_order(hash, o); });
+        hash_value(hash, trades.size());
+
+        return hash;
+    }
+
+    void Orderbook::set_metrics(MetricsRegistry& registry) {
+        std::string book_labels = "instrument=\"" + instrument + "\"";
+        std::string bid_labels = book_labels + ",side=\"buy\"";
+        std::string ask_labels = book_labels + ",side=\"sell\"";
+
+        metrics.orders = &registry.counter("exchange_orders_total", "Orders submitted to the book", book_labels);
+        metrics.trades = &registry.counter("exchange_trades_total", "Trades made by the book", book_labels);
+        metrics.volume = &registry.counter("exchange_traded_volume_total", "Quantity traded by the book", book_labels);
+
+        metrics.bid_orders = &registry.gauge("exchange_resting_orders", "Orders resting on the book", bid_labels);
+        metrics.ask_orders = &registry.gauge("exchange_resting_orders", "Orders resting on the book", ask_labels);
+        metrics.bid_levels = &registry.gauge("exchange_price_levels", "Price levels with resting orders", bid_labels);
+        metrics.ask_levels = &registry.gauge("exchange_price_levels", "Price levels with resting orders", ask_labels);
+        metrics.stop_orders = &registry.gauge("exchange_stop_orders", "Stop orders waiting to trigger", book_labels);
+
+        metrics.stored_trades = &registry.gauge("exchange_stored_trades", "Trades kept by the book", book_labels);
+        metrics.memory = &registry.gauge("exchange_book_memory_bytes", "Approximate memory used by the book", book_labels);
+
+        update_metrics();
+    }
+
+    size_t Orderbook::get_memory_usage() {
+        /*
+         * Approximate bytes held by the book, counting the size of what it
+         * allocates rather than asking the allocator.
          */
 
-        Order* best_sell = nullptr;
-        for (auto o : sell_orders) {
-            if (best_sell == nullptr) {
-                best_sell = o;
-                continue;
+        // A multimap node for each waiting stop
+        const size_t stop_size = sizeof(double) + sizeof(Order*) + 4 * sizeof(void*);
+
+        return trades.capacity() * sizeof(Trade*) + trades.size() * sizeof(Trade)
+            + with_sides([](auto& bids, auto& asks) { return bids.get_memory_usage() + asks.get_memory_usage(); })
+            + stops.size() * stop_size;
+    }
+
+    void Orderbook::update_metrics() {
+        /*
+         * Set the gauges from the current state of the book. Only counters
+         * are updated as orders are handled, so the gauges stay where they
+         * are until this is called again from the thread using the book.
+         */
+        if (metrics.bid_orders == nullptr) {
+            return;
+        }
+
+        with_sides([this](auto& bids, auto& asks) {
+            metrics.bid_orders->set(bids.get_order_count());
+            metrics.ask_orders->set(asks.get_order_count());
+            metrics.bid_levels->set(bids.get_level_count());
+            metrics.ask_levels->set(asks.get_level_count());
+        });
+        metrics.stop_orders->set(stops.size());
+        metrics.stored_trades->set(trades.size());
+        metrics.memory->set(get_memory_usage());
+    }
+
+    void Orderbook::remove_order(Order& o) {
+        if (o.is_stop() && !o.is_triggered()) {
+            if (stops.remove(o)) {
+                for (auto listener : listeners) {
+                    listener->on_order_closed(o);
+                }
             }
+        } else {
+            with_sides([this, &o](auto& bids, auto& asks) {
+                if (o.is_buy()) {
+                    remove_order(o, bids);
+                } else {
+                    remove_order(o, asks);
+                }
+            });
+        }
+
+        o.book = nullptr;
+    }
+
+    template <typename Side>
+    bool Orderbook::crosses(Order& taker, const Side& resting) {
+        /*
+         * Returns true when the order would trade against the best resting
+         * order on the other side of the book.
+         */
+        return !resting.empty() && Side::reaches(resting.best_price(), Side::limit_of(taker));
+    }
+
+    template <typename Side>
+    bool Orderbook::can_fill(Order& taker, const Side& resting) {
+        /*
+         * Returns true when there is enough quantity resting at prices the
+         * order would trade at to fill it completely.
+         */
+        double limit = Side::limit_of(taker);
+        int needed = taker.effective_size();
+        int available = 0;
+
+        for (auto& level : resting) {
+            if (!Side::reaches(level.first, limit)) { break; }
+
+            available += level.second.quantity;
+            if (available >= needed) { return true; }
+        }
+
+        return false;
+    }
+
+    template <typename Side>
+    void Orderbook::rest_order(Order& o, Side& side) {
+        int quantity = side.add(o);
+
+        o.book = this;
+        level_changed(Side::side, o.get_price(), quantity);
+    }
 
-            if (*o < *best_sell) {
-                best_sell = o;
+    template <typename Side>
+    void Orderbook::remove_order(Order& o, Side& side) {
+        int quantity;
+        if (side.remove(o, &quantity)) {
+            level_changed(Side::side, o.get_price(), quantity);
+
+            for (auto listener : listeners) {
+                listener->on_order_closed(o);
             }
         }
+    }
+
+    void Orderbook::close_order(Order& o, OrderStatus status) {
+        /*
+         * Finish an order that never rested on the book.
+         */
+        o.set_status(status);
 
-        return best_sell;
+        for (auto listener : listeners) {
+            listener->on_order_closed(o);
+        }
     }
 
-    void Orderbook::match_orders(OrderSide side) {
-        std::vector<Trade*> new_trades;
-        while (is_matched()) {
-            Order* bb = get_best_buy();
-            Order* bs = get_best_sell();
+    void Orderbook::level_changed(OrderSide side, double price, int quantity) {
+        for (auto listener : listeners) {
+            listener->on_level_change(instrument, side, price, quantity);
+        }
+    }
 
-            int trade_size = std::min(bb->effective_size(), bs->effective_size());
+    template <typename Side>
+    void Orderbook::match_orders(Order& taker, Side& resting) {
+        /*
+         * Match a newly submitted order against the resting orders on the
+         * other side of the book until it is filled or no longer crosses.
+         *
+         * Resting orders are taken from the front of the best price level,
+         * so each fill is constant time apart from the level lookup.
+         */
+        double limit = Side::limit_of(taker);
 
+        bool matched = false;
+        while (taker.effective_size() > 0 && !resting.empty()) {
             // Price occurs at the maker order price, so if the new order
             //     was a buy, then the trade occurs at the price of the sell order
             //     and vice versa if the taker is a sell order.
-            double trade_price = (side == BUY) ? bs->get_price() : bb->get_price();
+            double trade_price = resting.best_price();
+            if (!Side::reaches(trade_price, limit)) { break; }
+
+            Order* maker = resting.best_order();
+            int trade_size = std::min(taker.effective_size(), maker->effective_size());
 
             // Maker is the order on the book and taker is the client of the new order.
-            Client maker = (side == BUY) ? bs->get_client() : bb->get_client();
-            Client taker = (side == BUY) ? bb->get_client() : bs->get_client();
+            Trade* new_t = new_trade(trade_price, trade_size, Side::Traits::opposite,
+                                     maker->get_client(), taker.get_client());
+
+            // Register the fill on each order, which takes the resting
+            //     order off the book if it is filled
+            taker.fill(trade_size);
+            int quantity = resting.fill_best(trade_size);
+            if (maker->get_status() == FILLED) {
+                maker->book = nullptr;
+            }
+
+            level_changed(Side::side, trade_price, quantity);
+            record_trade(new_t, *maker, taker);
+            matched = true;
+        }
+
+        if (matched && trade_announcements) {
+          std::cout << "Matching finished" << std::endl;
+        }
+    }
+
+    Trade* Orderbook::new_trade(double price, int size, OrderSide side, const Client& maker,
+                                const Client& taker) {
+        if (trade_arena != nullptr) {
+            Trade* t = trade_arena->create<Trade>(instrument, price, size, side, maker, taker, event_time);
+            if (t != nullptr) {
+                return t;
+            }
+        }
+
+        return new Trade(instrument, price, size, side, maker, taker, event_time);
+    }
+
+    void Orderbook::record_trade(Trade* t, Order& maker, Order& taker) {
+        if (trade_announcements) {
+            bool bought = t->get_side() == BUY;
+            std::cout << t->get_taker().get_name()
+                      << (bought ? " bought " : " sold ") << "\t"
+                      << t->get_size() << "\t" << instrument
+                      << (bought ? " from " : " to ")
+                      << t->get_maker().get_name()
+                      << " at a price of\t" << t->get_price()
+                      << std::endl;
+        }
+
+        // Record the new trade
+        trades.push_back(t);
+
+        if (metrics.trades != nullptr) {
+            metrics.trades->add();
+            metrics.volume->add(t->get_size());
+        }
 
-            Trade* new_t = new Trade(instrument, trade_price, trade_size, side,
-                                     maker, taker);
+        for (auto listener : listeners) {
+            listener->on_trade(*t);
+            listener->on_fill(maker, *t);
+            listener->on_fill(taker, *t);
+        }
+    }
 
-            // Register the fill on each order
-            bb->fill(trade_size);
-            bs->fill(trade_size);
+    std::pair<double, int> Orderbook::get_equilibrium() {
+        return with_sides([this](auto& bids, auto& asks) { return get_equilibrium(bids, asks); });
+    }
 
-            // If orders are filled remove them from the book
-            if (bb->get_status() == FILLED) {
-                buy_orders.erase(
-                    std::find(buy_orders.begin(), buy_orders.end(), bb), buy_orders.end()
-                );
+    template <typename Bids, typename Asks>
+    std::pair<double, int> Orderbook::get_equilibrium(const Bids& bids, const Asks& asks) {
+        /*
+         * Find the price an auction would uncross at and the volume it
+         * would execute.
+         *
+         * The price chosen executes the most volume, then leaves the
+         * smallest imbalance between buy and sell quantity, then is closest
+         * to the last trade price (or the middle of the tied prices when
+         * there have been no trades).
+         *
+         * The quantity available at each price comes from one cumulative
+         * sweep over the price levels of each side, so this is linear in the
+         * number of levels however many orders are resting.
+         */
+        std::vector<double> prices;
+        for (auto& level : bids) { prices.push_back(level.first); }
+        for (auto& level : asks) { prices.push_back(level.first); }
+
+        std::sort(prices.begin(), prices.end());
+        prices.erase(std::unique(prices.begin(), prices.end()), prices.end());
+
+        size_t n = prices.size();
+
+        // Sell quantity at or below each price
+        std::vector<long> supply(n);
+        auto sell = asks.begin();
+        long cumulative = 0;
+        for (size_t i = 0; i < n; i++) {
+            while (sell != asks.end() && sell->first <= prices[i]) {
+                cumulative += sell->second.quantity;
+                ++sell;
             }
+            supply[i] = cumulative;
+        }
 
-            if (bs->get_status() == FILLED) {
-                sell_orders.erase(
-                    std::find(sell_orders.begin(), sell_orders.end(), bs), sell_orders.end()
-                );
+        // Buy quantity at or above each price
+        std::vector<long> demand(n);
+        auto buy = bids.begin();
+        cumulative = 0;
+        for (size_t i = n; i-- > 0;) {
+            while (buy != bids.end() && buy->first >= prices[i]) {
+                cumulative += buy->second.quantity;
+                ++buy;
             }
+            demand[i] = cumulative;
+        }
+
+        long best_volume = 0;
+        long best_imbalance = 0;
+        for (size_t i = 0; i < n; i++) {
+            long volume = std::min(supply[i], demand[i]);
+            long imbalance = std::labs(demand[i] - supply[i]);
 
-            if (trade_announcements) {
-                std::cout << taker.get_name()
-                          << ((side == BUY) ? " bought " : " sold ") << "\t"
-                          << trade_size << "\t" << instrument
-                          << ((side == BUY) ? " from " : " to ")
-                          << maker.get_name()
-                          << " at a price of\t" << trade_price
-                          << std::endl;
+            if (volume > best_volume || (volume == best_volume && imbalance < best_imbalance)) {
+                best_volume = volume;
+                best_imbalance = imbalance;
             }
+        }
 
-            // Record the new trade
-            trades.push_back(new_t);
+        if (best_volume == 0) {
+            return {0.0, 0};
         }
 
-        if (new_trades.size() > 0 && trade_announcements) {
-          std::cout << "Matching finished" << std::endl;
+        std::vector<double> tied;
+        for (size_t i = 0; i < n; i++) {
+            if (std::min(supply[i], demand[i]) == best_volume &&
+                std::labs(demand[i] - supply[i]) == best_imbalance) {
+                tied.push_back(prices[i]);
+            }
         }
+
+        double reference = trades.empty() ? (tied.front() + tied.back()) / 2
+                                          : trades.back()->get_price();
+
+        // Ties in distance go to the lower price
+        double best_price = tied.front();
+        for (auto price : tied) {
+            if (std::fabs(price - reference) < std::fabs(best_price - reference)) {
+                best_price = price;
+            }
+        }
+
+        return {best_price, (int) best_volume};
     }
-}
 
+    int Orderbook::uncross(MarketPhase next_phase) {
+        /*
+         * End an auction call by executing every crossing order at the
+         * equilibrium price, then move the book to next_phase. Stops
+         * reached by the auction price trigger when trading continues.
+         *
+         * Returns the volume executed.
+         */
+        std::pair<double, int> equilibrium = get_equilibrium();
+        event_time = clock->now();
+
+        if (equilibrium.second > 0) {
+            with_sides([this, equilibrium](auto& bids, auto& asks) {
+                execute_auction(equilibrium.first, equilibrium.second, bids, asks);
+            });
+        }
+
+        phase = next_phase;
+
+        if (phase == CONTINUOUS && equilibrium.second > 0) {
+            stops.trigger(equilibrium.first, equilibrium.first, triggered_stops);
+            run_stops();
+        }
+
+        return equilibrium.second;
+    }
+
+    template <typename Bids, typename Asks>
+    void Orderbook::execute_auction(double price, int volume, Bids& bids, Asks& asks) {
+        /*
+         * Fill volume units at price in a single pass over the crossing
+         * orders of each side, taken in price then time priority.
+         */
+        while (volume > 0 && !bids.empty() && !asks.empty()) {
+            double buy_price = bids.best_price();
+            double sell_price = asks.best_price();
+            if (buy_price < price || sell_price > price) { break; }
+
+            Order* buy = bids.best_order();
+            Order* sell = asks.best_order();
+
+            int trade_size = std::min(volume, std::min(buy->effective_size(), sell->effective_size()));
+
+            // Neither order took liquidity from the other, so the order that
+            //     arrived last is reported as the taker
+            bool buy_later = sell->get_sequence() < buy->get_sequence();
+            Order* maker = buy_later ? sell : buy;
+            Order* taker = buy_later ? buy : sell;
+
+            Trade* new_t = new_trade(price, trade_size, taker->get_side(),
+                                     maker->get_client(), taker->get_client());
+
+            int buy_quantity = bids.fill_best(trade_size);
+            int sell_quantity = asks.fill_best(trade_size);
+            volume -= trade_size;
+
+            if (buy->get_status() == FILLED) { buy->book = nullptr; }
+            if (sell->get_status() == FILLED) { sell->book = nullptr; }
+
+            level_changed(BUY, buy_price, buy_quantity);
+            level_changed(SELL, sell_price, sell_quantity);
+            record_trade(new_t, *maker, *taker);
+        }
+    }
+}
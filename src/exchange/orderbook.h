@@ -3,19 +3,57 @@
 
 #include <string>
 #include <chrono>
+#include <cstddef>
+#include <deque>
+#include <utility>
 #include <vector>
 
+#include "book_side.h"
 #include "client.h"
+#include "clock.h"
+#include "listener.h"
+#include "metrics.h"
 #include "order.h"
+#include "stop_book.h"
 #include "trade.h"
 
 typedef std::chrono::time_point<std::chrono::high_resolution_clock> Timestamp;
 
 namespace exchange {
+    class Arena;
+
+    enum MarketPhase {
+        // Orders match as they arrive
+        CONTINUOUS,
+        // Orders collect without matching until the book is uncrossed
+        AUCTION,
+        // No orders are accepted
+        CLOSED
+    };
+
+    struct BookMetrics {
+        Metric* orders = nullptr;
+        Metric* trades = nullptr;
+        Metric* volume = nullptr;
+
+        Metric* bid_orders = nullptr;
+        Metric* ask_orders = nullptr;
+        Metric* bid_levels = nullptr;
+        Metric* ask_levels = nullptr;
+        Metric* stop_orders = nullptr;
+
+        Metric* stored_trades = nullptr;
+        Metric* memory = nullptr;
+    };
+
     class Orderbook {
         public:
-            Orderbook(std::string instrument) : instrument(instrument) {}
-            Orderbook(const char* instrument) : instrument(instrument) {}
+            Orderbook(std::string instrument, const BookConfig& config = BookConfig())
+                : instrument(instrument), laddered(config.layout == LADDER_LAYOUT)
+                , ladder_bids(config), ladder_asks(config) {}
+            Orderbook(const char* instrument, const BookConfig& config = BookConfig())
+                : instrument(instrument), laddered(config.layout == LADDER_LAYOUT)
+                , ladder_bids(config), ladder_asks(config) {}
 
             std::string get_instrument();
 
@@ -27,19 +65,114 @@ namespace exchange {
             Order* get_best_buy();
             Order* get_best_sell();
 
+            int get_quantity_at(OrderSide side, double price);
+
+            size_t get_stop_count() { return stops.size(); }
+
+            MarketPhase get_phase() { return phase; }
+            void start_auction() { phase = AUCTION; }
+            std::pair<double, int> get_equilibrium();
+            int uncross(MarketPhase next_phase);
+
             std::vector<Trade*>* get_trades() { return &trades; }
 
+            // Trades are allocated from the arena until it is full, and
+            //     the trade list is sized up front, so that recording a
+            //     trade doesn't page fault. The names in a trade may still
+            //     allocate. Trades from the arena are destroyed with the
+            //     arena, so it must outlive the book and they must never
+            //     be deleted
+            void set_trade_arena(Arena* arena) { trade_arena = arena; }
+            void reserve_trades(size_t count) { trades.reserve(count); }
+
+            // Orders and trades are stamped with the time from this clock
+            void set_clock(Clock* new_clock) { clock = new_clock; }
+
             void set_trade_announcements(bool flag) { trade_announcements = flag; }
+
+            void add_listener(BookListener* listener) { listeners.push_back(listener); }
+
+            uint64_t checksum();
+
+            void set_metrics(MetricsRegistry& registry);
+            void update_metrics();
+            size_t get_memory_usage();
         private:
-            void match_orders(OrderSide side);
-            bool is_matched();
+            friend class Order;
+
+            // The matching code is specialised on the side of the book it
+            //     runs against, and the layout of its levels, so that neither
+            //     price comparisons nor level lookups need branches
+            template <typename Side>
+            void match_orders(Order& taker, Side& resting);
+            template <typename Side>
+            bool crosses(Order& taker, const Side& resting);
+            template <typename Side>
+            bool can_fill(Order& taker, const Side& resting);
+            template <typename Side>
+            void rest_order(Order& o, Side& side);
+            template <typename Side>
+            void remove_order(Order& o, Side& side);
+
+            // Call f with the bids and asks of the book's layout, which is
+            //     the only place the layout is looked at
+            template <typename F>
+            auto with_sides(F f) {
+                return laddered ? f(ladder_bids, ladder_asks) : f(tree_bids, tree_asks);
+            }
+
+            bool crosses(Order& taker);
+            bool can_fill(Order& taker);
+            void match_orders(Order& taker);
+            bool can_rest(Order& o);
+            void rest_order(Order& o);
+            void remove_order(Order& o);
+
+            bool process_order(Order& o);
+            bool execute_order(Order& o);
+            void trigger_stops(size_t first_trade);
+            void run_stops();
+
+            template <typename Bids, typename Asks>
+            std::pair<double, int> get_equilibrium(const Bids& bids, const Asks& asks);
+            template <typename Bids, typename Asks>
+            void execute_auction(double price, int volume, Bids& bids, Asks& asks);
+            Trade* new_trade(double price, int size, OrderSide side, const Client& maker,
+                             const Client& taker);
+            void record_trade(Trade* t, Order& maker, Order& taker);
+            void close_order(Order& o, OrderStatus status);
+            void level_changed(OrderSide side, double price, int quantity);
 
             std::string instrument;
 
-            std::vector<Order*> buy_orders;
-            std::vector<Order*> sell_orders;
+            // Resting orders by price level, best price first, in the layout
+            //     chosen for the book. The sides of the other layout stay empty.
+            bool laddered;
+            TreeSide<BUY> tree_bids;
+            TreeSide<SELL> tree_asks;
+            LadderSide<BUY> ladder_bids;
+            LadderSide<SELL> ladder_asks;
+
+            // Stop orders waiting to trigger, and triggered stops waiting
+            //     to be matched in the order they triggered
+            StopBook stops;
+            std::deque<Order*> triggered_stops;
 
             std::vector<Trade*> trades;
+            Arena* trade_arena = nullptr;
+
+            // Read once per order or auction, for the order and its trades
+            Clock* clock = &default_clock();
+            Timestamp event_time;
+
+            std::vector<BookListener*> listeners;
+
+            BookMetrics metrics;
+
+            MarketPhase phase = CONTINUOUS;
+
+            // Sequence given to the last order accepted by the book
+            uint64_t sequence = 0;
 
             bool trade_announcements = false;
     };
@@ -0,0 +1,75 @@
+#include "outbound_queue.h"
+
+namespace exchange {
+    bool OutboundQueue::push(const std::string& message) {
+        /*
+         * Queue a message for the connection.
+         *
+         * Returns false when the queue was full and the slow consumer policy
+         * was applied instead.
+         */
+        if (disconnected) {
+            dropped++;
+            return false;
+        }
+
+        if (messages.size() >= max_messages) {
+            dropped += messages.size() + 1;
+            messages.clear();
+            bytes = 0;
+
+            if (policy == DROP_TO_SNAPSHOT) {
+                // The snapshot replaces everything the consumer missed
+                snapshot_requested = true;
+            } else {
+                disconnected = true;
+            }
+
+            return false;
+        }
+
+        messages.push_back(message);
+        bytes += message.size();
+
+        if (messages.size() > high_water) {
+            high_water = messages.size();
+        }
+
+        return true;
+    }
+
+    size_t OutboundQueue::pop_batch(std::vector<std::string>& batch, size_t max_bytes) {
+        /*
+         * Move queued messages into batch until about max_bytes have been
+         * taken, so that they can be handed to the socket together.
+         * At least one message is taken when any are queued and max_bytes
+         * isn't zero.
+         *
+         * Returns the number of messages taken.
+         */
+        size_t taken = 0;
+        size_t taken_bytes = 0;
+
+        while (!messages.empty() && taken_bytes < max_bytes) {
+            taken_bytes += messages.front().size();
+            bytes -= messages.front().size();
+
+            batch.push_back(std::move(messages.front()));
+            messages.pop_front();
+            taken++;
+        }
+
+        return taken;
+    }
+
+    bool OutboundQueue::take_snapshot_request() {
+        /*
+         * Returns true once after the queue has been dropped, telling the
+         * caller to queue a snapshot of the current state.
+         */
+        bool requested = snapshot_requested;
+        snapshot_requested = false;
+
+        return requested;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace exchange {
+    enum SlowConsumerPolicy {
+        // Throw away everything queued and send a fresh snapshot once the
+        //     consumer catches up
+        DROP_TO_SNAPSHOT,
+        // Give up on the consumer and close its connection
+        DISCONNECT
+    };
+
+    class OutboundQueue {
+        /*
+         * Bounded queue of messages waiting to be written to one connection.
+         *
+         * When a consumer falls so far behind that the queue is full, the
+         * queue applies its slow consumer policy instead of growing, so one
+         * slow connection can't hold memory or time for everyone else.
+         */
+        public:
+            OutboundQueue(size_t max_messages, SlowConsumerPolicy policy)
+                : max_messages(max_messages), policy(policy) {}
+
+            bool push(const std::string& message);
+            size_t pop_batch(std::vector<std::string>& batch, size_t max_bytes);
+
+            bool take_snapshot_request();
+            bool is_disconnected() const { return disconnected; }
+
+            SlowConsumerPolicy get_policy() const { return policy; }
+
+            size_t depth() const { return messages.size(); }
+            size_t get_bytes() const { return bytes; }
+            size_t get_high_water() const { return high_water; }
+            long get_dropped() const { return dropped; }
+        private:
+            size_t max_messages;
+            SlowConsumerPolicy policy;
+
+            std::deque<std::string> messages;
+            size_t bytes = 0;
+
+            bool snapshot_requested = false;
+            bool disconnected = false;
+
+            size_t high_water = 0;
+            long dropped = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,343 @@
+#ifndef PRICE_LADDER_H
+#define PRICE_LADDER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "order.h"
+
+namespace exchange {
+    struct PriceLevel {
+        // Total resting quantity at the price
+        int quantity = 0;
+
+        // Resting orders in time priority
+        std::deque<Order*> orders;
+    };
+
+    // Index returned by ladder searches that find no occupied level
+    const long NO_LEVEL = -1;
+
+    template <OrderSide S>
+    class PriceLadder {
+        /*
+         * Price levels in a dense array indexed by tick, for books whose
+         * prices cluster in a narrow band.
+         *
+         * Occupied levels are tracked in a bitmap with one bit per tick and
+         * a summary with one bit per word of the bitmap, so the next
+         * occupied level is found with a couple of count trailing (or, for
+         * bids, leading) zeros rather than by walking a tree. The index of
+         * the best level is kept up to date so reading it costs nothing.
+         *
+         * A level is only allocated the first time its tick is used and is
+         * kept when it empties, so a book that trades around the same
+         * prices stops allocating once it has warmed up.
+         *
+         * Prices must lie on the grid of 1 / ticks_per_unit. The ladder
+         * covers a range of ticks around the first price it sees and
+         * doubles to take in prices outside the range, but never spans more
+         * than max_ticks: accepts() refuses prices that would stretch the
+         * occupied levels further, so one stray price can't make the
+         * ladder allocate without limit. An empty ladder moves to wherever
+         * the next price is.
+         */
+        public:
+            // The same entries as a std::map of levels, so books can walk
+            //     either layout with one iterator
+            typedef std::pair<const double, PriceLevel> Entry;
+
+            // Where a level is, or NO_LEVEL when there is none
+            typedef long Position;
+
+            class const_iterator {
+                /*
+                 * Walks the occupied levels best price first.
+                 */
+                public:
+                    const_iterator(const PriceLadder* ladder, long index) : ladder(ladder), index(index) {}
+
+                    const Entry& operator*() const { return ladder->at(index); }
+                    const Entry* operator->() const { return &ladder->at(index); }
+
+                    const_iterator& operator++() {
+                        index = ladder->next_index(index);
+                        return *this;
+                    }
+
+                    bool operator==(const const_iterator& other) const { return index == other.index; }
+                    bool operator!=(const const_iterator& other) const { return index != other.index; }
+                private:
+                    const PriceLadder* ladder;
+                    long index;
+            };
+
+            PriceLadder(long ticks_per_unit = 100, size_t initial_ticks = 1024, size_t max_ticks = 1 << 20)
+                : ticks_per_unit(ticks_per_unit), initial_ticks(initial_ticks)
+                , max_ticks(std::max<size_t>(64, max_ticks)) {}
+
+            bool on_grid(double price) const {
+                return price_of(tick_of(price)) == price;
+            }
+
+            bool accepts(double price) const {
+                /*
+                 * Returns true when price is on the grid and a level there
+                 * keeps the occupied levels within max_ticks of each other.
+                 */
+                if (!on_grid(price)) { return false; }
+                if (empty()) { return true; }
+
+                // The ladder never covers more than max_ticks rounded up to
+                //     a whole word, so anything it already covers is fine
+                long long tick = tick_of(price);
+                if (tick >= base && tick < base + (long long) entries.size()) { return true; }
+
+                long long low = std::min(tick, base + lowest_index());
+                long long high = std::max(tick, base + highest_index());
+                return (unsigned long long) (high - low + 1) <= max_ticks;
+            }
+
+            bool empty() const { return best == NO_LEVEL; }
+            size_t get_level_count() const { return level_count; }
+            size_t get_tick_count() const { return entries.size(); }
+
+            long best_index() const { return best; }
+
+            const_iterator begin() const { return const_iterator(this, best); }
+            const_iterator end() const { return const_iterator(this, NO_LEVEL); }
+
+            long best_position() const { return best; }
+            bool found(long index) const { return index != NO_LEVEL; }
+
+            int quantity_at(double price) const {
+                long index = find(price);
+                return index == NO_LEVEL ? 0 : at(index).second.quantity;
+            }
+
+            long next_index(long index) const {
+                // The next occupied level worse than index
+                return (S == BUY) ? last_at_or_below(index - 1) : first_at_or_above(index + 1);
+            }
+
+            const Entry& at(long index) const { return *entries[index]; }
+            PriceLevel& level_at(long index) { return entries[index]->second; }
+
+            long find(double price) const {
+                /*
+                 * Returns the index of the level at price, or NO_LEVEL when
+                 * nothing rests there.
+                 */
+                long long tick = tick_of(price);
+                if (entries.empty() || tick < base || tick >= base + (long long) entries.size()) {
+                    return NO_LEVEL;
+                }
+
+                long index = (long) (tick - base);
+                return occupied(index) ? index : NO_LEVEL;
+            }
+
+            long insert(double price) {
+                /*
+                 * Returns the index of the level at price, marking it as
+                 * occupied and growing the ladder to reach it if need be.
+                 */
+                long long tick = tick_of(price);
+                long long top = base + (long long) entries.size() - 1;
+
+                if (entries.empty() || empty()) {
+                    if (entries.empty() || tick < base || tick > top) {
+                        rebuild(tick, tick);
+                    }
+                } else if (tick < base || tick > top) {
+                    rebuild(std::min(tick, base + lowest_index()), std::max(tick, base + highest_index()));
+                }
+
+                long index = (long) (tick - base);
+                if (!occupied(index)) {
+                    if (!entries[index]) {
+                        entries[index].reset(new Entry(price_of(tick), PriceLevel()));
+                        allocated++;
+                    }
+
+                    mark(index);
+                    level_count++;
+
+                    if (best == NO_LEVEL || better(index, best)) {
+                        best = index;
+                    }
+                }
+
+                return index;
+            }
+
+            void vacate(long index) {
+                // Called once the last order at a level has gone
+                unmark(index);
+                level_count--;
+
+                if (index == best) {
+                    best = next_index(index);
+                }
+            }
+
+            size_t get_memory_usage() const {
+                // Each level holds a deque, which allocates its map and
+                //     first block even when empty
+                return entries.size() * sizeof(void*)
+                    + allocated * (sizeof(Entry) + 8 * sizeof(void*) + 512)
+                    + (words.size() + summary.size()) * sizeof(uint64_t);
+            }
+        private:
+            long long tick_of(double price) const { return std::llround(price * ticks_per_unit); }
+
+            // Dividing gives the same double as the decimal price would
+            //     parse to, where multiplying by the tick size may not
+            double price_of(long long tick) const { return (double) tick / ticks_per_unit; }
+
+            static bool better(long a, long b) { return (S == BUY) ? a > b : a < b; }
+
+            // Indexes of the lowest and highest occupied levels
+            long lowest_index() const { return (S == SELL) ? best : first_at_or_above(0); }
+            long highest_index() const {
+                return (S == BUY) ? best : last_at_or_below((long) entries.size() - 1);
+            }
+
+            bool occupied(long index) const {
+                return (words[index >> 6] >> (index & 63)) & 1;
+            }
+
+            void mark(long index) {
+                size_t word = index >> 6;
+                words[word] |= 1ULL << (index & 63);
+                summary[word >> 6] |= 1ULL << (word & 63);
+            }
+
+            void unmark(long index) {
+                size_t word = index >> 6;
+                words[word] &= ~(1ULL << (index & 63));
+                if (words[word] == 0) {
+                    summary[word >> 6] &= ~(1ULL << (word & 63));
+                }
+            }
+
+            long first_at_or_above(long index) const {
+                if (index >= (long) entries.size()) { return NO_LEVEL; }
+
+                size_t word = index >> 6;
+                uint64_t bits = words[word] & (~0ULL << (index & 63));
+                if (bits != 0) {
+                    return (long) ((word << 6) + __builtin_ctzll(bits));
+                }
+
+                // Later words with anything in them come from the summary
+                size_t next = word + 1;
+                if (next >= words.size()) { return NO_LEVEL; }
+
+                size_t s = next >> 6;
+                uint64_t found = summary[s] & (~0ULL << (next & 63));
+                while (found == 0) {
+                    if (++s >= summary.size()) { return NO_LEVEL; }
+                    found = summary[s];
+                }
+
+                word = (s << 6) + __builtin_ctzll(found);
+                return (long) ((word << 6) + __builtin_ctzll(words[word]));
+            }
+
+            long last_at_or_below(long index) const {
+                if (index < 0) { return NO_LEVEL; }
+
+                size_t word = index >> 6;
+                uint64_t bits = words[word] & (~0ULL >> (63 - (index & 63)));
+                if (bits != 0) {
+                    return (long) ((word << 6) + 63 - __builtin_clzll(bits));
+                }
+
+                if (word == 0) { return NO_LEVEL; }
+
+                size_t previous = word - 1;
+                size_t s = previous >> 6;
+                uint64_t found = summary[s] & (~0ULL >> (63 - (previous & 63)));
+                while (found == 0) {
+                    if (s == 0) { return NO_LEVEL; }
+                    found = summary[--s];
+                }
+
+                word = (s << 6) + 63 - __builtin_clzll(found);
+                return (long) ((word << 6) + 63 - __builtin_clzll(words[word]));
+            }
+
+            void rebuild(long long low, long long high) {
+                /*
+                 * Rebuild the ladder to cover low to high with room to spare
+                 * on both sides, up to max_ticks, moving the occupied levels
+                 * across. Unoccupied levels outside the new range are freed.
+                 */
+                size_t span = (size_t) (high - low + 1);
+                size_t size = 64;
+                while (size < initial_ticks || size < 2 * span) {
+                    size *= 2;
+                }
+                size = std::max(size, entries.size());
+
+                // Sizes stay whole words of the bitmap
+                size = std::min(size, round_up(max_ticks));
+                size = std::max(size, round_up(span));
+
+                long long new_base = low - (long long) (size - span) / 2;
+                long shift = (long) (base - new_base);
+
+                std::vector<std::unique_ptr<Entry>> rebuilt(size);
+                for (size_t i = 0; i < entries.size(); i++) {
+                    long j = (long) i + shift;
+                    if (j >= 0 && j < (long) size) {
+                        rebuilt[j] = std::move(entries[i]);
+                    } else if (entries[i]) {
+                        allocated--;
+                    }
+                }
+
+                std::vector<uint64_t> old_words(size / 64, 0);
+                old_words.swap(words);
+                summary.assign((words.size() + 63) / 64, 0);
+
+                for (size_t word = 0; word < old_words.size(); word++) {
+                    for (uint64_t bits = old_words[word]; bits != 0; bits &= bits - 1) {
+                        mark((long) ((word << 6) + __builtin_ctzll(bits)) + shift);
+                    }
+                }
+
+                entries.swap(rebuilt);
+                base = new_base;
+                if (best != NO_LEVEL) {
+                    best += shift;
+                }
+            }
+
+            static size_t round_up(size_t ticks) { return (ticks + 63) / 64 * 64; }
+
+            long ticks_per_unit;
+            size_t initial_ticks;
+            size_t max_ticks;
+
+            // Tick of the first entry, so entry i is at price (base + i) / ticks_per_unit
+            long long base = 0;
+            std::vector<std::unique_ptr<Entry>> entries;
+            size_t allocated = 0;
+
+            std::vector<uint64_t> words;
+            std::vector<uint64_t> summary;
+
+            long best = NO_LEVEL;
+            size_t level_count = 0;
+    };
+}
+
+#endif
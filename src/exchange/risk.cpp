@@ -0,0 +1,156 @@
+#include <cmath>
+#include <limits>
+
+#include "risk.h"
+
+namespace exchange {
+    ClientRisk& RiskChecker::client_state(const std::string& client) {
+        // Nodes are never moved once inserted so references stay valid
+        return clients[client];
+    }
+
+    bool RiskChecker::throttled(ClientRisk& state, Timestamp now) {
+        /*
+         * Counts the message against a fixed one second window and returns
+         * true when the client has gone over their message rate.
+         */
+        if (limits.max_messages_per_second <= 0) {
+            return false;
+        }
+
+        long long now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            now.time_since_epoch()).count();
+
+        if (now_ns - state.window_start.load(std::memory_order_relaxed) >= 1000000000LL) {
+            state.window_start.store(now_ns, std::memory_order_relaxed);
+            state.window_messages.store(0, std::memory_order_relaxed);
+        }
+
+        int messages = state.window_messages.load(std::memory_order_relaxed) + 1;
+        state.window_messages.store(messages, std::memory_order_relaxed);
+
+        return messages > limits.max_messages_per_second;
+    }
+
+    RiskResult RiskChecker::check(Order& o, double best_bid, double best_offer, Timestamp now) {
+        /*
+         * Run the pre-trade checks for an order before it reaches the book.
+         *
+         * best_bid and best_offer are the current top of book as returned by
+         * the Orderbook. When the order passes, its quantity is counted as
+         * open for the client until it fills or is closed.
+         */
+        ClientRisk& state = client_state(o.get_client().get_name());
+
+        if (throttled(state, now)) {
+            return RISK_THROTTLED;
+        }
+
+        int size = o.effective_size();
+
+        if (limits.max_order_size > 0 && size > limits.max_order_size) {
+            return RISK_ORDER_SIZE;
+        }
+
+        if (limits.price_band > 0.0 && !o.is_market()) {
+            bool has_bid = best_bid > 0.0;
+            bool has_offer = best_offer < std::numeric_limits<double>::max();
+
+            // Prefer the mid price and fall back on whichever side exists
+            double reference = 0.0;
+            if (has_bid && has_offer) {
+                reference = (best_bid + best_offer) / 2;
+            } else if (has_bid) {
+                reference = best_bid;
+            } else if (has_offer) {
+                reference = best_offer;
+            }
+
+            if (reference > 0.0 &&
+                std::fabs(o.get_price() - reference) > limits.price_band * reference) {
+                return RISK_PRICE_BAND;
+            }
+        }
+
+        std::atomic<long>& open = o.is_buy() ? state.open_buy : state.open_sell;
+        long open_quantity = open.load(std::memory_order_relaxed) + size;
+
+        if (limits.max_open_quantity > 0 && open_quantity > limits.max_open_quantity) {
+            return RISK_OPEN_EXPOSURE;
+        }
+
+        if (limits.max_position > 0) {
+            long position = state.position.load(std::memory_order_relaxed);
+            long worst_case = o.is_buy() ? position + open_quantity : position - open_quantity;
+
+            if (std::labs(worst_case) > limits.max_position) {
+                return RISK_POSITION;
+            }
+        }
+
+        open.store(open_quantity, std::memory_order_relaxed);
+
+        return RISK_OK;
+    }
+
+    void RiskChecker::on_trade(const Trade& t) {
+        ClientRisk& taker = client_state(t.get_taker().get_name());
+        ClientRisk& maker = client_state(t.get_maker().get_name());
+
+        long size = t.get_size();
+
+        // The trade side is the side of the taker so the maker was on the other side
+        ClientRisk& buyer = (t.get_side() == BUY) ? taker : maker;
+        ClientRisk& seller = (t.get_side() == BUY) ? maker : taker;
+
+        buyer.position.store(buyer.position.load(std::memory_order_relaxed) + size,
+                             std::memory_order_relaxed);
+        buyer.open_buy.store(buyer.open_buy.load(std::memory_order_relaxed) - size,
+                             std::memory_order_relaxed);
+
+        seller.position.store(seller.position.load(std::memory_order_relaxed) - size,
+                              std::memory_order_relaxed);
+        seller.open_sell.store(seller.open_sell.load(std::memory_order_relaxed) - size,
+                               std::memory_order_relaxed);
+    }
+
+    void RiskChecker::on_order_closed(Order& o) {
+        ClientRisk& state = client_state(o.get_client().get_name());
+
+        std::atomic<long>& open = o.is_buy() ? state.open_buy : state.open_sell;
+        open.store(open.load(std::memory_order_relaxed) - o.effective_size(),
+                   std::memory_order_relaxed);
+    }
+
+    long RiskChecker::get_position(const std::string& client) const {
+        auto it = clients.find(client);
+        if (it == clients.end()) {
+            return 0;
+        }
+
+        return it->second.position.load(std::memory_order_relaxed);
+    }
+
+    long RiskChecker::get_open_quantity(const std::string& client, OrderSide side) const {
+        auto it = clients.find(client);
+        if (it == clients.end()) {
+            return 0;
+        }
+
+        const ClientRisk& state = it->second;
+        return (side == BUY ? state.open_buy : state.open_sell).load(std::memory_order_relaxed);
+    }
+
+    std::string RiskChecker::describe(RiskResult result) {
+        switch (result) {
+            case RISK_OK: return "OK";
+            case RISK_ORDER_SIZE: return "ORDER_SIZE";
+            case RISK_PRICE_BAND: return "PRICE_BAND";
+            case RISK_OPEN_EXPOSURE: return "OPEN_EXPOSURE";
+            case RISK_POSITION: return "POSITION";
+            case RISK_THROTTLED: return "THROTTLED";
+        }
+
+        return "UNKNOWN";
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef RISK_H
+#define RISK_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+#include "listener.h"
+#include "order.h"
+#include "trade.h"
+
+typedef std::chrono::time_point<std::chrono::high_resolution_clock> Timestamp;
+
+namespace exchange {
+    enum RiskResult {
+        RISK_OK,
+        RISK_ORDER_SIZE,
+        RISK_PRICE_BAND,
+        RISK_OPEN_EXPOSURE,
+        RISK_POSITION,
+        RISK_THROTTLED
+    };
+
+    // A limit of zero disables that check
+    struct RiskLimits {
+        // Largest quantity allowed on a single order
+        int max_order_size = 0;
+
+        // Largest allowed distance of a limit price from the top of book,
+        //     as a fraction of the reference price
+        double price_band = 0.0;
+
+        // Largest unfilled quantity a client may have live on each side
+        long max_open_quantity = 0;
+
+        // Largest absolute position a client may reach if all of their
+        //     live orders on one side were filled
+        long max_position = 0;
+
+        // Most order messages a client may send per second
+        int max_messages_per_second = 0;
+    };
+
+    struct ClientRisk {
+        /*
+         * Per-client counters. They are only ever written from the matching
+         * thread so updates are plain relaxed stores. Another thread holding
+         * a reference to a client's counters may read them without a lock,
+         * but may not look clients up itself, as the matching thread adds
+         * clients to the map as they first appear.
+         */
+        std::atomic<long> position{0};
+        std::atomic<long> open_buy{0};
+        std::atomic<long> open_sell{0};
+
+        std::atomic<long long> window_start{0};
+        std::atomic<int> window_messages{0};
+    };
+
+    class RiskChecker : public BookListener {
+        public:
+            RiskChecker() {}
+            RiskChecker(RiskLimits limits) : limits(limits) {}
+
+            void set_limits(RiskLimits new_limits) { limits = new_limits; }
+            RiskLimits get_limits() const { return limits; }
+
+            RiskResult check(Order& o, double best_bid, double best_offer, Timestamp now);
+
+            // Zero for clients not seen yet, which aren't added. Only for the
+            //     matching thread, or once it has stopped.
+            long get_position(const std::string& client) const;
+            long get_open_quantity(const std::string& client, OrderSide side) const;
+
+            void on_trade(const Trade& t) override;
+            void on_order_closed(Order& o) override;
+
+            static std::string describe(RiskResult result);
+        private:
+            ClientRisk& client_state(const std::string& client);
+            bool throttled(ClientRisk& state, Timestamp now);
+
+            RiskLimits limits;
+
+            std::unordered_map<std::string, ClientRisk> clients;
+    };
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include "stop_book.h"
+
+namespace exchange {
+    void StopBook::add(Order& o) {
+        if (o.is_buy()) {
+            buy_stops.emplace(o.get_stop_price(), &o);
+        } else {
+            sell_stops.emplace(o.get_stop_price(), &o);
+        }
+    }
+
+    bool StopBook::remove(Order& o) {
+        /*
+         * Take a waiting stop order out of the index.
+         *
+         * Returns false when the order isn't waiting here.
+         */
+        if (o.is_buy()) {
+            auto range = buy_stops.equal_range(o.get_stop_price());
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == &o) {
+                    buy_stops.erase(it);
+                    return true;
+                }
+            }
+        } else {
+            auto range = sell_stops.equal_range(o.get_stop_price());
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == &o) {
+                    sell_stops.erase(it);
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void StopBook::trigger(double low, double high, std::deque<Order*>& triggered) {
+        /*
+         * Move every stop triggered by trades between low and high onto the
+         * back of triggered.
+         *
+         * Buy stops come first, lowest stop price first, then sell stops,
+         * highest stop price first. Stops with the same price keep the order
+         * they arrived in.
+         */
+        auto last_buy = buy_stops.upper_bound(high);
+        for (auto it = buy_stops.begin(); it != last_buy; ++it) {
+            triggered.push_back(it->second);
+        }
+        buy_stops.erase(buy_stops.begin(), last_buy);
+
+        auto last_sell = sell_stops.upper_bound(low);
+        for (auto it = sell_stops.begin(); it != last_sell; ++it) {
+            triggered.push_back(it->second);
+        }
+        sell_stops.erase(sell_stops.begin(), last_sell);
+    }
+}
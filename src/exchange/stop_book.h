@@ -0,0 +1,45 @@
+#ifndef STOP_BOOK_H
+#define STOP_BOOK_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+
+#include "order.h"
+
+namespace exchange {
+    class StopBook {
+        /*
+         * Stop orders waiting for the market to trade through their stop
+         * price, indexed by that price.
+         *
+         * Buy stops trigger when a trade prints at or above their stop price
+         * and sell stops when a trade prints at or below it, so the triggered
+         * orders are always a prefix of one index and are found in
+         * O(log n + k) however many stops are waiting.
+         */
+        public:
+            void add(Order& o);
+            bool remove(Order& o);
+
+            void trigger(double low, double high, std::deque<Order*>& triggered);
+
+            size_t size() const { return buy_stops.size() + sell_stops.size(); }
+
+            // Visit every waiting stop, buys then sells, in trigger order
+            template <typename Visitor>
+            void for_each(Visitor visit) const {
+                for (auto& stop : buy_stops) { visit(*stop.second); }
+                for (auto& stop : sell_stops) { visit(*stop.second); }
+            }
+
+        private:
+            // Lowest stop price first, then arrival
+            std::multimap<double, Order*> buy_stops;
+            // Highest stop price first, then arrival
+            std::multimap<double, Order*, std::greater<double>> sell_stops;
+    };
+}
+
+#endif
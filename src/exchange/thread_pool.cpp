@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <utility>
+
+#include "thread_pool.h"
+
+namespace exchange {
+    WorkStealingPool::WorkStealingPool(size_t thread_count) {
+        thread_count = std::max<size_t>(1, thread_count);
+
+        for (size_t i = 0; i < thread_count; i++) {
+            workers.emplace_back(new Worker());
+        }
+
+        for (size_t i = 0; i < thread_count; i++) {
+            threads.emplace_back(&WorkStealingPool::work, this, i);
+        }
+    }
+
+    WorkStealingPool::~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        work_ready.notify_all();
+
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    void WorkStealingPool::submit(Task task) {
+        Worker& worker = *workers[next_worker];
+        next_worker = (next_worker + 1) % workers.size();
+
+        {
+            // Counted under the same lock, so a thread that takes the task
+            //     straight away can't uncount it first
+            std::lock_guard<std::mutex> guard(lock);
+            {
+                std::lock_guard<std::mutex> worker_guard(worker.lock);
+                worker.tasks.push_back(std::move(task));
+            }
+
+            queued++;
+            unfinished++;
+        }
+        work_ready.notify_one();
+    }
+
+    void WorkStealingPool::wait() {
+        std::unique_lock<std::mutex> guard(lock);
+        work_done.wait(guard, [this]() { return unfinished == 0; });
+    }
+
+    bool WorkStealingPool::take(size_t index, Task& task) {
+        /*
+         * Take the next task from the thread's own queue, or steal the
+         * last one from the first other queue that has any.
+         */
+        for (size_t i = 0; i < workers.size(); i++) {
+            size_t victim = (index + i) % workers.size();
+            Worker& worker = *workers[victim];
+
+            std::lock_guard<std::mutex> guard(worker.lock);
+            if (worker.tasks.empty()) {
+                continue;
+            }
+
+            if (victim == index) {
+                task = std::move(worker.tasks.front());
+                worker.tasks.pop_front();
+            } else {
+                task = std::move(worker.tasks.back());
+                worker.tasks.pop_back();
+                steals.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void WorkStealingPool::work(size_t index) {
+        for (;;) {
+            Task task;
+            if (take(index, task)) {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    queued--;
+                }
+
+                task();
+
+                bool done;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    done = (--unfinished == 0);
+                }
+                if (done) {
+                    work_done.notify_all();
+                }
+                continue;
+            }
+
+            // Another thread may have taken the task that was counted, in
+            //     which case this one goes back to waiting
+            std::unique_lock<std::mutex> guard(lock);
+            work_ready.wait(guard, [this]() { return stopping || queued > 0; });
+            if (stopping && queued == 0) {
+                return;
+            }
+        }
+    }
+}
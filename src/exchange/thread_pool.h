@@ -0,0 +1,73 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace exchange {
+    class WorkStealingPool {
+        /*
+         * A fixed set of threads running coarse tasks, e.g. one whole book
+         * of a backtest each.
+         *
+         * Every thread has its own queue and tasks are dealt out to them in
+         * turn. A thread works through its own queue from the front and,
+         * once that is empty, steals from the back of another's, so a
+         * thread that drew a long task doesn't hold up the work queued
+         * behind it. Tasks submitted longest first are then spread about
+         * as evenly as they can be.
+         */
+        public:
+            typedef std::function<void()> Task;
+
+            WorkStealingPool(size_t thread_count);
+            ~WorkStealingPool();
+
+            WorkStealingPool(const WorkStealingPool&) = delete;
+            WorkStealingPool& operator =(const WorkStealingPool&) = delete;
+
+            void submit(Task task);
+
+            // Block until every task submitted so far has finished
+            void wait();
+
+            size_t get_thread_count() const { return threads.size(); }
+
+            // Tasks run by a thread other than the one they were given to
+            uint64_t get_steals() const { return steals.load(std::memory_order_relaxed); }
+        private:
+            struct Worker {
+                std::mutex lock;
+                std::deque<Task> tasks;
+            };
+
+            bool take(size_t index, Task& task);
+            void work(size_t index);
+
+            std::vector<std::unique_ptr<Worker>> workers;
+            std::vector<std::thread> threads;
+            size_t next_worker = 0;
+
+            // Guards the counts below, which the condition variables wait on
+            std::mutex lock;
+            std::condition_variable work_ready;
+            std::condition_variable work_done;
+
+            // Tasks waiting in a queue, and tasks not yet finished
+            size_t queued = 0;
+            size_t unfinished = 0;
+            bool stopping = false;
+
+            std::atomic<uint64_t> steals{0};
+    };
+}
+
+#endif
@@ -5,15 +5,14 @@
 
 namespace exchange {
     Trade::Trade(std::string instrument, double price, int size, OrderSide side,
-          Client maker, Client taker)
+          Client maker, Client taker, Timestamp trade_time)
         : instrument(instrument)
         , price(price)
         , size(size)
         , side(side)
         , maker(maker)
-        , taker(taker) {
-            trade_time = std::chrono::high_resolution_clock::now();
-    }
+        , taker(taker)
+        , trade_time(trade_time) {}
 
     long Trade::get_trade_time_ms() const {
         auto now_ms = std::chrono::time_point_cast<std::chrono::milliseconds>(get_trade_time());
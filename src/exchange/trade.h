@@ -13,12 +13,12 @@ namespace exchange {
     class Trade {
         public:
             Trade(std::string instrument, double price, int size, OrderSide side,
-                  Client maker, Client taker);
+                  Client maker, Client taker, Timestamp trade_time = Timestamp());
 
-            std::string get_instrument() { return instrument; }
-            double get_price() { return price; }
-            int get_size() { return size; }
-            OrderSide get_side() { return side; }
+            std::string get_instrument() const { return instrument; }
+            double get_price() const { return price; }
+            int get_size() const { return size; }
+            OrderSide get_side() const { return side; }
             Client get_maker() const { return maker; }
             Client get_taker() const { return taker; }
 
@@ -0,0 +1,388 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "trade_export.h"
+
+namespace exchange {
+    // Start of every export file, the last byte being the format version
+    const char EXPORT_MAGIC[4] = {'L', 'T', 'X', '1'};
+
+    const char TRADE_BLOCK = 'T';
+    const char ORDER_BLOCK = 'O';
+
+    static void put_varint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back((char) ((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back((char) value);
+    }
+
+    // Differences can be negative, so they are zigzag encoded to keep
+    //     small negative values small
+    static void put_delta(std::string& out, long long delta) {
+        put_varint(out, ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63));
+    }
+
+    static void put_column(std::string& out, const std::string& column) {
+        put_varint(out, column.size());
+        out += column;
+    }
+
+    static bool get_varint(const std::string& in, size_t& position, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && position < in.size(); shift += 7) {
+            uint8_t byte = (uint8_t) in[position++];
+            value |= (uint64_t) (byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static bool get_delta(const std::string& in, size_t& position, long long& delta) {
+        uint64_t value;
+        if (!get_varint(in, position, value)) { return false; }
+
+        delta = (long long) (value >> 1) ^ -(long long) (value & 1);
+        return true;
+    }
+
+    static bool read_varint(std::istream& in, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int byte = in.get();
+            if (byte == EOF) { return false; }
+
+            value |= (uint64_t) (byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static long long to_ns(Timestamp time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    static long long to_ticks(double price) {
+        return std::llround(price * EXPORT_PRICE_SCALE);
+    }
+
+    TradeExporter::~TradeExporter() {
+        close();
+    }
+
+    bool TradeExporter::open(const std::string& path, bool with_orders) {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Failed to open export file " << path << std::endl;
+            return false;
+        }
+
+        file.write(EXPORT_MAGIC, sizeof(EXPORT_MAGIC));
+        include_orders = with_orders;
+        closing = false;
+
+        writer = std::thread(&TradeExporter::write_batches, this);
+        return true;
+    }
+
+    void TradeExporter::on_trade(const Trade& t) {
+        if (!is_open()) { return; }
+
+        ExportedTrade row;
+        row.instrument = t.get_instrument();
+        row.price = t.get_price();
+        row.size = t.get_size();
+        row.side = t.get_side();
+        row.maker = t.get_maker().get_name();
+        row.taker = t.get_taker().get_name();
+        row.time_ns = to_ns(t.get_trade_time());
+        pending.trades.push_back(std::move(row));
+
+        if (pending.trades.size() + pending.orders.size() >= batch_size) {
+            hand_off();
+        }
+    }
+
+    void TradeExporter::on_order_closed(Order& o) {
+        if (!is_open() || !include_orders) { return; }
+
+        ExportedOrder row;
+        row.instrument = o.get_instrument();
+        row.client = o.get_client().get_name();
+        row.price = o.get_price();
+        row.size = o.effective_size();
+        row.side = o.get_side();
+        row.status = o.get_status();
+        row.sequence = o.get_sequence();
+        row.time_ns = to_ns(o.get_order_time());
+        pending.orders.push_back(std::move(row));
+
+        if (pending.trades.size() + pending.orders.size() >= batch_size) {
+            hand_off();
+        }
+    }
+
+    void TradeExporter::flush() {
+        if (is_open() && (!pending.trades.empty() || !pending.orders.empty())) {
+            hand_off();
+        }
+    }
+
+    void TradeExporter::close() {
+        if (!is_open()) { return; }
+
+        flush();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            closing = true;
+        }
+        ready.notify_one();
+
+        writer.join();
+        file.close();
+    }
+
+    void TradeExporter::hand_off() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            batches.push_back(std::move(pending));
+        }
+        ready.notify_one();
+
+        pending = Batch();
+        pending.trades.reserve(batch_size);
+    }
+
+    void TradeExporter::write_batches() {
+        /*
+         * Runs on the writer thread until closed, writing batches in the
+         * order they were handed over and then whatever is left.
+         */
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            ready.wait(guard, [this]() { return closing || !batches.empty(); });
+            if (batches.empty()) { break; }
+
+            Batch batch = std::move(batches.front());
+            batches.pop_front();
+            guard.unlock();
+
+            if (!batch.trades.empty()) {
+                write_block(TRADE_BLOCK, batch.trades.size(), encode_trades(batch.trades));
+            }
+            if (!batch.orders.empty()) {
+                write_block(ORDER_BLOCK, batch.orders.size(), encode_orders(batch.orders));
+            }
+
+            file.flush();
+            guard.lock();
+        }
+    }
+
+    void TradeExporter::write_block(char kind, size_t rows, const std::string& columns) {
+        // The strings first used in this block come before its columns
+        std::string header(1, kind);
+        put_varint(header, rows);
+        put_varint(header, new_strings.size());
+        for (auto& value : new_strings) {
+            put_varint(header, value.size());
+            header += value;
+        }
+        new_strings.clear();
+
+        file.write(header.data(), header.size());
+        file.write(columns.data(), columns.size());
+
+        if (!file) {
+            std::cerr << "Failed to write to export file" << std::endl;
+            return;
+        }
+
+        rows_written.fetch_add(rows, std::memory_order_relaxed);
+    }
+
+    uint64_t TradeExporter::intern(const std::string& value) {
+        auto it = dictionary.find(value);
+        if (it != dictionary.end()) {
+            return it->second;
+        }
+
+        uint64_t id = dictionary.size();
+        dictionary[value] = id;
+        new_strings.push_back(value);
+
+        return id;
+    }
+
+    std::string TradeExporter::encode_trades(const std::vector<ExportedTrade>& trades) {
+        std::string times, prices, sizes, sides, instruments, makers, takers;
+
+        long long last_time = 0;
+        long long last_price = 0;
+        for (auto& t : trades) {
+            long long price = to_ticks(t.price);
+            put_delta(times, t.time_ns - last_time);
+            put_delta(prices, price - last_price);
+            last_time = t.time_ns;
+            last_price = price;
+
+            put_varint(sizes, t.size);
+            sides.push_back((char) t.side);
+            put_varint(instruments, intern(t.instrument));
+            put_varint(makers, intern(t.maker));
+            put_varint(takers, intern(t.taker));
+        }
+
+        std::string columns;
+        for (auto column : {&times, &prices, &sizes, &sides, &instruments, &makers, &takers}) {
+            put_column(columns, *column);
+        }
+
+        return columns;
+    }
+
+    std::string TradeExporter::encode_orders(const std::vector<ExportedOrder>& orders) {
+        std::string times, prices, sizes, sides, statuses, instruments, clients, sequences;
+
+        long long last_time = 0;
+        long long last_price = 0;
+        long long last_sequence = 0;
+        for (auto& o : orders) {
+            long long price = to_ticks(o.price);
+            put_delta(times, o.time_ns - last_time);
+            put_delta(prices, price - last_price);
+            put_delta(sequences, (long long) o.sequence - last_sequence);
+            last_time = o.time_ns;
+            last_price = price;
+            last_sequence = (long long) o.sequence;
+
+            put_varint(sizes, o.size);
+            sides.push_back((char) o.side);
+            statuses.push_back((char) o.status);
+            put_varint(instruments, intern(o.instrument));
+            put_varint(clients, intern(o.client));
+        }
+
+        std::string columns;
+        for (auto column : {&times, &prices, &sizes, &sides, &statuses, &instruments, &clients, &sequences}) {
+            put_column(columns, *column);
+        }
+
+        return columns;
+    }
+
+    bool ExportReader::open(const std::string& path) {
+        file.open(path, std::ios::binary);
+
+        char magic[sizeof(EXPORT_MAGIC)];
+        if (!file.read(magic, sizeof(magic)) ||
+            std::string(magic, sizeof(magic)) != std::string(EXPORT_MAGIC, sizeof(EXPORT_MAGIC))) {
+            std::cerr << "Not an export file " << path << std::endl;
+            return false;
+        }
+
+        dictionary.clear();
+        return true;
+    }
+
+    bool ExportReader::read_block(std::vector<ExportedTrade>& trades, std::vector<ExportedOrder>& orders) {
+        int kind = file.get();
+        if (kind != TRADE_BLOCK && kind != ORDER_BLOCK) {
+            return false;
+        }
+
+        uint64_t rows, strings;
+        if (!read_varint(file, rows) || !read_varint(file, strings)) { return false; }
+
+        for (uint64_t i = 0; i < strings; i++) {
+            uint64_t length;
+            if (!read_varint(file, length)) { return false; }
+
+            std::string value(length, '\0');
+            if (!file.read(&value[0], length)) { return false; }
+            dictionary.push_back(value);
+        }
+
+        size_t column_count = (kind == TRADE_BLOCK) ? 7 : 8;
+        std::vector<std::string> columns(column_count);
+        std::vector<size_t> positions(column_count, 0);
+        for (auto& column : columns) {
+            uint64_t length;
+            if (!read_varint(file, length)) { return false; }
+
+            column.resize(length);
+            if (length > 0 && !file.read(&column[0], length)) { return false; }
+        }
+
+        auto varint = [&](size_t c, uint64_t& value) {
+            return get_varint(columns[c], positions[c], value);
+        };
+        auto delta = [&](size_t c, long long& value) {
+            long long difference;
+            if (!get_delta(columns[c], positions[c], difference)) { return false; }
+
+            value += difference;
+            return true;
+        };
+        auto byte = [&](size_t c, int& value) {
+            if (positions[c] >= columns[c].size()) { return false; }
+
+            value = (uint8_t) columns[c][positions[c]++];
+            return true;
+        };
+        auto text = [&](size_t c, std::string& value) {
+            uint64_t id;
+            if (!varint(c, id) || id >= dictionary.size()) { return false; }
+
+            value = dictionary[id];
+            return true;
+        };
+
+        long long time = 0;
+        long long price = 0;
+        long long sequence = 0;
+        for (uint64_t i = 0; i < rows; i++) {
+            uint64_t size;
+            int side, status;
+
+            if (kind == TRADE_BLOCK) {
+                ExportedTrade t;
+                if (!delta(0, time) || !delta(1, price) || !varint(2, size) || !byte(3, side) ||
+                    !text(4, t.instrument) || !text(5, t.maker) || !text(6, t.taker)) {
+                    return false;
+                }
+
+                t.time_ns = time;
+                t.price = (double) price / EXPORT_PRICE_SCALE;
+                t.size = (int) size;
+                t.side = (OrderSide) side;
+                trades.push_back(std::move(t));
+            } else {
+                ExportedOrder o;
+                if (!delta(0, time) || !delta(1, price) || !varint(2, size) || !byte(3, side) ||
+                    !byte(4, status) || !text(5, o.instrument) || !text(6, o.client) ||
+                    !delta(7, sequence)) {
+                    return false;
+                }
+
+                o.time_ns = time;
+                o.price = (double) price / EXPORT_PRICE_SCALE;
+                o.size = (int) size;
+                o.side = (OrderSide) side;
+                o.status = (OrderStatus) status;
+                o.sequence = (uint64_t) sequence;
+                orders.push_back(std::move(o));
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,145 @@
+#ifndef TRADE_EXPORT_H
+#define TRADE_EXPORT_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "listener.h"
+#include "order.h"
+#include "trade.h"
+
+namespace exchange {
+    // Prices are exported as whole multiples of 1 / EXPORT_PRICE_SCALE,
+    //     the same 4 decimal places the order protocol carries
+    const long long EXPORT_PRICE_SCALE = 10000;
+
+    struct ExportedTrade {
+        std::string instrument;
+        double price = 0.0;
+        int size = 0;
+        OrderSide side = BUY;
+        std::string maker;
+        std::string taker;
+
+        // Nanoseconds since the epoch
+        long long time_ns = 0;
+    };
+
+    struct ExportedOrder {
+        // An order that closed with quantity left, e.g. cancelled or the
+        //     remainder of an IOC
+        std::string instrument;
+        std::string client;
+        double price = 0.0;
+
+        // Quantity left unfilled when the order closed
+        int size = 0;
+
+        OrderSide side = BUY;
+        OrderStatus status = CANCELLED;
+        uint64_t sequence = 0;
+
+        // Time the order reached its book, in nanoseconds since the epoch
+        long long time_ns = 0;
+    };
+
+    class TradeExporter : public BookListener {
+        /*
+         * Streams trades, and optionally closed orders, to a columnar
+         * binary file as the books produce them.
+         *
+         * The matching thread only copies each event into the current
+         * batch. Full batches are handed to a background thread that
+         * encodes and writes them, so matching never waits on the disk.
+         *
+         * The file is a four byte header followed by blocks of rows of one
+         * kind. Each block starts with its kind, its row count and the
+         * strings it adds to the dictionary shared by the whole file, then
+         * holds one column after another, each prefixed with its length.
+         * Instruments and clients are written as dictionary IDs, times,
+         * prices and order sequences as the varint difference from the row
+         * before and everything else as varints or single bytes.
+         */
+        public:
+            TradeExporter(size_t batch_size = 4096) : batch_size(batch_size) {}
+            ~TradeExporter();
+
+            TradeExporter(const TradeExporter&) = delete;
+            TradeExporter& operator =(const TradeExporter&) = delete;
+
+            bool open(const std::string& path, bool with_orders);
+
+            // Hand over the current batch, even if it isn't full
+            void flush();
+
+            // Write everything handed over so far and close the file
+            void close();
+
+            bool is_open() const { return writer.joinable(); }
+
+            // Rows written to the file so far, for any thread
+            size_t get_rows_written() const { return rows_written.load(std::memory_order_relaxed); }
+
+            void on_trade(const Trade& t) override;
+            void on_order_closed(Order& o) override;
+        private:
+            struct Batch {
+                std::vector<ExportedTrade> trades;
+                std::vector<ExportedOrder> orders;
+            };
+
+            void hand_off();
+            void write_batches();
+            void write_block(char kind, size_t rows, const std::string& columns);
+
+            std::string encode_trades(const std::vector<ExportedTrade>& trades);
+            std::string encode_orders(const std::vector<ExportedOrder>& orders);
+            uint64_t intern(const std::string& value);
+
+            size_t batch_size;
+            bool include_orders = false;
+
+            // Only touched by the matching thread
+            Batch pending;
+
+            std::mutex lock;
+            std::condition_variable ready;
+            std::deque<Batch> batches;
+            bool closing = false;
+
+            // Only touched by the writer thread
+            std::thread writer;
+            std::ofstream file;
+            std::unordered_map<std::string, uint64_t> dictionary;
+            std::vector<std::string> new_strings;
+
+            std::atomic<size_t> rows_written{0};
+    };
+
+    class ExportReader {
+        /*
+         * Reads back a file written by TradeExporter one block at a time.
+         */
+        public:
+            bool open(const std::string& path);
+
+            // Appends the rows of the next block, returning false at the end
+            //     of the file or when the file is damaged
+            bool read_block(std::vector<ExportedTrade>& trades, std::vector<ExportedOrder>& orders);
+
+        private:
+            std::ifstream file;
+            std::vector<std::string> dictionary;
+    };
+}
+
+#endif
@@ -0,0 +1,181 @@
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "low_latency.h"
+#include "shm_ring.h"
+#include "tcp_gateway.h"
+
+using std::placeholders::_1;
+using std::placeholders::_2;
+
+// Address sessions are accepted on
+const std::string GATEWAY_ADDRESS = "0.0.0.0";
+
+// Empty polls of the reply ring before the reply thread yields
+const long REPLY_SPIN_LIMIT = 10000;
+
+struct gateway_config {
+    // Name the matching engine was started with, as --ipc-ring=<name>
+    std::string ring;
+
+    // Identifies this gateway's sessions to the matching engine, from 1
+    uint32_t gateway_id = 1;
+
+    uint16_t tcp_port = 0;
+    bool busy_poll = false;
+
+    int gateway_cpu = -1;
+    int reply_cpu = -1;
+};
+
+class ipc_gateway {
+    /*
+     * A TCP order entry gateway in its own process, feeding the matching
+     * engine of a server started with --ipc-ring through shared memory.
+     *
+     * Messages from sessions are tagged with the gateway and session they
+     * came from and published to this gateway's own request ring. A second
+     * thread follows this gateway's own reply ring, which the engine
+     * never overwrites before it is released, and passes the replies on.
+     */
+public:
+    ipc_gateway(gateway_config config)
+        : m_config(config)
+        , m_gateway(std::bind(&ipc_gateway::on_message, this, _1, _2), config.busy_poll)
+        , m_running(false) {}
+
+    bool open() {
+        std::string suffix = "." + std::to_string(m_config.gateway_id);
+        if (!m_requests.open(m_config.ring + ".requests" + suffix) ||
+            !m_replies.open(m_config.ring + ".replies" + suffix)) {
+            return false;
+        }
+
+        // This gateway is the only publisher of its request ring, so it
+        //     finishes whatever an earlier run was part way through
+        m_requests.recover();
+
+        return m_gateway.listen(GATEWAY_ADDRESS, m_config.tcp_port);
+    }
+
+    void run() {
+        m_running.store(true, std::memory_order_release);
+        std::thread replies(&ipc_gateway::reply_loop, this);
+
+        exchange::pin_thread(m_config.gateway_cpu);
+        m_gateway.run();
+
+        m_running.store(false, std::memory_order_release);
+        replies.join();
+    }
+private:
+    void on_message(uint64_t session, const std::string& payload) {
+        // Called from the gateway thread
+        std::string message = exchange::encode_routed(m_config.gateway_id, session, payload);
+        if (message.size() > m_requests.get_max_message_size()) {
+            m_gateway.send(session, "REJ|TOO_LARGE");
+            return;
+        }
+
+        // Wait for the matching engine to make room rather than drop the message
+        while (!m_requests.publish(message)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void reply_loop() {
+        exchange::pin_thread(m_config.reply_cpu);
+        exchange::WaitStrategy wait(REPLY_SPIN_LIMIT);
+
+        // Replies left for the sessions of an earlier run of this gateway
+        //     have nowhere to go
+        uint64_t next = m_replies.get_last_sequence() + 1;
+        m_replies.release(next - 1);
+
+        while (m_running.load(std::memory_order_acquire)) {
+            const char* data;
+            size_t size;
+            if (m_replies.peek(next, &data, &size) != exchange::SHM_READY) {
+                wait.idle();
+                continue;
+            }
+
+            wait.reset();
+
+            uint32_t gateway;
+            uint64_t session;
+            const char* payload;
+            size_t payload_size;
+            if (exchange::decode_routed(data, size, &gateway, &session, &payload, &payload_size)) {
+                m_gateway.send(session, std::string(payload, payload_size));
+            }
+
+            // The engine may reuse the slot once the reply has been sent
+            m_replies.release(next++);
+        }
+    }
+
+    gateway_config m_config;
+
+    exchange::ShmRing m_requests;
+    exchange::ShmRing m_replies;
+    exchange::TcpGateway m_gateway;
+
+    std::atomic<bool> m_running;
+};
+
+bool parse_option(const std::string& arg, const std::string& name, std::string& value) {
+    /*
+     * Matches command line arguments of the form --name=value.
+     */
+    std::string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    gateway_config config;
+
+    for (int a = 1; a < argc; a++) {
+        std::string arg(argv[a]);
+        std::string value;
+
+        if (parse_option(arg, "ring", value)) {
+            config.ring = value;
+        } else if (parse_option(arg, "gateway-id", value)) {
+            config.gateway_id = std::stoul(value);
+        } else if (parse_option(arg, "tcp-port", value)) {
+            config.tcp_port = std::stoi(value);
+        } else if (parse_option(arg, "gateway-cpu", value)) {
+            config.gateway_cpu = std::stoi(value);
+        } else if (parse_option(arg, "reply-cpu", value)) {
+            config.reply_cpu = std::stoi(value);
+        } else if (arg == "--tcp-busy-poll") {
+            config.busy_poll = true;
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (config.ring.empty() || config.tcp_port == 0 || config.gateway_id == 0) {
+        std::cerr << "A --ring, a --tcp-port and a --gateway-id above 0 are needed" << std::endl;
+        return 1;
+    }
+
+    ipc_gateway gateway(config);
+    if (!gateway.open()) {
+        return 1;
+    }
+
+    std::cout << "Gateway " << config.gateway_id << " feeding " << config.ring
+              << " from port " << config.tcp_port << std::endl;
+    gateway.run();
+}
@@ -0,0 +1,497 @@
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+
+#include "client.h"
+#include "order.h"
+
+typedef websocketpp::client<websocketpp::config::asio_client> client;
+typedef std::chrono::steady_clock Clock;
+
+using websocketpp::connection_hdl;
+using websocketpp::lib::placeholders::_1;
+using websocketpp::lib::placeholders::_2;
+using websocketpp::lib::bind;
+
+const std::string DEFAULT_URI = "ws://localhost:9000";
+
+// Orders are spread over a few ticks either side of the mid price so
+//     that some of them cross and trade
+const std::string INSTRUMENT = "ABC";
+const double MID_PRICE = 100.00;
+const double TICK = 0.01;
+const int PRICE_LEVELS = 10;
+const int CROSSING_LEVELS = 2;
+const int MAX_ORDER_SIZE = 100;
+
+// Acknowledged order IDs each connection remembers for cancels
+const size_t CANCELLABLE_ORDERS = 64;
+
+// How often each thread checks whether more messages are due
+const long PACING_INTERVAL_MS = 1;
+
+struct loadgen_config {
+    std::string uri = DEFAULT_URI;
+
+    int connections = 100;
+    int threads = 1;
+
+    // Messages per second across all connections, or 0 to send as fast
+    //     as the server replies
+    long rate = 1000;
+    int duration = 10;
+
+    // Most requests a connection may have waiting for a reply
+    size_t pipeline = 8;
+
+    // Percentages of orders and cancels, the rest are queries
+    int order_percent = 70;
+    int cancel_percent = 20;
+};
+
+enum request_kind {
+    ORDER,
+    CANCEL,
+    QUERY
+};
+
+struct latency_stats {
+    // Latencies in nanoseconds
+    std::vector<long> order_ack;
+    std::vector<long> fill;
+    std::vector<long> cancel;
+    std::vector<long> query;
+
+    long sent = 0;
+    long rejected = 0;
+    long passive_fills = 0;
+    long cancels_rejected = 0;
+    long failed_connections = 0;
+
+    void merge(const latency_stats& other) {
+        order_ack.insert(order_ack.end(), other.order_ack.begin(), other.order_ack.end());
+        fill.insert(fill.end(), other.fill.begin(), other.fill.end());
+        cancel.insert(cancel.end(), other.cancel.begin(), other.cancel.end());
+        query.insert(query.end(), other.query.begin(), other.query.end());
+
+        sent += other.sent;
+        rejected += other.rejected;
+        passive_fills += other.passive_fills;
+        cancels_rejected += other.cancels_rejected;
+        failed_connections += other.failed_connections;
+    }
+};
+
+struct pending_request {
+    request_kind kind;
+    Clock::time_point sent;
+};
+
+struct connection_state {
+    connection_hdl hdl;
+    std::string name;
+    bool open = false;
+
+    // Replies come back in the order requests were sent
+    std::deque<pending_request> pending;
+
+    std::deque<uint64_t> order_ids;
+
+    // When the last acknowledged order was sent, fills that follow its
+    //     ACK are from that order trading on arrival
+    Clock::time_point last_order_sent;
+
+    int next_query = 0;
+};
+
+class load_thread {
+    /*
+     * Drives a share of the connections from one thread with its own
+     * websocketpp client and io_service, so threads never share state
+     * until their statistics are merged at the end.
+     */
+public:
+    load_thread(const loadgen_config& config, int index, int connections)
+        : m_config(config), m_connections(connections), m_random(index) {
+        m_client.clear_access_channels(websocketpp::log::alevel::all);
+        m_client.clear_error_channels(websocketpp::log::elevel::all);
+        m_client.init_asio();
+
+        for (int c = 0; c < connections; c++) {
+            std::stringstream name;
+            name << "load" << index << "_" << c;
+            m_connections[c].name = name.str();
+        }
+
+        // A share of the rate in messages per second, kept fractional so
+        //     that a low rate spread over many threads never becomes 0,
+        //     which would leave the thread unpaced
+        m_paced = config.rate > 0;
+        if (config.connections > 0) {
+            m_rate = (double) config.rate * connections / config.connections;
+        }
+    }
+
+    void run() {
+        for (size_t c = 0; c < m_connections.size(); c++) {
+            websocketpp::lib::error_code ec;
+            client::connection_ptr con = m_client.get_connection(m_config.uri, ec);
+            if (ec) {
+                std::cerr << "Failed to create connection: " << ec.message() << std::endl;
+                m_stats.failed_connections++;
+                continue;
+            }
+
+            con->set_open_handler(bind(&load_thread::on_open,this,c,::_1));
+            con->set_fail_handler(bind(&load_thread::on_fail,this,c,::_1));
+            con->set_close_handler(bind(&load_thread::on_close,this,c,::_1));
+            con->set_message_handler(bind(&load_thread::on_message,this,c,::_1,::_2));
+
+            m_connections[c].hdl = con->get_handle();
+            m_client.connect(con);
+        }
+
+        m_start = Clock::now();
+        m_end = m_start + std::chrono::seconds(m_config.duration);
+        m_client.set_timer(PACING_INTERVAL_MS, bind(&load_thread::on_tick,this,::_1));
+
+        // Returns once every connection has closed and the timer has stopped
+        m_client.run();
+    }
+
+    const latency_stats& get_stats() const { return m_stats; }
+private:
+    void on_open(size_t c, connection_hdl) {
+        m_connections[c].open = true;
+
+        if (!m_paced) {
+            fill_pipeline(m_connections[c]);
+        }
+    }
+
+    void on_fail(size_t c, connection_hdl) {
+        m_connections[c].open = false;
+        m_stats.failed_connections++;
+    }
+
+    void on_close(size_t c, connection_hdl) {
+        m_connections[c].open = false;
+    }
+
+    void on_tick(websocketpp::lib::error_code const& ec) {
+        if (ec) {
+            return;
+        }
+
+        Clock::time_point now = Clock::now();
+        if (now >= m_end) {
+            stop();
+            return;
+        }
+
+        if (m_paced) {
+            // Catch up with the target rate, skipping connections that
+            //     already have a full pipeline
+            double elapsed = std::chrono::duration<double>(now - m_start).count();
+            long due = (long) (m_rate * elapsed) - m_stats.sent;
+
+            for (size_t tried = 0; due > 0 && tried < m_connections.size(); tried++) {
+                connection_state& c = m_connections[m_next];
+                m_next = (m_next + 1) % m_connections.size();
+
+                if (c.open && c.pending.size() < m_config.pipeline) {
+                    send_next(c);
+                    due--;
+                    tried = 0;
+                }
+            }
+        }
+
+        m_client.set_timer(PACING_INTERVAL_MS, bind(&load_thread::on_tick,this,::_1));
+    }
+
+    void stop() {
+        m_stopping = true;
+
+        for (auto& c : m_connections) {
+            if (!c.open) {
+                continue;
+            }
+
+            websocketpp::lib::error_code ec;
+            m_client.close(c.hdl, websocketpp::close::status::going_away, "", ec);
+        }
+    }
+
+    void fill_pipeline(connection_state& c) {
+        while (c.open && !m_stopping && c.pending.size() < m_config.pipeline) {
+            send_next(c);
+        }
+    }
+
+    void send_next(connection_state& c) {
+        /*
+         * Send the next message of the configured mix. Cancels need an
+         * order to cancel, so they become orders until one is acknowledged.
+         */
+        int roll = std::uniform_int_distribution<int>(0, 99)(m_random);
+
+        request_kind kind = ORDER;
+        std::string message;
+        if (roll >= m_config.order_percent + m_config.cancel_percent) {
+            kind = QUERY;
+            message = next_query(c);
+        } else if (roll >= m_config.order_percent && !c.order_ids.empty()) {
+            kind = CANCEL;
+
+            size_t i = std::uniform_int_distribution<size_t>(0, c.order_ids.size() - 1)(m_random);
+            message = "c|" + std::to_string(c.order_ids[i]);
+            c.order_ids.erase(c.order_ids.begin() + i);
+        } else {
+            message = next_order(c);
+        }
+
+        websocketpp::lib::error_code ec;
+        m_client.send(c.hdl, message, websocketpp::frame::opcode::text, ec);
+        if (ec) {
+            return;
+        }
+
+        c.pending.push_back({kind, Clock::now()});
+        m_stats.sent++;
+    }
+
+    std::string next_order(connection_state& c) {
+        bool buy = std::uniform_int_distribution<int>(0, 1)(m_random) == 1;
+        int level = std::uniform_int_distribution<int>(-CROSSING_LEVELS, PRICE_LEVELS)(m_random);
+        int size = std::uniform_int_distribution<int>(1, MAX_ORDER_SIZE)(m_random);
+
+        // Buys sit below the mid price and sells above it, apart from the
+        //     few levels that cross
+        double price = buy ? MID_PRICE - level * TICK : MID_PRICE + level * TICK;
+
+        exchange::Order o(INSTRUMENT.c_str(), price, size,
+                          buy ? exchange::BUY : exchange::SELL, exchange::Client(c.name));
+        return exchange::Order::serialize(o);
+    }
+
+    std::string next_query(connection_state& c) {
+        // Broadcast top of book messages look like bbbo replies, so only
+        //     queries with replies of their own are used
+        switch (c.next_query++ % 3) {
+            case 0: return "bb";
+            case 1: return "bo";
+            default: return "st|" + INSTRUMENT;
+        }
+    }
+
+    void on_message(size_t index, connection_hdl, client::message_ptr msg) {
+        connection_state& c = m_connections[index];
+        const std::string& payload = msg->get_payload();
+        Clock::time_point now = Clock::now();
+
+        if (payload.compare(0, 2, "t|") == 0) {
+            on_trade(c, payload, now);
+            return;
+        }
+
+        bool reply = payload.compare(0, 4, "ACK|") == 0 || payload.compare(0, 4, "REJ|") == 0 ||
+                     payload.compare(0, 2, "c|") == 0 || payload.compare(0, 3, "bb|") == 0 ||
+                     payload.compare(0, 3, "bo|") == 0 || payload.compare(0, 3, "st|") == 0;
+
+        // Anything else is broadcast market data
+        if (!reply || c.pending.empty()) {
+            return;
+        }
+
+        pending_request request = c.pending.front();
+        c.pending.pop_front();
+        long latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - request.sent).count();
+
+        if (payload.compare(0, 4, "ACK|") == 0) {
+            m_stats.order_ack.push_back(latency);
+            c.last_order_sent = request.sent;
+
+            c.order_ids.push_back(std::stoull(payload.substr(4)));
+            if (c.order_ids.size() > CANCELLABLE_ORDERS) {
+                c.order_ids.pop_front();
+            }
+        } else if (payload.compare(0, 4, "REJ|") == 0) {
+            m_stats.rejected++;
+        } else if (request.kind == CANCEL) {
+            m_stats.cancel.push_back(latency);
+            if (payload.back() == 'R') {
+                m_stats.cancels_rejected++;
+            }
+        } else {
+            m_stats.query.push_back(latency);
+        }
+
+        if (!m_paced) {
+            fill_pipeline(c);
+        }
+    }
+
+    void on_trade(connection_state& c, const std::string& payload, Clock::time_point now) {
+        // t|instrument|price|size|side|maker|taker|time
+        std::vector<std::string> fields;
+        std::stringstream ss(payload);
+        std::string field;
+        while (std::getline(ss, field, '|')) {
+            fields.push_back(field);
+        }
+
+        if (fields.size() < 7) {
+            return;
+        }
+
+        if (fields[6] == c.name) {
+            m_stats.fill.push_back(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - c.last_order_sent).count());
+        } else if (fields[5] == c.name) {
+            m_stats.passive_fills++;
+        }
+    }
+
+    loadgen_config m_config;
+    client m_client;
+
+    std::vector<connection_state> m_connections;
+    size_t m_next = 0;
+
+    std::mt19937 m_random;
+    bool m_paced = false;
+    double m_rate = 0.0;
+
+    Clock::time_point m_start;
+    Clock::time_point m_end;
+    bool m_stopping = false;
+
+    latency_stats m_stats;
+};
+
+void print_latencies(const std::string& name, std::vector<long>& latencies) {
+    if (latencies.empty()) {
+        std::cout << std::left << std::setw(12) << name << "no samples" << std::endl;
+        return;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        size_t i = std::min(latencies.size() - 1, (size_t) (p * latencies.size()));
+        return latencies[i] / 1000.0;
+    };
+
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << latencies.size()
+              << std::setw(12) << percentile(0.50)
+              << std::setw(12) << percentile(0.90)
+              << std::setw(12) << percentile(0.99)
+              << std::setw(12) << percentile(0.999)
+              << std::setw(12) << latencies.back() / 1000.0 << std::endl;
+}
+
+bool parse_option(const std::string& arg, const std::string& name, std::string& value) {
+    /*
+     * Matches command line arguments of the form --name=value.
+     */
+    std::string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    loadgen_config config;
+
+    for (int a = 1; a < argc; a++) {
+        std::string arg(argv[a]);
+        std::string value;
+
+        if (parse_option(arg, "uri", value)) {
+            config.uri = value;
+        } else if (parse_option(arg, "connections", value)) {
+            config.connections = std::max(1, std::stoi(value));
+        } else if (parse_option(arg, "threads", value)) {
+            config.threads = std::max(1, std::stoi(value));
+        } else if (parse_option(arg, "rate", value)) {
+            config.rate = std::max(0L, std::stol(value));
+        } else if (parse_option(arg, "duration", value)) {
+            config.duration = std::max(1, std::stoi(value));
+        } else if (parse_option(arg, "pipeline", value)) {
+            config.pipeline = std::max(1, std::stoi(value));
+        } else if (parse_option(arg, "orders", value)) {
+            config.order_percent = std::stoi(value);
+        } else if (parse_option(arg, "cancels", value)) {
+            config.cancel_percent = std::stoi(value);
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (config.order_percent < 0 || config.cancel_percent < 0 ||
+        config.order_percent + config.cancel_percent > 100) {
+        std::cerr << "Order and cancel percentages must add up to at most 100" << std::endl;
+        return 1;
+    }
+
+    config.threads = std::min(config.threads, config.connections);
+
+    std::vector<std::unique_ptr<load_thread>> loaders;
+    for (int t = 0; t < config.threads; t++) {
+        int connections = config.connections / config.threads +
+                          (t < config.connections % config.threads ? 1 : 0);
+        loaders.emplace_back(new load_thread(config, t, connections));
+    }
+
+    std::cout << "Sending to " << config.uri << " from " << config.connections
+              << " connections on " << config.threads << " threads for "
+              << config.duration << "s" << std::endl;
+
+    std::vector<std::thread> threads;
+    for (auto& loader : loaders) {
+        threads.emplace_back(&load_thread::run, loader.get());
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    latency_stats stats;
+    for (auto& loader : loaders) {
+        stats.merge(loader->get_stats());
+    }
+
+    long replies = stats.order_ack.size() + stats.rejected + stats.cancel.size() + stats.query.size();
+
+    std::cout << "Sent " << stats.sent << " messages, " << replies << " replies ("
+              << replies / config.duration << "/s"
+              << (config.rate > 0 ? " against a target of " + std::to_string(config.rate) + "/s" : "")
+              << ")" << std::endl;
+    std::cout << stats.rejected << " rejected orders, " << stats.cancels_rejected
+              << " rejected cancels, " << stats.passive_fills << " passive fills, "
+              << stats.failed_connections << " failed connections" << std::endl;
+
+    std::cout << std::endl << std::left << std::setw(12) << "latency us" << std::right
+              << std::setw(10) << "count" << std::setw(12) << "p50" << std::setw(12) << "p90"
+              << std::setw(12) << "p99" << std::setw(12) << "p99.9" << std::setw(12) << "max" << std::endl;
+    print_latencies("order ack", stats.order_ack);
+    print_latencies("fill", stats.fill);
+    print_latencies("cancel", stats.cancel);
+    print_latencies("query", stats.query);
+}
@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "md_feed.h"
+
+namespace exchange {
+    // Packet fields are written byte by byte in little endian order so the
+    //     feed doesn't depend on the layout or byte order of the host
+
+    static void put_uint(char* out, uint64_t value, size_t bytes) {
+        for (size_t b = 0; b < bytes; b++) {
+            out[b] = (char) ((value >> (8 * b)) & 0xff);
+        }
+    }
+
+    static uint64_t get_uint(const char* in, size_t bytes) {
+        uint64_t value = 0;
+        for (size_t b = 0; b < bytes; b++) {
+            value |= ((uint64_t) (unsigned char) in[b]) << (8 * b);
+        }
+
+        return value;
+    }
+
+    void encode_md_message(const MdMessage& m, char* packet) {
+        /*
+         * Packet layout:
+         *
+         *   0  sequence     8 bytes
+         *   8  type         2 bytes
+         *  10  side         1 byte
+         *  11  (unused)     1 byte
+         *  12  instrument   8 bytes, padded with zeros
+         *  20  price        8 bytes, fixed point
+         *  28  quantity     4 bytes
+         */
+        std::memset(packet, 0, MD_PACKET_SIZE);
+
+        put_uint(packet, m.sequence, 8);
+        put_uint(packet + 8, (uint64_t) m.type, 2);
+        put_uint(packet + 10, (m.side == BUY) ? 0 : 1, 1);
+
+        std::memcpy(packet + 12, m.instrument.data(),
+                    std::min(m.instrument.size(), MD_INSTRUMENT_SIZE));
+
+        int64_t price = (int64_t) std::llround(m.price * MD_PRICE_SCALE);
+        put_uint(packet + 20, (uint64_t) price, 8);
+        put_uint(packet + 28, (uint64_t) (uint32_t) m.quantity, 4);
+    }
+
+    bool decode_md_message(const char* packet, size_t size, MdMessage& m) {
+        if (size != MD_PACKET_SIZE) {
+            return false;
+        }
+
+        uint64_t type = get_uint(packet + 8, 2);
+        if (type < MD_LEVEL || type > MD_UNAVAILABLE) {
+            return false;
+        }
+
+        m.sequence = get_uint(packet, 8);
+        m.type = (MdMessageType) type;
+        m.side = (get_uint(packet + 10, 1) == 0) ? BUY : SELL;
+
+        const char* instrument = packet + 12;
+        m.instrument.assign(instrument, strnlen(instrument, MD_INSTRUMENT_SIZE));
+
+        m.price = (int64_t) get_uint(packet + 20, 8) / MD_PRICE_SCALE;
+        m.quantity = (int32_t) (uint32_t) get_uint(packet + 28, 4);
+
+        return true;
+    }
+
+    void encode_md_request(uint64_t from, uint64_t to, char* packet) {
+        put_uint(packet, from, 8);
+        put_uint(packet + 8, to, 8);
+    }
+
+    bool decode_md_request(const char* packet, size_t size, uint64_t& from, uint64_t& to) {
+        if (size != MD_REQUEST_SIZE) {
+            return false;
+        }
+
+        from = get_uint(packet, 8);
+        to = get_uint(packet + 8, 8);
+
+        return from <= to;
+    }
+
+    void RetransmitBuffer::store(uint64_t sequence, const char* packet) {
+        std::memcpy(&packets[(sequence % capacity) * MD_PACKET_SIZE], packet, MD_PACKET_SIZE);
+        last = sequence;
+    }
+
+    const char* RetransmitBuffer::get(uint64_t sequence) const {
+        /*
+         * Returns the stored packet for a sequence number, or nullptr once
+         * it has been overwritten or was never published.
+         */
+        if (sequence < first_available() || sequence > last) {
+            return nullptr;
+        }
+
+        return &packets[(sequence % capacity) * MD_PACKET_SIZE];
+    }
+
+    uint64_t RetransmitBuffer::first_available() const {
+        // Sequence numbers start at one
+        return (last < capacity) ? 1 : last - capacity + 1;
+    }
+
+    static bool make_address(const std::string& address, uint16_t port, sockaddr_in& out) {
+        std::memset(&out, 0, sizeof(out));
+        out.sin_family = AF_INET;
+        out.sin_port = htons(port);
+
+        if (inet_pton(AF_INET, address.c_str(), &out.sin_addr) != 1) {
+            std::cerr << "Invalid address " << address << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    static bool set_nonblocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    MdPublisher::~MdPublisher() {
+        if (data_socket >= 0) { close(data_socket); }
+        if (request_socket >= 0) { close(request_socket); }
+    }
+
+    bool MdPublisher::open(const std::string& group, uint16_t port,
+                           const std::string& interface, uint16_t request_port) {
+        /*
+         * Open the feed socket, sending to group:port through the interface
+         * with the given address, and listen for retransmission requests on
+         * interface:request_port.
+         *
+         * The group may also be a unicast address, e.g. for testing.
+         */
+        sockaddr_in local;
+        if (!make_address(group, port, destination) || !make_address(interface, request_port, local)) {
+            return false;
+        }
+
+        data_socket = socket(AF_INET, SOCK_DGRAM, 0);
+        request_socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (data_socket < 0 || request_socket < 0) {
+            std::cerr << "Failed to create market data sockets: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        if (IN_MULTICAST(ntohl(destination.sin_addr.s_addr))) {
+            // Keep the feed on the chosen interface and deliver it to
+            //     subscribers on this host, which is all that's needed
+            //     when publishing on the loopback interface
+            unsigned char loop = 1;
+            unsigned char ttl = 1;
+
+            if (setsockopt(data_socket, IPPROTO_IP, IP_MULTICAST_IF, &local.sin_addr, sizeof(local.sin_addr)) < 0 ||
+                setsockopt(data_socket, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0 ||
+                setsockopt(data_socket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0) {
+                std::cerr << "Failed to set multicast options: " << strerror(errno) << std::endl;
+                return false;
+            }
+        }
+
+        if (bind(request_socket, (sockaddr*) &local, sizeof(local)) < 0 || !set_nonblocking(request_socket)) {
+            std::cerr << "Failed to listen for retransmission requests: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        last_sent = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    void MdPublisher::on_trade(const Trade& t) {
+        MdMessage m;
+        m.type = MD_TRADE;
+        m.instrument = t.get_instrument();
+        m.side = t.get_side();
+        m.price = t.get_price();
+        m.quantity = t.get_size();
+
+        publish(m);
+    }
+
+    void MdPublisher::on_level_change(const std::string& instrument, OrderSide side,
+                                      double price, int quantity) {
+        MdMessage m;
+        m.type = MD_LEVEL;
+        m.instrument = instrument;
+        m.side = side;
+        m.price = price;
+        m.quantity = quantity;
+
+        publish(m);
+    }
+
+    void MdPublisher::publish(MdMessage& m) {
+        if (m.instrument.size() > MD_INSTRUMENT_SIZE) {
+            if (unpublishable_instruments.insert(m.instrument).second) {
+                std::cerr << "Instrument " << m.instrument << " has too long a name for the market data feed"
+                          << std::endl;
+            }
+
+            unpublishable++;
+            return;
+        }
+
+        m.sequence = ++sequence;
+
+        char packet[MD_PACKET_SIZE];
+        encode_md_message(m, packet);
+
+        buffer.store(m.sequence, packet);
+        send_packet(packet);
+    }
+
+    void MdPublisher::send_packet(const char* packet) {
+        if (data_socket < 0) {
+            return;
+        }
+
+        // A failed send is no different to a dropped datagram, consumers
+        //     recover it through a retransmission request
+        sendto(data_socket, packet, MD_PACKET_SIZE, 0, (sockaddr*) &destination, sizeof(destination));
+        last_sent = std::chrono::steady_clock::now();
+    }
+
+    void MdPublisher::poll() {
+        /*
+         * Answer any waiting retransmission requests and send a heartbeat if
+         * nothing has been published for a second.
+         */
+        if (request_socket < 0) {
+            return;
+        }
+
+        handle_requests();
+
+        if (std::chrono::steady_clock::now() - last_sent >= std::chrono::seconds(1)) {
+            MdMessage heartbeat;
+            heartbeat.type = MD_HEARTBEAT;
+            heartbeat.sequence = sequence;
+
+            char packet[MD_PACKET_SIZE];
+            encode_md_message(heartbeat, packet);
+            send_packet(packet);
+        }
+    }
+
+    void MdPublisher::handle_requests() {
+        char request[MD_REQUEST_SIZE];
+        sockaddr_in from_address;
+        socklen_t address_size = sizeof(from_address);
+
+        ssize_t received;
+        while ((received = recvfrom(request_socket, request, sizeof(request), 0,
+                                    (sockaddr*) &from_address, &address_size)) >= 0) {
+            uint64_t from;
+            uint64_t to;
+            address_size = sizeof(from_address);
+
+            if (!decode_md_request(request, received, from, to) || to == 0) {
+                continue;
+            }
+
+            from = std::max<uint64_t>(from, 1);
+            to = std::min(to, sequence);
+            if (from > to) {
+                continue;
+            }
+            to = std::min(to, from + MD_MAX_RETRANSMIT - 1);
+
+            // Tell the consumer about anything that has already left the buffer
+            uint64_t first = buffer.first_available();
+            if (from < first) {
+                MdMessage unavailable;
+                unavailable.type = MD_UNAVAILABLE;
+                unavailable.sequence = std::min(to, first - 1);
+
+                char packet[MD_PACKET_SIZE];
+                encode_md_message(unavailable, packet);
+                sendto(request_socket, packet, MD_PACKET_SIZE, 0,
+                       (sockaddr*) &from_address, sizeof(from_address));
+
+                from = first;
+            }
+
+            for (uint64_t s = from; s <= to; s++) {
+                const char* packet = buffer.get(s);
+                sendto(request_socket, packet, MD_PACKET_SIZE, 0,
+                       (sockaddr*) &from_address, sizeof(from_address));
+                retransmitted++;
+            }
+        }
+    }
+
+    MdSubscriber::~MdSubscriber() {
+        if (socket_fd >= 0) { close(socket_fd); }
+        if (request_fd >= 0) { close(request_fd); }
+    }
+
+    bool MdSubscriber::open(const std::string& group, uint16_t port, const std::string& interface,
+                            const std::string& publisher_address, uint16_t request_port) {
+        /*
+         * Receive the feed sent to group:port on the interface with the given
+         * address, asking publisher_address:request_port for anything missed.
+         */
+        sockaddr_in group_address;
+        sockaddr_in interface_address;
+        if (!make_address(group, port, group_address) ||
+            !make_address(interface, port, interface_address) ||
+            !make_address(publisher_address, request_port, publisher)) {
+            return false;
+        }
+
+        socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (socket_fd < 0) {
+            std::cerr << "Failed to create market data socket: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        // Allow several subscribers on one host
+        int reuse = 1;
+        setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        bool multicast = IN_MULTICAST(ntohl(group_address.sin_addr.s_addr));
+
+        sockaddr_in local = multicast ? group_address : interface_address;
+        if (bind(socket_fd, (sockaddr*) &local, sizeof(local)) < 0) {
+            std::cerr << "Failed to bind market data socket: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        if (multicast) {
+            ip_mreq membership;
+            membership.imr_multiaddr = group_address.sin_addr;
+            membership.imr_interface = interface_address.sin_addr;
+
+            if (setsockopt(socket_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) {
+                std::cerr << "Failed to join " << group << ": " << strerror(errno) << std::endl;
+                return false;
+            }
+        }
+
+        // Any free port on the interface for requests and what comes back
+        request_fd = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in request_local = interface_address;
+        request_local.sin_port = 0;
+        if (request_fd < 0 || bind(request_fd, (sockaddr*) &request_local, sizeof(request_local)) < 0) {
+            std::cerr << "Failed to create market data request socket: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        return set_nonblocking(socket_fd) && set_nonblocking(request_fd);
+    }
+
+    int MdSubscriber::poll() {
+        /*
+         * Handle every packet waiting on the socket.
+         *
+         * Returns the number of packets received.
+         */
+        char packet[MD_PACKET_SIZE];
+        int received = 0;
+
+        for (int fd : {socket_fd, request_fd}) {
+            ssize_t size;
+            while ((size = recv(fd, packet, sizeof(packet), 0)) >= 0) {
+                handle_packet(packet, size);
+                received++;
+            }
+        }
+
+        return received;
+    }
+
+    void MdSubscriber::handle_packet(const char* packet, size_t size) {
+        MdMessage m;
+        if (!decode_md_message(packet, size, m)) {
+            return;
+        }
+
+        if (m.type == MD_UNAVAILABLE) {
+            // Skip over what the publisher can no longer send, still handing
+            //     over anything that did arrive in that range
+            for (; next_sequence <= m.sequence; next_sequence++) {
+                auto it = pending.find(next_sequence);
+                if (it == pending.end()) {
+                    lost++;
+                    continue;
+                }
+
+                handler(it->second);
+                pending.erase(it);
+            }
+
+            deliver_pending();
+            return;
+        }
+
+        if (next_sequence == 0) {
+            // The stream starts from the first message seen
+            next_sequence = (m.type == MD_HEARTBEAT) ? m.sequence + 1 : m.sequence;
+        }
+
+        if (m.type == MD_HEARTBEAT) {
+            // Anything still missing is asked for again, which also retries
+            //     requests or retransmissions that were themselves lost
+            if (m.sequence >= next_sequence) {
+                request(next_sequence, m.sequence);
+            }
+            return;
+        }
+
+        if (m.sequence < next_sequence) {
+            // Already handled
+            return;
+        }
+
+        if (m.sequence == next_sequence) {
+            handler(m);
+            next_sequence++;
+            deliver_pending();
+            return;
+        }
+
+        pending[m.sequence] = m;
+
+        if (m.sequence - 1 > requested) {
+            request(std::max(next_sequence, requested + 1), m.sequence - 1);
+        }
+    }
+
+    void MdSubscriber::deliver_pending() {
+        while (!pending.empty() && pending.begin()->first <= next_sequence) {
+            if (pending.begin()->first == next_sequence) {
+                handler(pending.begin()->second);
+                next_sequence++;
+            }
+
+            pending.erase(pending.begin());
+        }
+    }
+
+    void MdSubscriber::request(uint64_t from, uint64_t to) {
+        char packet[MD_REQUEST_SIZE];
+        encode_md_request(from, to, packet);
+
+        sendto(request_fd, packet, MD_REQUEST_SIZE, 0, (sockaddr*) &publisher, sizeof(publisher));
+        requested = std::max(requested, to);
+    }
+}
@@ -0,0 +1,186 @@
+#ifndef MD_FEED_H
+#define MD_FEED_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+
+#include "listener.h"
+#include "order.h"
+#include "trade.h"
+
+namespace exchange {
+    enum MdMessageType {
+        MD_LEVEL = 1,
+        MD_TRADE = 2,
+        // Sent when the feed is quiet so consumers notice missed messages,
+        //     carries the last sequence number published
+        MD_HEARTBEAT = 3,
+        // Sent in reply to a retransmission request for messages that are
+        //     no longer buffered, carries the last sequence number lost
+        MD_UNAVAILABLE = 4
+    };
+
+    // Every message is sent as one fixed size datagram
+    const size_t MD_PACKET_SIZE = 32;
+    const size_t MD_REQUEST_SIZE = 16;
+    const size_t MD_INSTRUMENT_SIZE = 8;
+
+    // Prices are sent as fixed point with the 4 decimal places used by
+    //     the text protocol
+    const double MD_PRICE_SCALE = 10000.0;
+
+    // Largest number of messages sent back for a single request
+    const uint64_t MD_MAX_RETRANSMIT = 1024;
+
+    struct MdMessage {
+        uint64_t sequence = 0;
+        MdMessageType type = MD_HEARTBEAT;
+        std::string instrument;
+        OrderSide side = BUY;
+        double price = 0.0;
+        int quantity = 0;
+    };
+
+    void encode_md_message(const MdMessage& m, char* packet);
+    bool decode_md_message(const char* packet, size_t size, MdMessage& m);
+
+    void encode_md_request(uint64_t from, uint64_t to, char* packet);
+    bool decode_md_request(const char* packet, size_t size, uint64_t& from, uint64_t& to);
+
+    class RetransmitBuffer {
+        /*
+         * Keeps the most recent encoded packets of the feed, indexed by their
+         * sequence number, in one contiguous block of memory. It always has
+         * room for at least the latest packet.
+         */
+        public:
+            RetransmitBuffer(size_t capacity)
+                : capacity(std::max<size_t>(1, capacity)), packets(this->capacity * MD_PACKET_SIZE) {}
+
+            void store(uint64_t sequence, const char* packet);
+            const char* get(uint64_t sequence) const;
+
+            uint64_t first_available() const;
+        private:
+            size_t capacity;
+            std::vector<char> packets;
+
+            uint64_t last = 0;
+    };
+
+    class MdPublisher : public BookListener {
+        /*
+         * Publishes level and trade updates from the books it listens to as a
+         * sequenced binary feed over UDP, usually to a multicast group.
+         *
+         * Consumers that miss messages send the range of sequence numbers
+         * they need to the request port and the publisher sends them back
+         * from its retransmission buffer. Requests and heartbeats are
+         * handled by calling poll() from the same thread as the books.
+         *
+         * Instruments with names longer than MD_INSTRUMENT_SIZE can't be
+         * told apart on the feed, so their updates aren't published.
+         */
+        public:
+            MdPublisher(size_t buffer_capacity) : buffer(buffer_capacity) {}
+            ~MdPublisher();
+
+            MdPublisher(const MdPublisher&) = delete;
+            MdPublisher& operator =(const MdPublisher&) = delete;
+
+            bool open(const std::string& group, uint16_t port,
+                      const std::string& interface, uint16_t request_port);
+
+            void on_trade(const Trade& t) override;
+            void on_level_change(const std::string& instrument, OrderSide side,
+                                 double price, int quantity) override;
+
+            void poll();
+
+            uint64_t get_sequence() const { return sequence; }
+            long get_retransmitted() const { return retransmitted; }
+            long get_unpublishable() const { return unpublishable; }
+        private:
+            void publish(MdMessage& m);
+            void send_packet(const char* packet);
+            void handle_requests();
+
+            int data_socket = -1;
+            int request_socket = -1;
+            sockaddr_in destination;
+
+            RetransmitBuffer buffer;
+            uint64_t sequence = 0;
+
+            std::chrono::steady_clock::time_point last_sent;
+
+            long retransmitted = 0;
+
+            // Updates refused for their instrument's name, which is logged
+            //     the first time
+            long unpublishable = 0;
+            std::set<std::string> unpublishable_instruments;
+    };
+
+    class MdSubscriber {
+        /*
+         * Receives the feed from an MdPublisher and hands messages to a
+         * handler strictly in sequence order.
+         *
+         * Messages that arrive after a gap are held back while the missing
+         * range is requested from the publisher. Messages the publisher can
+         * no longer send are counted as lost and skipped.
+         *
+         * Requests go out on a unicast socket of their own and the publisher
+         * sends the retransmissions back to it, since a socket bound to a
+         * multicast group never sees datagrams sent to its host.
+         */
+        public:
+            typedef std::function<void(const MdMessage&)> Handler;
+
+            MdSubscriber(Handler handler) : handler(handler) {}
+            ~MdSubscriber();
+
+            MdSubscriber(const MdSubscriber&) = delete;
+            MdSubscriber& operator =(const MdSubscriber&) = delete;
+
+            bool open(const std::string& group, uint16_t port, const std::string& interface,
+                      const std::string& publisher_address, uint16_t request_port);
+
+            int poll();
+            void handle_packet(const char* packet, size_t size);
+
+            uint64_t get_next_sequence() const { return next_sequence; }
+            size_t get_pending() const { return pending.size(); }
+            long get_lost() const { return lost; }
+        private:
+            void deliver_pending();
+            void request(uint64_t from, uint64_t to);
+
+            Handler handler;
+
+            int socket_fd = -1;
+            int request_fd = -1;
+            sockaddr_in publisher;
+
+            // Zero until the first message sets where the stream starts
+            uint64_t next_sequence = 0;
+
+            // Highest sequence number already asked for
+            uint64_t requested = 0;
+
+            std::map<uint64_t, MdMessage> pending;
+
+            long lost = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,135 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "metrics_server.h"
+
+namespace exchange {
+    // How often run() checks whether it has been stopped
+    const int STOP_CHECK_MS = 100;
+
+    // Largest request read before answering, scrapers send far less
+    const size_t MAX_REQUEST_SIZE = 8192;
+
+    // A scraper that stalls part way through a request is dropped
+    const int REQUEST_TIMEOUT_MS = 1000;
+
+    MetricsServer::~MetricsServer() {
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+    }
+
+    bool MetricsServer::listen(const std::string& address, uint16_t listen_port) {
+        /*
+         * Listen for scrapes on address:listen_port. A port of zero picks
+         * any free port, which can be found with get_port().
+         */
+        sockaddr_in local;
+        std::memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_port = htons(listen_port);
+
+        if (inet_pton(AF_INET, address.c_str(), &local.sin_addr) != 1) {
+            std::cerr << "Invalid metrics address " << address << std::endl;
+            return false;
+        }
+
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd < 0) {
+            std::cerr << "Failed to create metrics socket: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        int reuse = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if (bind(listen_fd, (sockaddr*) &local, sizeof(local)) < 0 ||
+            ::listen(listen_fd, SOMAXCONN) < 0) {
+            std::cerr << "Failed to listen on metrics port: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        socklen_t size = sizeof(local);
+        getsockname(listen_fd, (sockaddr*) &local, &size);
+        port = ntohs(local.sin_port);
+
+        // Running from here so a stop() before run() is called isn't lost
+        running.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void MetricsServer::run() {
+        /*
+         * Answer scrapes until stop() is called.
+         */
+        while (running.load(std::memory_order_acquire)) {
+            pollfd listener;
+            listener.fd = listen_fd;
+            listener.events = POLLIN;
+
+            if (poll(&listener, 1, STOP_CHECK_MS) <= 0) {
+                continue;
+            }
+
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd >= 0) {
+                handle(fd);
+                close(fd);
+            }
+        }
+    }
+
+    void MetricsServer::handle(int fd) {
+        // Read until the end of the request headers
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE) {
+            pollfd client;
+            client.fd = fd;
+            client.events = POLLIN;
+            if (poll(&client, 1, REQUEST_TIMEOUT_MS) <= 0) {
+                return;
+            }
+
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            if (n <= 0) {
+                return;
+            }
+            request.append(buffer, n);
+        }
+
+        std::string status = "200 OK";
+        std::string body;
+        if (request.compare(0, 13, "GET /metrics ") == 0) {
+            body = registry.render();
+        } else {
+            status = "404 Not Found";
+            body = "Metrics are served from /metrics\n";
+        }
+
+        std::stringstream response;
+        response << "HTTP/1.0 " << status << "\r\n"
+                 << "Content-Type: text/plain; version=0.0.4\r\n"
+                 << "Content-Length: " << body.size() << "\r\n"
+                 << "Connection: close\r\n\r\n"
+                 << body;
+
+        std::string out = response.str();
+        size_t sent = 0;
+        while (sent < out.size()) {
+            ssize_t n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return;
+            }
+            sent += n;
+        }
+    }
+}
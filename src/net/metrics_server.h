@@ -0,0 +1,44 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "metrics.h"
+
+namespace exchange {
+    class MetricsServer {
+        /*
+         * Serves the metrics in a registry over plain HTTP for Prometheus
+         * to scrape from /metrics.
+         *
+         * Scrapes are rare, so requests are handled one at a time on the
+         * thread calling run() and every response closes the connection.
+         */
+        public:
+            MetricsServer(MetricsRegistry& registry) : registry(registry), running(false) {}
+            ~MetricsServer();
+
+            MetricsServer(const MetricsServer&) = delete;
+            MetricsServer& operator =(const MetricsServer&) = delete;
+
+            bool listen(const std::string& address, uint16_t port);
+            uint16_t get_port() const { return port; }
+
+            void run();
+            void stop() { running.store(false, std::memory_order_release); }
+
+        private:
+            void handle(int fd);
+
+            MetricsRegistry& registry;
+
+            int listen_fd = -1;
+            uint16_t port = 0;
+
+            std::atomic<bool> running;
+    };
+}
+
+#endif
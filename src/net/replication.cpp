@@ -0,0 +1,410 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "replication.h"
+
+namespace exchange {
+    static void put_u64(std::string& out, uint64_t value) {
+        for (size_t b = 0; b < 8; b++) {
+            out += (char) ((value >> (8 * b)) & 0xff);
+        }
+    }
+
+    static uint64_t get_u64(const char* data) {
+        uint64_t value = 0;
+        for (size_t b = 0; b < 8; b++) {
+            value |= ((uint64_t) (unsigned char) data[b]) << (8 * b);
+        }
+        return value;
+    }
+
+    static bool set_nonblocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    static bool parse_address(const std::string& address, uint16_t port, sockaddr_in& out) {
+        std::memset(&out, 0, sizeof(out));
+        out.sin_family = AF_INET;
+        out.sin_port = htons(port);
+
+        if (inet_pton(AF_INET, address.c_str(), &out.sin_addr) != 1) {
+            std::cerr << "Invalid replication address " << address << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    std::string encode_event(const ReplicationEvent& e) {
+        std::string body;
+        body.reserve(EVENT_HEADER_SIZE + e.payload.size());
+        put_u64(body, e.sequence);
+        put_u64(body, (uint64_t) e.time);
+        body += e.payload;
+
+        return encode_frame(body);
+    }
+
+    bool decode_event(const std::string& frame_payload, ReplicationEvent& e) {
+        if (frame_payload.size() < EVENT_HEADER_SIZE) {
+            return false;
+        }
+
+        e.sequence = get_u64(frame_payload.data());
+        e.time = (int64_t) get_u64(frame_payload.data() + 8);
+        e.payload.assign(frame_payload, EVENT_HEADER_SIZE, std::string::npos);
+
+        return true;
+    }
+
+    ReplicationPublisher::ReplicationPublisher(size_t segment_size, size_t max_segments)
+        : segment_size(std::max(segment_size, FRAME_HEADER_SIZE + MAX_FRAME_SIZE))
+        , max_segments(max_segments) {}
+
+    ReplicationPublisher::~ReplicationPublisher() {
+        for (auto& s : standbys) {
+            close(s.fd);
+        }
+
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+    }
+
+    bool ReplicationPublisher::listen(const std::string& address, uint16_t listen_port) {
+        /*
+         * Listen for standbys on address:listen_port. A port of zero picks
+         * any free port, which can be found with get_port().
+         *
+         * Events published before listening are kept for the first standby.
+         */
+        sockaddr_in local;
+        if (!parse_address(address, listen_port, local)) {
+            return false;
+        }
+
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd < 0) {
+            std::cerr << "Failed to create replication socket: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        int reuse = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if (bind(listen_fd, (sockaddr*) &local, sizeof(local)) < 0 ||
+            ::listen(listen_fd, SOMAXCONN) < 0 || !set_nonblocking(listen_fd)) {
+            std::cerr << "Failed to listen on replication port: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        socklen_t size = sizeof(local);
+        getsockname(listen_fd, (sockaddr*) &local, &size);
+        port = ntohs(local.sin_port);
+
+        return true;
+    }
+
+    bool ReplicationPublisher::publish(const ReplicationEvent& e) {
+        /*
+         * Add the next event to the log and send it to every standby that
+         * is caught up.
+         *
+         * Returns false, without publishing, when the event is out of
+         * sequence or too large for a frame.
+         */
+        if (e.sequence != sequence + 1) {
+            std::cerr << "Replication event " << e.sequence << " out of sequence" << std::endl;
+            return false;
+        }
+
+        if (EVENT_HEADER_SIZE + e.payload.size() > MAX_FRAME_SIZE) {
+            std::cerr << "Replication event " << e.sequence << " too large" << std::endl;
+            return false;
+        }
+
+        std::string frame = encode_event(e);
+        if (segments.empty() || segments.back().data.size() + frame.size() > segment_size) {
+            add_segment(e.sequence);
+        }
+
+        Segment& segment = segments.back();
+        segment.offsets.push_back(segment.data.size());
+        segment.data += frame;
+        sequence = e.sequence;
+
+        for (size_t i = 0; i < standbys.size(); ) {
+            if (!standbys[i].ready || write_standby(standbys[i])) {
+                i++;
+            } else {
+                close(standbys[i].fd);
+                standbys.erase(standbys.begin() + i);
+            }
+        }
+
+        return true;
+    }
+
+    uint64_t ReplicationPublisher::get_first_sequence() const {
+        return segments.empty() ? sequence + 1 : segments.front().first_sequence;
+    }
+
+    void ReplicationPublisher::add_segment(uint64_t first_sequence) {
+        /*
+         * Start a new segment with all its room allocated up front, so
+         * adding to it never moves what is already there.
+         */
+        if (max_segments > 0 && segments.size() >= max_segments) {
+            drop_oldest_segment();
+        }
+
+        segments.emplace_back();
+        segments.back().first_sequence = first_sequence;
+        segments.back().data.reserve(segment_size);
+    }
+
+    void ReplicationPublisher::drop_oldest_segment() {
+        size_t dropped_size = segments.front().data.size();
+        segments.pop_front();
+        first_segment++;
+
+        for (size_t i = 0; i < standbys.size(); ) {
+            Standby& s = standbys[i];
+            if (s.ready && s.segment < first_segment && s.offset == dropped_size) {
+                // Had all of it, so it carries on with the next segment
+                s.segment = first_segment;
+                s.offset = 0;
+                i++;
+            } else if (s.ready && s.segment < first_segment) {
+                std::cerr << "Standby fell too far behind, events before " << get_first_sequence()
+                          << " are no longer kept" << std::endl;
+                close(s.fd);
+                standbys.erase(standbys.begin() + i);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    void ReplicationPublisher::poll() {
+        /*
+         * Accept new standbys and carry on sending to those that are
+         * behind. Call whenever the publishing thread is otherwise idle.
+         */
+        if (listen_fd >= 0) {
+            accept_standbys();
+        }
+
+        for (size_t i = 0; i < standbys.size(); ) {
+            Standby& s = standbys[i];
+            bool ok = s.ready ? write_standby(s) : read_handshake(s);
+
+            if (ok) {
+                i++;
+            } else {
+                close(s.fd);
+                standbys.erase(standbys.begin() + i);
+            }
+        }
+    }
+
+    void ReplicationPublisher::accept_standbys() {
+        int fd;
+        while ((fd = accept(listen_fd, nullptr, nullptr)) >= 0) {
+            int nodelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+            set_nonblocking(fd);
+
+            Standby s;
+            s.fd = fd;
+            standbys.push_back(s);
+        }
+    }
+
+    bool ReplicationPublisher::read_handshake(Standby& s) {
+        // Returns false when the standby should be dropped
+        char data[8];
+        ssize_t received = read(s.fd, data, sizeof(data) - s.handshake.size());
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+        if (received <= 0) {
+            return false;
+        }
+
+        s.handshake.append(data, received);
+        if (s.handshake.size() < sizeof(data)) {
+            return true;
+        }
+
+        uint64_t next_sequence = get_u64(s.handshake.data());
+        if (next_sequence == 0) {
+            next_sequence = 1;
+        }
+
+        if (next_sequence > sequence + 1) {
+            std::cerr << "Standby asked for event " << next_sequence
+                      << " which hasn't happened yet" << std::endl;
+            return false;
+        }
+
+        if (next_sequence < get_first_sequence()) {
+            std::cerr << "Standby asked for event " << next_sequence << " but events before "
+                      << get_first_sequence() << " are no longer kept" << std::endl;
+            return false;
+        }
+
+        s.ready = true;
+
+        if (next_sequence > sequence) {
+            // Caught up, so it starts at the end of the newest segment
+            s.segment = first_segment + (segments.empty() ? 0 : segments.size() - 1);
+            s.offset = segments.empty() ? 0 : segments.back().data.size();
+        } else {
+            // The last segment starting at or before the event holds it
+            auto it = std::upper_bound(segments.begin(), segments.end(), next_sequence,
+                                       [](uint64_t wanted, const Segment& segment) {
+                                           return wanted < segment.first_sequence;
+                                       }) - 1;
+
+            s.segment = first_segment + (it - segments.begin());
+            s.offset = it->offsets[next_sequence - it->first_sequence];
+        }
+
+        return write_standby(s);
+    }
+
+    bool ReplicationPublisher::write_standby(Standby& s) {
+        // Returns false when the standby should be dropped
+        while (s.segment - first_segment < segments.size()) {
+            const std::string& data = segments[s.segment - first_segment].data;
+
+            if (s.offset < data.size()) {
+                ssize_t written = ::send(s.fd, data.data() + s.offset, data.size() - s.offset,
+                                         MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (written < 0) {
+                    return errno == EAGAIN || errno == EWOULDBLOCK;
+                }
+
+                s.offset += written;
+                continue;
+            }
+
+            // Move on once the segment is full, as nothing more goes in it
+            if (s.segment - first_segment + 1 == segments.size()) {
+                break;
+            }
+
+            s.segment++;
+            s.offset = 0;
+        }
+
+        return true;
+    }
+
+    ReplicationSubscriber::~ReplicationSubscriber() {
+        disconnect();
+    }
+
+    bool ReplicationSubscriber::connect(const std::string& address, uint16_t port, uint64_t next) {
+        /*
+         * Connect to a primary and ask for its events from next onwards.
+         */
+        sockaddr_in remote;
+        if (!parse_address(address, port, remote)) {
+            return false;
+        }
+
+        disconnect();
+        decoder = FrameDecoder();
+        next_sequence = next == 0 ? 1 : next;
+
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0 || ::connect(fd, (sockaddr*) &remote, sizeof(remote)) < 0) {
+            std::cerr << "Failed to connect to primary: " << strerror(errno) << std::endl;
+            disconnect();
+            return false;
+        }
+
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        std::string handshake;
+        put_u64(handshake, next_sequence);
+        if (::send(fd, handshake.data(), handshake.size(), MSG_NOSIGNAL) != (ssize_t) handshake.size()) {
+            std::cerr << "Failed to send replication handshake" << std::endl;
+            disconnect();
+            return false;
+        }
+
+        set_nonblocking(fd);
+        return true;
+    }
+
+    size_t ReplicationSubscriber::poll(EventHandler handler) {
+        /*
+         * Hand every event that has arrived to handler, in sequence.
+         *
+         * Returns the number of events handled. Never blocks.
+         */
+        if (fd < 0) {
+            return 0;
+        }
+
+        size_t handled = 0;
+        char data[16384];
+
+        for (;;) {
+            ssize_t received = read(fd, data, sizeof(data));
+
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return handled;
+            }
+
+            if (received <= 0) {
+                // The primary has gone
+                disconnect();
+                return handled;
+            }
+
+            decoder.append(data, received);
+
+            std::string frame_payload;
+            ReplicationEvent e;
+            while (decoder.next(frame_payload)) {
+                if (!decode_event(frame_payload, e) || e.sequence != next_sequence) {
+                    std::cerr << "Replication stream broken at event " << next_sequence << std::endl;
+                    disconnect();
+                    return handled;
+                }
+
+                handler(e);
+                next_sequence++;
+                handled++;
+            }
+
+            if (decoder.is_corrupt()) {
+                std::cerr << "Replication stream sent an oversized frame" << std::endl;
+                disconnect();
+                return handled;
+            }
+        }
+    }
+
+    void ReplicationSubscriber::disconnect() {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "tcp_gateway.h"
+
+namespace exchange {
+    struct ReplicationEvent {
+        // Events are numbered from 1 with no gaps
+        uint64_t sequence = 0;
+
+        // When the primary applied the event, in nanoseconds since the epoch
+        //     of its clock, so a standby replays it at the same time
+        int64_t time = 0;
+
+        // The message as the primary received it
+        std::string payload;
+    };
+
+    // Events travel as frames holding the sequence and time as 8 byte little
+    //     endian integers followed by the payload
+    const size_t EVENT_HEADER_SIZE = 16;
+
+    // Bytes of events kept in each block of the publisher's log
+    const size_t REPLICATION_SEGMENT_SIZE = 1 << 20;
+
+    std::string encode_event(const ReplicationEvent& e);
+    bool decode_event(const std::string& frame_payload, ReplicationEvent& e);
+
+    class ReplicationPublisher {
+        /*
+         * Streams the sequenced events that change a primary exchange to its
+         * hot standbys over TCP.
+         *
+         * Events are kept in a log of fixed size segments, which are
+         * filled in place and never copied, so a standby connecting late or
+         * reconnecting is sent everything after the last event it has.
+         * Standbys send the sequence they want next, as 8 bytes, when they
+         * connect.
+         *
+         * With a limit on the number of segments, the oldest segment is
+         * dropped once a new one would go over it. Standbys still reading
+         * it, and standbys asking for events that have gone, are turned
+         * away, as there is nothing left to bring them up to date with.
+         *
+         * Everything happens on the thread calling publish() and poll() and
+         * nothing blocks: a standby that stops reading falls behind rather
+         * than holding up the primary.
+         */
+        public:
+            // No limit on segments when max_segments is 0. Segments always
+            //     have room for the largest event.
+            ReplicationPublisher(size_t segment_size = REPLICATION_SEGMENT_SIZE, size_t max_segments = 0);
+            ~ReplicationPublisher();
+
+            ReplicationPublisher(const ReplicationPublisher&) = delete;
+            ReplicationPublisher& operator =(const ReplicationPublisher&) = delete;
+
+            bool listen(const std::string& address, uint16_t port);
+            uint16_t get_port() const { return port; }
+
+            bool publish(const ReplicationEvent& e);
+            void poll();
+
+            uint64_t get_sequence() const { return sequence; }
+
+            // The oldest event still kept, or the next one while none are
+            uint64_t get_first_sequence() const;
+
+            size_t get_segment_count() const { return segments.size(); }
+            size_t get_standby_count() const { return standbys.size(); }
+        private:
+            struct Segment {
+                uint64_t first_sequence;
+
+                // Frames of consecutive events, and where each one starts
+                std::string data;
+                std::vector<size_t> offsets;
+            };
+
+            struct Standby {
+                int fd;
+                std::string handshake;
+
+                // Where the standby is in the log once it has said where
+                //     to start, by the number of the segment counting every
+                //     segment ever made
+                bool ready = false;
+                uint64_t segment = 0;
+                size_t offset = 0;
+            };
+
+            void add_segment(uint64_t first_sequence);
+            void drop_oldest_segment();
+
+            void accept_standbys();
+            bool read_handshake(Standby& s);
+            bool write_standby(Standby& s);
+
+            int listen_fd = -1;
+            uint16_t port = 0;
+
+            size_t segment_size;
+            size_t max_segments;
+
+            std::deque<Segment> segments;
+
+            // Number of the segment at the front, and the last event published
+            uint64_t first_segment = 0;
+            uint64_t sequence = 0;
+
+            std::vector<Standby> standbys;
+    };
+
+    class ReplicationSubscriber {
+        /*
+         * Follows the event stream of a primary from a hot standby.
+         *
+         * The subscriber disconnects when the primary goes away or the stream
+         * skips an event, which is the standby's signal to take over.
+         */
+        public:
+            typedef std::function<void(const ReplicationEvent& e)> EventHandler;
+
+            ReplicationSubscriber() {}
+            ~ReplicationSubscriber();
+
+            ReplicationSubscriber(const ReplicationSubscriber&) = delete;
+            ReplicationSubscriber& operator =(const ReplicationSubscriber&) = delete;
+
+            bool connect(const std::string& address, uint16_t port, uint64_t next_sequence);
+            bool is_connected() const { return fd >= 0; }
+
+            size_t poll(EventHandler handler);
+
+            uint64_t get_next_sequence() const { return next_sequence; }
+        private:
+            void disconnect();
+
+            int fd = -1;
+            FrameDecoder decoder;
+            uint64_t next_sequence = 1;
+    };
+}
+
+#endif
@@ -0,0 +1,279 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shm_ring.h"
+
+namespace exchange {
+    // Identifies a ring file and the version of its layout
+    const uint64_t SHM_RING_MAGIC = 0x4c54524e47000001ULL;
+
+    const size_t SHM_CACHE_LINE = 64;
+
+    // Set in a slot's sequence while a publisher is writing to it
+    const uint64_t SLOT_WRITING = 1ULL << 63;
+
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared rings need lock-free 64 bit atomics");
+
+    struct ShmRing::Header {
+        std::atomic<uint64_t> magic;
+        uint64_t slot_count;
+        uint64_t slot_size;
+        uint64_t gated;
+
+        // Publishers and the consumer each get their own cache line
+        alignas(SHM_CACHE_LINE) std::atomic<uint64_t> claimed;
+        alignas(SHM_CACHE_LINE) std::atomic<uint64_t> released;
+    };
+
+    struct ShmRing::Slot {
+        std::atomic<uint64_t> sequence;
+        uint64_t size;
+    };
+
+    static std::string shm_path(const std::string& name) {
+        return "/" + name;
+    }
+
+    static void put_le(std::string& out, uint64_t value, size_t bytes) {
+        for (size_t b = 0; b < bytes; b++) {
+            out += (char) ((value >> (8 * b)) & 0xff);
+        }
+    }
+
+    static uint64_t get_le(const char* data, size_t bytes) {
+        uint64_t value = 0;
+        for (size_t b = 0; b < bytes; b++) {
+            value |= ((uint64_t) (unsigned char) data[b]) << (8 * b);
+        }
+        return value;
+    }
+
+    std::string encode_routed(uint32_t gateway, uint64_t session, const std::string& payload) {
+        std::string message;
+        message.reserve(ROUTE_HEADER_SIZE + payload.size());
+        put_le(message, gateway, 4);
+        put_le(message, session, 8);
+        message += payload;
+
+        return message;
+    }
+
+    bool decode_routed(const char* data, size_t size, uint32_t* gateway, uint64_t* session,
+                       const char** payload, size_t* payload_size) {
+        if (size < ROUTE_HEADER_SIZE) {
+            return false;
+        }
+
+        *gateway = (uint32_t) get_le(data, 4);
+        *session = get_le(data + 4, 8);
+        *payload = data + ROUTE_HEADER_SIZE;
+        *payload_size = size - ROUTE_HEADER_SIZE;
+
+        return true;
+    }
+
+    ShmRing::~ShmRing() {
+        if (header != nullptr) {
+            munmap(header, mapped_size);
+        }
+    }
+
+    bool ShmRing::create(const std::string& ring_name, size_t slots_wanted,
+                         size_t max_message_size, bool gated) {
+        /*
+         * Create the ring as /dev/shm/<ring_name>. The slot count is
+         * rounded up to a power of two and slots to whole cache lines.
+         */
+        size_t count = 1;
+        while (count < slots_wanted) {
+            count <<= 1;
+        }
+
+        size_t size = sizeof(Slot) + max_message_size;
+        size = (size + SHM_CACHE_LINE - 1) / SHM_CACHE_LINE * SHM_CACHE_LINE;
+
+        std::string path = shm_path(ring_name);
+        shm_unlink(path.c_str());
+
+        int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            std::cerr << "Failed to create shared ring " << ring_name << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        // The new file is all zeros, so every slot starts out empty
+        size_t total = sizeof(Header) + count * size;
+        if (ftruncate(fd, total) < 0 || !map(fd, total)) {
+            std::cerr << "Failed to size shared ring " << ring_name << ": " << strerror(errno) << std::endl;
+            close(fd);
+            shm_unlink(path.c_str());
+            return false;
+        }
+        close(fd);
+
+        name = ring_name;
+        header->slot_count = slot_count = count;
+        header->slot_size = slot_size = size;
+        header->gated = gated ? 1 : 0;
+
+        // Readers attaching before this see no ring at all
+        header->magic.store(SHM_RING_MAGIC, std::memory_order_release);
+
+        return true;
+    }
+
+    bool ShmRing::open(const std::string& ring_name) {
+        std::string path = shm_path(ring_name);
+        int fd = shm_open(path.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            std::cerr << "Failed to open shared ring " << ring_name << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        struct stat file;
+        if (fstat(fd, &file) < 0 || (size_t) file.st_size < sizeof(Header) || !map(fd, file.st_size)) {
+            std::cerr << "Failed to map shared ring " << ring_name << std::endl;
+            close(fd);
+            return false;
+        }
+        close(fd);
+
+        if (header->magic.load(std::memory_order_acquire) != SHM_RING_MAGIC ||
+            sizeof(Header) + header->slot_count * header->slot_size > mapped_size) {
+            std::cerr << "Shared ring " << ring_name << " isn't ready or has another layout" << std::endl;
+            munmap(header, mapped_size);
+            header = nullptr;
+            return false;
+        }
+
+        name = ring_name;
+        slot_count = header->slot_count;
+        slot_size = header->slot_size;
+
+        return true;
+    }
+
+    void ShmRing::unlink() {
+        /*
+         * Remove the ring's file. Processes that have it mapped keep using
+         * it until they let go of it.
+         */
+        if (!name.empty()) {
+            shm_unlink(shm_path(name).c_str());
+        }
+    }
+
+    void ShmRing::recover() {
+        /*
+         * Only the ring's single publisher calls this, before it publishes,
+         * so the last claimed message is the only one that can be
+         * unfinished and nothing else is writing to it.
+         */
+        uint64_t last = header->claimed.load(std::memory_order_acquire);
+        if (last == 0) {
+            return;
+        }
+
+        Slot* slot = slot_for(last);
+        if (slot->sequence.load(std::memory_order_acquire) != last) {
+            slot->size = 0;
+            slot->sequence.store(last, std::memory_order_release);
+        }
+    }
+
+    bool ShmRing::map(int fd, size_t size) {
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+
+        header = static_cast<Header*>(memory);
+        slots = static_cast<char*>(memory) + sizeof(Header);
+        mapped_size = size;
+
+        return true;
+    }
+
+    ShmRing::Slot* ShmRing::slot_for(uint64_t sequence) const {
+        return reinterpret_cast<Slot*>(slots + (sequence & (slot_count - 1)) * slot_size);
+    }
+
+    size_t ShmRing::get_max_message_size() const {
+        return slot_size - sizeof(Slot);
+    }
+
+    bool ShmRing::publish(const char* data, size_t size) {
+        /*
+         * Copy a message into the next slot. Safe to call from any thread
+         * of any process.
+         *
+         * Returns false when the message is too large for a slot, or when
+         * a gated ring is full until its consumer releases some messages.
+         */
+        if (header == nullptr || size > get_max_message_size()) {
+            return false;
+        }
+
+        uint64_t last = header->claimed.load(std::memory_order_relaxed);
+        do {
+            if (header->gated && last + 1 > header->released.load(std::memory_order_acquire) + slot_count) {
+                return false;
+            }
+        } while (!header->claimed.compare_exchange_weak(last, last + 1, std::memory_order_acq_rel));
+
+        uint64_t sequence = last + 1;
+        Slot* slot = slot_for(sequence);
+
+        // Readers still on the message being replaced see it change under them
+        slot->sequence.store(sequence | SLOT_WRITING, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot->size = size;
+        std::memcpy(reinterpret_cast<char*>(slot) + sizeof(Slot), data, size);
+        slot->sequence.store(sequence, std::memory_order_release);
+
+        return true;
+    }
+
+    ShmReadResult ShmRing::peek(uint64_t sequence, const char** data, size_t* size) const {
+        /*
+         * Find a message in place. The data stays valid until the message
+         * is released, for a gated ring, or until is_current() says it has
+         * been overwritten.
+         */
+        Slot* slot = slot_for(sequence);
+        uint64_t current = slot->sequence.load(std::memory_order_acquire);
+
+        if (current == sequence) {
+            *data = reinterpret_cast<const char*>(slot) + sizeof(Slot);
+            *size = slot->size;
+            return SHM_READY;
+        }
+
+        return ((current & ~SLOT_WRITING) > sequence) ? SHM_OVERRUN : SHM_EMPTY;
+    }
+
+    bool ShmRing::is_current(uint64_t sequence) const {
+        // Whatever was read from the slot happens before this check
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot_for(sequence)->sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+    void ShmRing::release(uint64_t sequence) {
+        /*
+         * Let publishers reuse the slots of every message up to sequence.
+         * Only the consumer of a gated ring calls this.
+         */
+        header->released.store(sequence, std::memory_order_release);
+    }
+
+    uint64_t ShmRing::get_last_sequence() const {
+        return header->claimed.load(std::memory_order_acquire);
+    }
+}
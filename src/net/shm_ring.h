@@ -0,0 +1,101 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace exchange {
+    // Messages between gateway processes and the matching engine start with
+    //     the ID of the gateway, as 4 bytes, and the session on that gateway,
+    //     as 8 bytes, both little endian. Messages from the engine for
+    //     gateway 0 are for everyone.
+    const size_t ROUTE_HEADER_SIZE = 12;
+
+    std::string encode_routed(uint32_t gateway, uint64_t session, const std::string& payload);
+    bool decode_routed(const char* data, size_t size, uint32_t* gateway, uint64_t* session,
+                       const char** payload, size_t* payload_size);
+
+    enum ShmReadResult {
+        // The message hasn't been published yet
+        SHM_EMPTY,
+        SHM_READY,
+
+        // The message has already been overwritten by a later one
+        SHM_OVERRUN
+    };
+
+    class ShmRing {
+        /*
+         * A ring of fixed size message slots in a file under /dev/shm,
+         * shared between processes on the same host.
+         *
+         * Any number of processes may publish. Each message gets the next
+         * sequence number, starting from 1, and lands in the slot for that
+         * sequence. Any number of readers follow the ring by sequence,
+         * reading messages in place without copying them out.
+         *
+         * A publisher that dies between claiming a slot and finishing its
+         * message leaves readers waiting on that slot for good. A ring that
+         * must outlive its publisher has only the one, which calls
+         * recover() whenever it attaches.
+         *
+         * A gated ring has one consumer that releases messages once it is
+         * done with them, and publishers never overwrite a message before
+         * it is released, so nothing is lost. In an ungated ring publishers
+         * never wait and readers that fall a whole ring behind are overrun.
+         * A reader of an ungated ring must check is_current() after using
+         * a message, as it may have been overwritten while it was read.
+         */
+        public:
+            ShmRing() {}
+            ~ShmRing();
+
+            ShmRing(const ShmRing&) = delete;
+            ShmRing& operator =(const ShmRing&) = delete;
+
+            // Create the ring, replacing any left behind by an earlier run
+            bool create(const std::string& name, size_t slot_count, size_t max_message_size, bool gated);
+
+            // Attach to a ring created by another process
+            bool open(const std::string& name);
+
+            void unlink();
+
+            // Finish a message left half published by a publisher that died
+            //     as an empty one, which readers skip
+            void recover();
+
+            bool publish(const char* data, size_t size);
+            bool publish(const std::string& message) { return publish(message.data(), message.size()); }
+
+            ShmReadResult peek(uint64_t sequence, const char** data, size_t* size) const;
+            bool is_current(uint64_t sequence) const;
+            void release(uint64_t sequence);
+
+            // Sequence of the last message claimed by a publisher, so a
+            //     reader only interested in new messages starts after it
+            uint64_t get_last_sequence() const;
+
+            size_t get_slot_count() const { return slot_count; }
+            size_t get_max_message_size() const;
+            bool is_open() const { return header != nullptr; }
+        private:
+            struct Header;
+            struct Slot;
+
+            bool map(int fd, size_t size);
+            Slot* slot_for(uint64_t sequence) const;
+
+            std::string name;
+            Header* header = nullptr;
+            char* slots = nullptr;
+            size_t mapped_size = 0;
+
+            size_t slot_count = 0;
+            size_t slot_size = 0;
+    };
+}
+
+#endif
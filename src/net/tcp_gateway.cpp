@@ -0,0 +1,418 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "low_latency.h"
+#include "tcp_gateway.h"
+
+namespace exchange {
+    // Epoll tags for the sockets that aren't sessions
+    const uint64_t LISTEN_TAG = 0;
+    const uint64_t WAKE_TAG = UINT64_MAX;
+
+    const int MAX_EVENTS = 64;
+
+    // Empty polls before a busy polling gateway starts yielding its core
+    const long BUSY_POLL_SPIN_LIMIT = 100000;
+
+    std::string encode_frame(const std::string& payload) {
+        std::string frame(FRAME_HEADER_SIZE, '\0');
+        for (size_t b = 0; b < FRAME_HEADER_SIZE; b++) {
+            frame[b] = (char) ((payload.size() >> (8 * b)) & 0xff);
+        }
+
+        frame += payload;
+        return frame;
+    }
+
+    bool FrameDecoder::append(const char* data, size_t size) {
+        /*
+         * Add bytes read from the socket. Returns false once the stream has
+         * contained a frame larger than MAX_FRAME_SIZE.
+         */
+        if (corrupt) {
+            return false;
+        }
+
+        // Drop frames that have already been handed out before growing
+        if (offset > 0 && offset == buffer.size()) {
+            buffer.clear();
+            offset = 0;
+        }
+
+        buffer.append(data, size);
+        return true;
+    }
+
+    bool FrameDecoder::next(std::string& payload) {
+        /*
+         * Take the next complete frame. Returns false when no complete
+         * frame has been received yet.
+         */
+        if (corrupt || buffer.size() - offset < FRAME_HEADER_SIZE) {
+            return false;
+        }
+
+        size_t length = 0;
+        for (size_t b = 0; b < FRAME_HEADER_SIZE; b++) {
+            length |= ((size_t) (unsigned char) buffer[offset + b]) << (8 * b);
+        }
+
+        if (length > MAX_FRAME_SIZE) {
+            corrupt = true;
+            return false;
+        }
+
+        if (buffer.size() - offset < FRAME_HEADER_SIZE + length) {
+            // Move the partial frame to the front so the buffer doesn't grow
+            buffer.erase(0, offset);
+            offset = 0;
+            return false;
+        }
+
+        payload.assign(buffer, offset + FRAME_HEADER_SIZE, length);
+        offset += FRAME_HEADER_SIZE + length;
+
+        return true;
+    }
+
+    static bool set_nonblocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    TcpGateway::TcpGateway(MessageHandler handler, bool busy_poll, size_t max_write_buffer,
+                           size_t reply_queue_size)
+        : handler(handler)
+        , busy_poll(busy_poll)
+        , max_write_buffer(max_write_buffer)
+        , running(false)
+        , replies(reply_queue_size)
+        , overflow_pending(false)
+        , dropped_replies(0) {}
+
+    TcpGateway::~TcpGateway() {
+        for (auto& it : sessions) {
+            close(it.second.fd);
+        }
+
+        if (listen_fd >= 0) { close(listen_fd); }
+        if (epoll_fd >= 0) { close(epoll_fd); }
+        if (wake_fd >= 0) { close(wake_fd); }
+    }
+
+    bool TcpGateway::listen(const std::string& address, uint16_t listen_port) {
+        /*
+         * Listen for sessions on address:listen_port. A port of zero picks
+         * any free port, which can be found with get_port().
+         *
+         * The gateway counts as running from here, so a stop() that comes
+         * before the thread gets to run() isn't lost.
+         */
+        sockaddr_in local;
+        std::memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_port = htons(listen_port);
+
+        if (inet_pton(AF_INET, address.c_str(), &local.sin_addr) != 1) {
+            std::cerr << "Invalid gateway address " << address << std::endl;
+            return false;
+        }
+
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        epoll_fd = epoll_create1(0);
+        wake_fd = eventfd(0, EFD_NONBLOCK);
+        if (listen_fd < 0 || epoll_fd < 0 || wake_fd < 0) {
+            std::cerr << "Failed to create gateway sockets: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        int reuse = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if (bind(listen_fd, (sockaddr*) &local, sizeof(local)) < 0 ||
+            ::listen(listen_fd, SOMAXCONN) < 0 || !set_nonblocking(listen_fd)) {
+            std::cerr << "Failed to listen on gateway port: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        socklen_t size = sizeof(local);
+        getsockname(listen_fd, (sockaddr*) &local, &size);
+        port = ntohs(local.sin_port);
+
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLET;
+        event.data.u64 = LISTEN_TAG;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+
+        event.events = EPOLLIN | EPOLLET;
+        event.data.u64 = WAKE_TAG;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+
+        running.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void TcpGateway::run() {
+        /*
+         * Handle sessions until stop() is called.
+         */
+        epoll_event events[MAX_EVENTS];
+        WaitStrategy wait(BUSY_POLL_SPIN_LIMIT);
+
+        while (running.load(std::memory_order_acquire)) {
+            int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, busy_poll ? 0 : -1);
+
+            if (busy_poll) {
+                if (ready > 0) {
+                    wait.reset();
+                } else {
+                    wait.idle();
+                }
+            }
+
+            for (int e = 0; e < ready; e++) {
+                uint64_t tag = events[e].data.u64;
+
+                if (tag == LISTEN_TAG) {
+                    accept_sessions();
+                } else if (tag == WAKE_TAG) {
+                    uint64_t count;
+                    while (read(wake_fd, &count, sizeof(count)) > 0) {}
+                } else {
+                    auto it = sessions.find(tag);
+                    if (it == sessions.end()) {
+                        continue;
+                    }
+
+                    if (events[e].events & (EPOLLERR | EPOLLHUP)) {
+                        close_session(tag);
+                        continue;
+                    }
+
+                    if (events[e].events & EPOLLOUT) {
+                        write_session(tag);
+                    }
+
+                    if ((events[e].events & (EPOLLIN | EPOLLRDHUP)) && sessions.count(tag) > 0) {
+                        read_session(tag);
+                    }
+                }
+            }
+
+            drain_replies();
+        }
+    }
+
+    void TcpGateway::stop() {
+        running.store(false, std::memory_order_release);
+
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0) {
+            std::cerr << "Failed to wake gateway thread" << std::endl;
+        }
+    }
+
+    void TcpGateway::send(uint64_t session, const std::string& payload) {
+        /*
+         * Queue a reply for a session. Safe to call from any thread, and
+         * never waits for the gateway thread to make room.
+         */
+        Reply r;
+        r.session = session;
+        r.frame = encode_frame(payload);
+
+        if (!replies.try_push(std::move(r))) {
+            // Only contended with the gateway thread taking the list, which
+            //     is a swap, so this doesn't wait on the gateway either
+            std::lock_guard<std::mutex> guard(overflow_lock);
+            overflowed.push_back(session);
+            overflow_pending.store(true, std::memory_order_release);
+            dropped_replies.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // A busy polling gateway picks the reply up without being woken
+        if (!busy_poll) {
+            uint64_t one = 1;
+            if (write(wake_fd, &one, sizeof(one)) < 0) {
+                std::cerr << "Failed to wake gateway thread" << std::endl;
+            }
+        }
+    }
+
+    void TcpGateway::accept_sessions() {
+        // Edge triggered, so accept until there is nobody left waiting
+        int fd;
+        while ((fd = accept(listen_fd, nullptr, nullptr)) >= 0) {
+            int nodelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+            set_nonblocking(fd);
+
+            uint64_t id = next_session++;
+            sessions[id].fd = fd;
+
+            epoll_event event;
+            event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            event.data.u64 = id;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+        }
+    }
+
+    void TcpGateway::read_session(uint64_t id) {
+        Session& s = sessions[id];
+        char data[16384];
+
+        for (;;) {
+            ssize_t received = read(s.fd, data, sizeof(data));
+
+            if (received > 0) {
+                s.decoder.append(data, received);
+
+                std::string payload;
+                while (s.decoder.next(payload)) {
+                    handler(id, payload);
+                }
+
+                if (s.decoder.is_corrupt()) {
+                    std::cerr << "Closing gateway session sending oversized frames" << std::endl;
+                    close_session(id);
+                    return;
+                }
+            } else if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return;
+            } else {
+                // Closed by the other end or failed
+                close_session(id);
+                return;
+            }
+        }
+    }
+
+    void TcpGateway::write_session(uint64_t id) {
+        /*
+         * Write as much of the session's waiting replies as the socket will
+         * take, closing the session if the socket has failed.
+         *
+         * Written replies are dropped from the front of the buffer only once
+         * they are more than half of it, so a session that is slow to read
+         * doesn't have its whole buffer moved after every partial write.
+         */
+        auto it = sessions.find(id);
+        if (it == sessions.end()) {
+            return;
+        }
+
+        Session& s = it->second;
+        while (s.write_offset < s.write_buffer.size()) {
+            ssize_t written = ::send(s.fd, s.write_buffer.data() + s.write_offset,
+                                     s.write_buffer.size() - s.write_offset, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    // The rest is written when epoll reports the socket writable
+                    break;
+                }
+
+                // Reset by the other end or failed
+                close_session(id);
+                return;
+            }
+
+            s.write_offset += written;
+        }
+
+        if (s.write_offset == s.write_buffer.size()) {
+            s.write_buffer.clear();
+            s.write_offset = 0;
+        } else if (s.write_offset > s.write_buffer.size() / 2) {
+            s.write_buffer.erase(0, s.write_offset);
+            s.write_offset = 0;
+        }
+    }
+
+    void TcpGateway::drain_replies() {
+        /*
+         * Gather every waiting reply into its session's buffer first so that
+         * each session gets a single write however many replies it has.
+         */
+        close_overflowed();
+
+        std::vector<uint64_t> touched;
+
+        Reply r;
+        while (replies.try_pop(r)) {
+            auto it = sessions.find(r.session);
+            if (it == sessions.end()) {
+                continue;
+            }
+
+            Session& s = it->second;
+            size_t unwritten = s.write_buffer.size() - s.write_offset;
+            if (unwritten + r.frame.size() > max_write_buffer) {
+                std::cerr << "Disconnecting slow gateway session with " << unwritten
+                          << " bytes unread" << std::endl;
+                slow_disconnects++;
+                close_session(r.session);
+                continue;
+            }
+
+            if (unwritten == 0) {
+                touched.push_back(r.session);
+            }
+            s.write_buffer += r.frame;
+        }
+
+        for (auto id : touched) {
+            write_session(id);
+        }
+    }
+
+    void TcpGateway::close_overflowed() {
+        /*
+         * Disconnect the sessions that had replies dropped. This comes
+         * before their queued replies are written so that a session isn't
+         * sent replies with a gap in them.
+         */
+        if (!overflow_pending.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        std::vector<uint64_t> ids;
+        {
+            std::lock_guard<std::mutex> guard(overflow_lock);
+            ids.swap(overflowed);
+            overflow_pending.store(false, std::memory_order_relaxed);
+        }
+
+        for (auto id : ids) {
+            if (sessions.count(id) > 0) {
+                std::cerr << "Disconnecting gateway session after dropping replies for a full queue"
+                          << std::endl;
+                close_session(id);
+            }
+        }
+    }
+
+    void TcpGateway::close_session(uint64_t id) {
+        auto it = sessions.find(id);
+        if (it == sessions.end()) {
+            return;
+        }
+
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        close(it->second.fd);
+        sessions.erase(it);
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef TCP_GATEWAY_H
+#define TCP_GATEWAY_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mpsc_queue.h"
+
+namespace exchange {
+    // Frames are a 4 byte little endian payload length followed by the payload
+    const size_t FRAME_HEADER_SIZE = 4;
+
+    // Larger frames can't be valid messages so the session is dropped
+    const size_t MAX_FRAME_SIZE = 4096;
+
+    // Bytes of replies a session may leave unread before it is disconnected
+    const size_t TCP_MAX_WRITE_BUFFER = 4 << 20;
+
+    // Replies that can wait for the gateway thread
+    const size_t TCP_REPLY_QUEUE_SIZE = 65536;
+
+    std::string encode_frame(const std::string& payload);
+
+    class FrameDecoder {
+        /*
+         * Splits a stream of bytes from a socket back into frames.
+         */
+        public:
+            bool append(const char* data, size_t size);
+            bool next(std::string& payload);
+
+            bool is_corrupt() const { return corrupt; }
+        private:
+            std::string buffer;
+            size_t offset = 0;
+
+            bool corrupt = false;
+    };
+
+    class TcpGateway {
+        /*
+         * Accepts raw TCP order entry sessions using length prefixed frames.
+         *
+         * All sockets are handled by one thread running an edge-triggered
+         * epoll loop. Frames are passed to the message handler on that thread;
+         * replies can be sent from any thread and are written out by the
+         * gateway thread, with everything waiting for a session written in
+         * one call.
+         *
+         * A session that stops reading is disconnected once its unwritten
+         * replies pass max_write_buffer bytes, the same as the DISCONNECT
+         * slow consumer policy, rather than holding ever more memory.
+         *
+         * Sending never waits for the gateway thread. When the reply queue
+         * is full the reply is dropped and its session is disconnected, as
+         * it can no longer be given a complete stream of replies.
+         *
+         * With busy polling the loop never sleeps in the kernel, trading a
+         * core for lower latency.
+         */
+        public:
+            typedef std::function<void(uint64_t session, const std::string& payload)> MessageHandler;
+
+            TcpGateway(MessageHandler handler, bool busy_poll,
+                       size_t max_write_buffer = TCP_MAX_WRITE_BUFFER,
+                       size_t reply_queue_size = TCP_REPLY_QUEUE_SIZE);
+            ~TcpGateway();
+
+            TcpGateway(const TcpGateway&) = delete;
+            TcpGateway& operator =(const TcpGateway&) = delete;
+
+            bool listen(const std::string& address, uint16_t port);
+            uint16_t get_port() const { return port; }
+
+            void run();
+            void stop();
+
+            void send(uint64_t session, const std::string& payload);
+
+            size_t get_session_count() const { return sessions.size(); }
+            long get_slow_disconnects() const { return slow_disconnects; }
+            long get_dropped_replies() const { return dropped_replies.load(std::memory_order_relaxed); }
+        private:
+            struct Session {
+                int fd;
+                FrameDecoder decoder;
+
+                // Replies from write_offset on are still to be written
+                std::string write_buffer;
+                size_t write_offset = 0;
+            };
+
+            struct Reply {
+                uint64_t session = 0;
+                std::string frame;
+            };
+
+            void accept_sessions();
+            void read_session(uint64_t id);
+            void write_session(uint64_t id);
+            void drain_replies();
+            void close_overflowed();
+            void close_session(uint64_t id);
+
+            MessageHandler handler;
+            bool busy_poll;
+            size_t max_write_buffer;
+
+            int listen_fd = -1;
+            int epoll_fd = -1;
+            int wake_fd = -1;
+            uint16_t port = 0;
+
+            std::atomic<bool> running;
+
+            // Only touched by the gateway thread
+            std::unordered_map<uint64_t, Session> sessions;
+            uint64_t next_session = 1;
+            long slow_disconnects = 0;
+
+            MpscQueue<Reply> replies;
+
+            // Sessions that had a reply dropped because the queue was full,
+            //     waiting for the gateway thread to disconnect them
+            std::mutex overflow_lock;
+            std::vector<uint64_t> overflowed;
+            std::atomic<bool> overflow_pending;
+            std::atomic<long> dropped_replies;
+    };
+}
+
+#endif
@@ -1,18 +1,52 @@
-#include <set>
-#include <mutex>
+#include <deque>
+#include <map>
+#include <memory>
+#include <unordered_map>
 
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
 #include <thread>
 
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
 #include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
 #include <websocketpp/server.hpp>
 
+#include "bars.h"
+#include "clock.h"
+#include "exchange.h"
+#include "listener.h"
+#include "low_latency.h"
+#include "md_feed.h"
+#include "messages.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#include "mpsc_queue.h"
 #include "order.h"
 #include "orderbook.h"
+#include "outbound_queue.h"
+#include "replication.h"
+#include "risk.h"
+#include "shm_ring.h"
+#include "tcp_gateway.h"
+#include "trade.h"
+#include "trade_export.h"
 
-typedef websocketpp::server<websocketpp::config::asio> server;
+// The default config with the permessage-deflate extension, which is
+//     negotiated with clients that offer it. Only messages marked as
+//     compressed are, so sessions that don't ask for it are unaffected.
+struct deflate_config : public websocketpp::config::asio {
+    struct permessage_deflate_config {};
+
+    typedef websocketpp::extensions::permessage_deflate::enabled<permessage_deflate_config>
+        permessage_deflate_type;
+};
+
+typedef websocketpp::server<deflate_config> server;
 
 using websocketpp::connection_hdl;
 using websocketpp::lib::placeholders::_1;
@@ -21,9 +55,233 @@ using websocketpp::lib::bind;
 
 const int PORT = 9000;
 
-class broadcast_server {
+// Pre-trade risk limits applied to every client
+const int MAX_ORDER_SIZE = 100000;
+const double PRICE_BAND = 0.2;
+const long MAX_OPEN_QUANTITY = 1000000;
+const long MAX_POSITION = 1000000;
+const int MAX_MESSAGES_PER_SECOND = 10000;
+
+// Number of requests that can wait for the matching thread
+const size_t REQUEST_QUEUE_SIZE = 65536;
+
+// Empty polls of the request queue before the matching thread sleeps, or
+//     yields when busy waiting
+const long MATCHING_SPIN_LIMIT = 10000;
+
+// Passes of the matching loop between looks at the clock, and how often
+//     the housekeeping between requests runs, busy or idle, spinning or not
+const long HOUSEKEEPING_CHECK_POLLS = 64;
+const std::chrono::milliseconds HOUSEKEEPING_INTERVAL(1);
+
+// Settings used by --low-latency
+const long LOW_LATENCY_SPIN_LIMIT = 10000000;
+const size_t LOW_LATENCY_TRADE_ARENA_MB = 256;
+const int LOW_LATENCY_WARM_UP_ORDERS = 100000;
+
+// Trades the book has room for before its trade list has to grow
+const size_t TRADE_RESERVE = 1 << 20;
+
+// Messages that may wait for a slow connection before its policy applies
+const size_t MD_QUEUE_SIZE = 4096;
+const size_t ORDER_QUEUE_SIZE = 4096;
+
+// Bytes websocketpp may be holding for a connection before we stop
+//     handing it more messages
+const size_t MAX_BUFFERED_BYTES = 256 * 1024;
+
+// Connections opened on this resource are market data sessions
+const std::string MARKET_DATA_RESOURCE = "/md";
+
+// Connections opened on this resource may start auctions and open and close
+//     markets, when the server allows operator sessions
+const std::string OPERATOR_RESOURCE = "/operator";
+
+// Defaults for the UDP market data feed, which is off unless a group is given
+const uint16_t MD_FEED_PORT = 9100;
+const uint16_t MD_REQUEST_PORT = 9101;
+const std::string MD_INTERFACE = "127.0.0.1";
+const size_t MD_RETRANSMIT_BUFFER_SIZE = 1 << 20;
+
+// The TCP order entry gateway is off unless a port is given
+const std::string TCP_GATEWAY_ADDRESS = "0.0.0.0";
+
+// Metrics are only served locally, and are off unless a port is given
+const std::string METRICS_ADDRESS = "127.0.0.1";
+
+// Standbys follow the primary over local TCP, which is off unless a port
+//     is given. The primary sends a checksum of its books every so many
+//     events for the standbys to compare with their own.
+const std::string REPLICATION_ADDRESS = "127.0.0.1";
+const uint64_t CHECKSUM_INTERVAL = 1000;
+
+// Megabytes of events kept for standbys that connect late or fall behind
+const size_t REPLICATION_LOG_MB = 1024;
+
+// Shared memory rings for gateway processes, off unless a name is given.
+//     Each gateway's requests wait for the matching thread, while its
+//     replies are held back for it when its ring is full and broadcast
+//     events are overwritten once every reader has had a ring's worth of
+//     time to read them.
+const size_t IPC_REQUEST_SLOTS = 16384;
+const size_t IPC_REPLY_SLOTS = 16384;
+const size_t IPC_EVENT_SLOTS = 65536;
+const size_t IPC_MAX_MESSAGE_SIZE = 1024;
+const uint32_t IPC_GATEWAYS = 8;
+
+// Replies held back for a gateway with a full reply ring before it is taken
+//     to be too slow and further replies are dropped
+const size_t IPC_REPLY_BACKLOG = 65536;
+
+// Bars kept for each interval, and the number sent when a query doesn't say
+const size_t BAR_HISTORY = 1440;
+const size_t DEFAULT_BAR_COUNT = 100;
+
+struct server_config {
+    int io_threads = 1;
+
+    size_t md_queue_size = MD_QUEUE_SIZE;
+    exchange::SlowConsumerPolicy md_policy = exchange::DROP_TO_SNAPSHOT;
+
+    size_t order_queue_size = ORDER_QUEUE_SIZE;
+    exchange::SlowConsumerPolicy order_policy = exchange::DISCONNECT;
+
+    std::string md_group;
+    uint16_t md_port = MD_FEED_PORT;
+    uint16_t md_request_port = MD_REQUEST_PORT;
+    std::string md_interface = MD_INTERFACE;
+
+    uint16_t tcp_port = 0;
+    bool tcp_busy_poll = false;
+
+    uint16_t metrics_port = 0;
+
+    // Compress market data sessions that negotiate permessage-deflate, and
+    //     send them top of book at most once per interval (0 for every update)
+    bool md_deflate = false;
+    long md_conflate_ms = 0;
+
+    // Port standbys follow this server on, and the host:port of the primary
+    //     when this server is a standby
+    uint16_t replication_port = 0;
+    std::string standby_of;
+    size_t replication_log_mb = REPLICATION_LOG_MB;
+
+    // Name of the shared memory rings gateway processes connect to, and
+    //     the number of gateways given rings, with IDs from 1
+    std::string ipc_ring;
+    uint32_t ipc_gateways = IPC_GATEWAYS;
+
+    // Start with an auction call instead of continuous trading
+    bool opening_auction = false;
+
+    // Let websocket connections to OPERATOR_RESOURCE control the market
+    bool operator_sessions = false;
+
+    // How the book keeps its price levels
+    exchange::BookConfig book;
+
+    // Bar intervals in seconds
+    std::vector<long> bar_intervals = {1, 60};
+
+    // CPUs for the matching and gateway threads, -1 leaves them unpinned
+    int matching_cpu = -1;
+    int gateway_cpu = -1;
+
+    long spin_limit = MATCHING_SPIN_LIMIT;
+    bool lock_memory = false;
+
+    // Keep the matching thread on its core once it stops spinning instead
+    //     of sleeping until there is work
+    bool busy_wait = false;
+
+    // Size of the hugepage backed arena trades are allocated from, 0 for none
+    size_t trade_arena_mb = 0;
+
+    // Time requests with the CPU timestamp counter instead of the system clock
+    bool tsc_clock = false;
+
+    // File trades are exported to as they happen, with closed orders too
+    //     when export_orders is set
+    std::string export_file;
+    bool export_orders = false;
+    int warm_up_orders = 0;
+};
+
+enum request_type {
+    OPEN,
+    CLOSE,
+    MESSAGE,
+    // A message that couldn't be decoded, which still gets a reply so
+    //     that every message a session sends is answered once
+    MALFORMED
+};
+
+// An event from an io thread waiting to be handled by the matching thread
+struct request {
+    request_type type = MESSAGE;
+    connection_hdl hdl;
+    std::string payload;
+
+    // Set when the payload was decoded as an order by the io thread
+    exchange::Order* order = nullptr;
+
+    // Set for messages from the TCP gateway instead of a websocket connection
+    uint64_t tcp_session = 0;
+
+    // Set for messages from a gateway process
+    uint32_t ipc_gateway = 0;
+    uint64_t ipc_session = 0;
+};
+
+// Where fills of an accepted order are sent, only touched by the matching thread
+struct order_route {
+    uint64_t id = 0;
+
+    // The message the order came in, without its payload, to reply to
+    request origin;
+};
+
+// Outbound state for a connection, only touched by the matching thread
+struct session {
+    session(bool market_data, size_t queue_size, exchange::SlowConsumerPolicy policy)
+        : market_data(market_data), queue(queue_size, policy) {}
+
+    bool market_data;
+    bool closing = false;
+    bool compressed = false;
+    exchange::SessionRole role = exchange::ORDER_ENTRY_SESSION;
+
+    exchange::OutboundQueue queue;
+
+    // The latest top of book held back by conflation, and when the last
+    //     one was sent
+    std::string pending_top;
+    std::chrono::steady_clock::time_point last_top;
+};
+
+// The rings of one gateway process, only touched by the matching thread
+struct ipc_gateway_rings {
+    // Requests from the gateway, which is their only publisher, and the
+    //     sequence of the next one to take
+    exchange::ShmRing requests;
+    uint64_t next_request = 1;
+
+    exchange::ShmRing replies;
+
+    // Replies waiting for room on the ring, in order. The gateway is slow
+    //     once the backlog is full and replies are dropped until it clears.
+    std::deque<std::string> backlog;
+    bool slow = false;
+};
+
+class broadcast_server : public exchange::BookListener {
 public:
-    broadcast_server() : i(0), ob("ABC") {
+    broadcast_server(server_config config)
+        : m_config(config)
+        , m_bars(bar_intervals_ms(config.bar_intervals), BAR_HISTORY)
+        , m_requests(REQUEST_QUEUE_SIZE)
+        , m_running(false) {
         m_server.init_asio();
 
         m_server.set_open_handler(bind(&broadcast_server::on_open,this,::_1));
@@ -35,100 +293,1317 @@ public:
         m_server.clear_access_channels(websocketpp::log::alevel::all);
         m_server.set_access_channels(channels);
 
-        ob.set_trade_announcements(true);
+        if (m_config.warm_up_orders > 0) {
+            exchange::warm_up("ABC", m_config.warm_up_orders);
+        }
+
+        if (m_config.tsc_clock) {
+            m_clock.reset(new exchange::TscClock());
+        } else {
+            m_clock.reset(new exchange::SystemClock());
+        }
+
+        // Books see the time each event was applied at, which is the
+        //     primary's time when following it
+        ex.set_clock(&m_event_clock);
+
+        ob = ex.add_instrument("ABC", m_config.book);
+        ob->set_trade_announcements(true);
+        ob->add_listener(this);
+        ob->add_listener(&m_bars);
+
+        if (!m_config.export_file.empty() &&
+            m_exporter.open(m_config.export_file, m_config.export_orders)) {
+            ob->add_listener(&m_exporter);
+        }
+        ob->set_metrics(m_metrics);
+
+        m_requests_metric = &m_metrics.counter("exchange_requests_total",
+                                               "Messages handed to the matching thread");
+        m_connections_metric = &m_metrics.gauge("exchange_connections", "Open websocket connections");
+        m_queue_depth_metric = &m_metrics.gauge("exchange_send_queue_depth",
+                                                "Messages waiting to be sent across all connections");
+        m_snapshot_metric = &m_metrics.counter("exchange_slow_consumer_snapshots_total",
+                                               "Slow consumers sent a snapshot after dropping messages");
+        m_disconnect_metric = &m_metrics.counter("exchange_slow_consumer_disconnects_total",
+                                                 "Slow consumers disconnected");
+        m_arena_metric = &m_metrics.gauge("exchange_trade_arena_used_bytes",
+                                          "Bytes allocated from the trade arena");
+        m_mismatch_metric = &m_metrics.counter("exchange_standby_mismatches_total",
+                                               "Checksums from the primary that didn't match this standby");
+        m_ipc_dropped_metric = &m_metrics.counter("exchange_gateway_replies_dropped_total",
+                                                  "Replies dropped for gateway processes too slow to take them");
+        m_tcp_dropped_metric = &m_metrics.counter("exchange_tcp_replies_dropped_total",
+                                                  "Replies dropped for a full TCP gateway queue");
+
+        if (m_config.trade_arena_mb > 0) {
+            m_trade_arena.reset(new exchange::Arena(m_config.trade_arena_mb << 20, true));
+            ob->set_trade_arena(m_trade_arena.get());
+            ob->reserve_trades(TRADE_RESERVE);
+        }
+
+        if (m_config.opening_auction) {
+            ob->start_auction();
+        }
+
+        // Events are logged from the start, even by a standby, so that
+        //     standbys can follow whichever server ends up primary
+        if (m_config.replication_port != 0) {
+            // The log is kept in 1 MB segments
+            m_replication.reset(new exchange::ReplicationPublisher(
+                exchange::REPLICATION_SEGMENT_SIZE, std::max<size_t>(1, m_config.replication_log_mb)));
+        }
+
+        exchange::RiskLimits limits;
+        limits.max_order_size = MAX_ORDER_SIZE;
+        limits.price_band = PRICE_BAND;
+        limits.max_open_quantity = MAX_OPEN_QUANTITY;
+        limits.max_position = MAX_POSITION;
+        limits.max_messages_per_second = MAX_MESSAGES_PER_SECOND;
+        ex.get_risk().set_limits(limits);
     }
 
     void on_open(connection_hdl hdl) {
-        m_connections.insert(hdl);
+        request r;
+        r.type = OPEN;
+        r.hdl = hdl;
+        r.payload = m_server.get_con_from_hdl(hdl)->get_resource();
+        enqueue(std::move(r));
     }
 
     void on_close(connection_hdl hdl) {
-        m_connections.erase(hdl);
+        request r;
+        r.type = CLOSE;
+        r.hdl = hdl;
+        enqueue(std::move(r));
     }
 
     void on_message(connection_hdl hdl, server::message_ptr msg) {
-        if (msg->get_payload() == "bb") {
-            double best_bid = ob.get_best_bid();
+        // Called from any of the io threads
+        request r;
+        r.hdl = hdl;
+        r.payload = msg->get_payload();
+        submit(std::move(r));
+    }
+
+    void on_gateway_message(uint64_t session, const std::string& payload) {
+        // Called from the TCP gateway thread
+        request r;
+        r.tcp_session = session;
+        r.payload = payload;
+        submit(std::move(r));
+    }
+
+    void on_trade(const exchange::Trade& t) override {
+        // Trades are published once the order that caused them is handled
+        m_new_trades.push_back(exchange::Trade::serialize(t));
+    }
+
+    void on_fill(exchange::Order& o, const exchange::Trade& t) override {
+        /*
+         * Fills are sent privately to the session each order came from,
+         * after the reply to the message that caused them, as
+         * f|id|price|size|remaining.
+         */
+        auto it = m_order_routes.find(&o);
+        if (it == m_order_routes.end()) {
+            return;
+        }
+
+        std::stringstream m_ss;
+        m_ss << "f|" << it->second.id << '|' << std::fixed << std::setprecision(4) << t.get_price()
+             << '|' << t.get_size() << '|' << o.effective_size();
+        m_pending_fills.emplace_back(it->second.origin, m_ss.str());
+
+        if (o.get_status() == exchange::FILLED) {
+            m_finished_orders.push_back(&o);
+        }
+    }
+
+    void on_order_closed(exchange::Order& o) override {
+        m_finished_orders.push_back(&o);
+    }
+
+    void follow(const std::string& address, uint16_t port) {
+        /*
+         * Run as a hot standby, applying the events of the primary at
+         * address:port as they arrive. Returns once the primary has gone
+         * so that the caller can take over by calling run().
+         *
+         * Nothing else touches the exchange until run() is called, so
+         * events are applied on the calling thread.
+         */
+        exchange::ReplicationSubscriber primary;
+        if (!primary.connect(address, port, m_event_sequence + 1)) {
+            return;
+        }
+
+        exchange::WaitStrategy wait(m_config.spin_limit);
+        auto handler = [this](const exchange::ReplicationEvent& e) { apply_event(e); };
+
+        while (primary.is_connected()) {
+            if (primary.poll(handler) > 0) {
+                wait.reset();
+            } else {
+                wait.idle();
+            }
+        }
+
+        std::cout << "Lost primary after event " << m_event_sequence
+                  << ", taking over" << std::endl;
+    }
+
+    void run(uint16_t port) {
+        open_endpoints();
+
+        m_server.listen(port);
+        m_server.start_accept();
+
+        m_running.store(true, std::memory_order_release);
+        std::thread matcher(&broadcast_server::match_loop, this);
+
+        std::thread gateway;
+        if (m_gateway) {
+            gateway = std::thread([this]() {
+                exchange::pin_thread(m_config.gateway_cpu);
+                m_gateway->run();
+            });
+        }
+
+        std::thread metrics;
+        if (m_metrics_server) {
+            metrics = std::thread(&exchange::MetricsServer::run, m_metrics_server.get());
+        }
+
+        // The calling thread is the first io thread
+        std::vector<std::thread> io;
+        for (int t = 1; t < m_config.io_threads; t++) {
+            io.emplace_back([this]() { m_server.run(); });
+        }
+        m_server.run();
+
+        for (auto& t : io) {
+            t.join();
+        }
+
+        if (m_gateway) {
+            m_gateway->stop();
+            gateway.join();
+        }
+
+        if (m_metrics_server) {
+            m_metrics_server->stop();
+            metrics.join();
+        }
+
+        m_running.store(false, std::memory_order_release);
+        matcher.join();
+
+        m_exporter.close();
+    }
+private:
+    typedef std::map<connection_hdl,session,std::owner_less<connection_hdl>> session_list;
+
+    void open_endpoints() {
+        // Opened when the server starts serving, so a standby doesn't hold
+        //     the ports its primary is using
+        if (!m_config.md_group.empty()) {
+            m_feed.reset(new exchange::MdPublisher(MD_RETRANSMIT_BUFFER_SIZE));
+            if (m_feed->open(m_config.md_group, m_config.md_port,
+                             m_config.md_interface, m_config.md_request_port)) {
+                ob->add_listener(m_feed.get());
+            } else {
+                m_feed.reset();
+            }
+        }
+
+        if (m_config.tcp_port != 0) {
+            m_gateway.reset(new exchange::TcpGateway(
+                bind(&broadcast_server::on_gateway_message,this,::_1,::_2),
+                m_config.tcp_busy_poll));
+
+            if (!m_gateway->listen(TCP_GATEWAY_ADDRESS, m_config.tcp_port)) {
+                m_gateway.reset();
+            }
+        }
+
+        if (m_config.metrics_port != 0) {
+            m_metrics_server.reset(new exchange::MetricsServer(m_metrics));
+            if (!m_metrics_server->listen(METRICS_ADDRESS, m_config.metrics_port)) {
+                m_metrics_server.reset();
+            }
+        }
+
+        if (m_replication && !m_replication->listen(REPLICATION_ADDRESS, m_config.replication_port)) {
+            m_replication.reset();
+        }
+
+        if (!m_config.ipc_ring.empty()) {
+            m_ipc_events.reset(new exchange::ShmRing());
+            bool created = m_ipc_events->create(m_config.ipc_ring + ".events", IPC_EVENT_SLOTS,
+                                                IPC_MAX_MESSAGE_SIZE, false);
+
+            // Every gateway gets gated rings of its own in both directions.
+            //     With a single publisher on each, a gateway that dies part
+            //     way through a request only holds up its own ring, and
+            //     finishes the request when it comes back.
+            for (uint32_t g = 1; created && g <= m_config.ipc_gateways; g++) {
+                std::string prefix = m_config.ipc_ring + ".";
+                std::string suffix = "." + std::to_string(g);
+
+                m_ipc_gateways.emplace_back(new ipc_gateway_rings());
+                ipc_gateway_rings& rings = *m_ipc_gateways.back();
+                created = rings.requests.create(prefix + "requests" + suffix, IPC_REQUEST_SLOTS,
+                                                IPC_MAX_MESSAGE_SIZE, true) &&
+                          rings.replies.create(prefix + "replies" + suffix, IPC_REPLY_SLOTS,
+                                               IPC_MAX_MESSAGE_SIZE, true);
+            }
+
+            if (!created) {
+                m_ipc_events.reset();
+                m_ipc_gateways.clear();
+            }
+        }
+    }
+
+    void submit(request&& r) {
+        /*
+         * Orders are decoded on the thread that received them so that parsing
+         * is spread across the io threads, then every message is handed to
+         * the matching thread which is the only thread that touches the
+         * exchange.
+         */
+        if (!decode(r)) {
+            r.type = MALFORMED;
+        }
+
+        enqueue(std::move(r));
+    }
+
+    static bool decode(request& r) {
+        if (!is_query(r.payload) && !is_cancel(r.payload) && !is_market_control(r.payload)) {
+            bool success;
+            std::tie(r.order, success) = exchange::Order::deserialize(r.payload);
+
+            if (!success) {
+                std::cout << "Failed to decode order " << r.payload << std::endl;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void enqueue(request&& r) {
+        m_requests_metric->add();
+
+        // Wait for the matching thread to make room rather than drop the message
+        while (!m_requests.try_push(std::move(r))) {
+            std::this_thread::yield();
+        }
+
+        m_doorbell.ring();
+    }
+
+    static bool is_query(const std::string& payload) {
+        return exchange::message_type(payload) == exchange::QUERY_MESSAGE;
+    }
+
+    static std::vector<long> bar_intervals_ms(const std::vector<long>& seconds) {
+        std::vector<long> intervals;
+        for (auto s : seconds) {
+            intervals.push_back(s * 1000);
+        }
+
+        return intervals;
+    }
+
+    static bool is_cancel(const std::string& payload) {
+        return exchange::message_type(payload) == exchange::CANCEL_MESSAGE;
+    }
+
+    static bool is_market_control(const std::string& payload) {
+        return exchange::message_type(payload) == exchange::MARKET_CONTROL_MESSAGE;
+    }
+
+    void match_loop() {
+        exchange::pin_thread(m_config.matching_cpu);
+
+        // Spin for a while before giving up the core so that bursts
+        //     are picked up without a trip through the scheduler. Then sleep
+        //     until a request is queued or housekeeping is due, unless busy
+        //     waiting, which yields instead and never leaves the core idle.
+        //     Gateway processes can't ring the doorbell, so their requests
+        //     to a sleeping server wait for housekeeping to come round.
+        exchange::WaitStrategy wait(m_config.spin_limit);
+
+        // Housekeeping runs on the clock rather than when the thread stops
+        //     spinning, so a long spin limit or a steady stream of requests
+        //     can't hold it off
+        auto housekeeping_due = std::chrono::steady_clock::now();
+        long polls = 0;
+
+        while (m_running.load(std::memory_order_acquire)) {
+            if (++polls >= HOUSEKEEPING_CHECK_POLLS) {
+                polls = 0;
+
+                auto now = std::chrono::steady_clock::now();
+                if (now >= housekeeping_due) {
+                    housekeeping();
+                    housekeeping_due = now + HOUSEKEEPING_INTERVAL;
+                }
+            }
+
+            bool sleepy = !m_config.busy_wait && !wait.is_spinning();
+            if (sleepy) {
+                m_doorbell.prepare();
+            }
+
+            request r;
+            if (!m_requests.try_pop(r) && !next_ipc_request(r)) {
+                if (m_pending_tops > 0) {
+                    send_pending_tops();
+                }
+
+                if (sleepy) {
+                    m_doorbell.wait(housekeeping_due);
+                    polls = HOUSEKEEPING_CHECK_POLLS;
+                } else {
+                    wait.idle();
+                }
+                continue;
+            }
+
+            if (sleepy) {
+                m_doorbell.cancel();
+            }
+            wait.reset();
+
+            if (r.type == OPEN) {
+                open_session(r.hdl, r.payload);
+            } else if (r.type == CLOSE) {
+                m_sessions.erase(r.hdl);
+                m_connections_metric->set(m_sessions.size());
+            } else if (r.type == MALFORMED) {
+                reply(r, "REJ|PARSE");
+            } else {
+                handle_request(r);
+            }
+        }
+    }
+
+    void housekeeping() {
+        // Connections that were too busy earlier may have room now
+        flush_all();
+
+        if (m_feed) {
+            m_feed->poll();
+        }
+
+        if (m_replication) {
+            m_replication->poll();
+        }
+
+        for (auto& rings : m_ipc_gateways) {
+            flush_ipc_replies(*rings);
+        }
+
+        // The book's gauges are only refreshed here, keeping them off the
+        //     path of each order
+        ob->update_metrics();
+    }
+
+    bool next_ipc_request(request& r) {
+        /*
+         * Take the next message from the gateway processes, if there is
+         * one. Their orders are decoded here on the matching thread.
+         *
+         * The gateways take turns, one message at a time, so a busy one
+         * can't starve the others.
+         */
+        for (size_t i = 0; i < m_ipc_gateways.size(); i++) {
+            size_t g = m_ipc_turn;
+            m_ipc_turn = (m_ipc_turn + 1) % m_ipc_gateways.size();
+            ipc_gateway_rings& rings = *m_ipc_gateways[g];
+
+            const char* data;
+            size_t size;
+            while (rings.requests.peek(rings.next_request, &data, &size) == exchange::SHM_READY) {
+                uint32_t gateway;
+                const char* payload;
+                size_t payload_size;
+                bool routed = exchange::decode_routed(data, size, &gateway, &r.ipc_session,
+                                                      &payload, &payload_size);
+                if (routed) {
+                    r.payload.assign(payload, payload_size);
+                }
+
+                rings.requests.release(rings.next_request++);
+
+                // Messages without a header, such as the empty ones left
+                //     by a gateway that died publishing them, are skipped
+                if (routed) {
+                    m_requests_metric->add();
+
+                    // The ring says which gateway sent it, whatever its header says
+                    r.ipc_gateway = (uint32_t) g + 1;
+                    r.type = decode(r) ? MESSAGE : MALFORMED;
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void publish_ipc_event(const std::string& message) {
+        // Broadcasts for any co-located reader, which never hold up matching
+        if (!m_ipc_events->publish(exchange::encode_routed(0, 0, message))) {
+            std::cerr << "Message too large for the gateway ring: " << message.substr(0, 16) << std::endl;
+        }
+    }
+
+    void publish_ipc_reply(uint32_t gateway, uint64_t session, const std::string& message) {
+        /*
+         * Put a reply on the gateway's own ring without ever waiting for
+         * the gateway. When the ring is full the reply joins the gateway's
+         * backlog, which housekeeping moves on to the ring as it makes
+         * room. A gateway that lets IPC_REPLY_BACKLOG replies build up is
+         * too slow, like a slow consumer on any other transport, and its
+         * replies are dropped until the backlog clears.
+         */
+        ipc_gateway_rings& rings = *m_ipc_gateways[gateway - 1];
+        std::string routed = exchange::encode_routed(gateway, session, message);
+
+        if (routed.size() > rings.replies.get_max_message_size()) {
+            std::cerr << "Message too large for the gateway ring: " << message.substr(0, 16) << std::endl;
+            return;
+        }
+
+        flush_ipc_replies(rings);
+        if (rings.backlog.empty() && rings.replies.publish(routed)) {
+            return;
+        }
+
+        if (rings.slow || rings.backlog.size() >= IPC_REPLY_BACKLOG) {
+            if (!rings.slow) {
+                std::cerr << "Gateway " << gateway << " stopped taking replies, dropping them" << std::endl;
+                rings.slow = true;
+            }
+
+            m_ipc_dropped_metric->add();
+            return;
+        }
+
+        rings.backlog.push_back(std::move(routed));
+    }
+
+    void flush_ipc_replies(ipc_gateway_rings& rings) {
+        while (!rings.backlog.empty() && rings.replies.publish(rings.backlog.front())) {
+            rings.backlog.pop_front();
+        }
+
+        if (rings.backlog.empty()) {
+            rings.slow = false;
+        }
+    }
+
+    void open_session(connection_hdl hdl, const std::string& resource) {
+        if (resource == MARKET_DATA_RESOURCE) {
+            auto it = m_sessions.emplace(hdl, session(true, m_config.md_queue_size, m_config.md_policy));
+            it.first->second.compressed = m_config.md_deflate;
+        } else {
+            auto it = m_sessions.emplace(hdl, session(false, m_config.order_queue_size, m_config.order_policy));
+            if (m_config.operator_sessions && resource == OPERATOR_RESOURCE) {
+                it.first->second.role = exchange::OPERATOR_SESSION;
+            }
+        }
+
+        m_connections_metric->set(m_sessions.size());
+    }
+
+    std::string top_of_book() {
+        double best_bid = ob->get_best_bid();
+        double best_offer = ob->get_best_offer();
+        long long current_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        std::stringstream m_ss;
+        m_ss << "bbbo" << std::fixed << std::setprecision(4)
+             << '|' << best_bid
+             << '|' << best_offer
+             << '|' << current_ms;
+
+        return m_ss.str();
+    }
+
+    void deliver(connection_hdl hdl, session& s, const std::string& message) {
+        /*
+         * Queue a message for a connection. Connections that have fallen too
+         * far behind are handled by their queue's slow consumer policy.
+         */
+        if (s.queue.push(message) || !s.queue.is_disconnected() || s.closing) {
+            return;
+        }
+
+        s.closing = true;
+        m_disconnect_metric->add();
+        std::cerr << "Disconnecting slow consumer after dropping "
+                  << s.queue.get_dropped() << " messages" << std::endl;
+
+        websocketpp::lib::error_code ec;
+        m_server.close(hdl, websocketpp::close::status::policy_violation, "slow consumer", ec);
+    }
+
+    void send(connection_hdl hdl, const std::string& message) {
+        auto it = m_sessions.find(hdl);
+        if (it == m_sessions.end()) {
+            return;
+        }
+
+        deliver(hdl, it->second, message);
+        flush(hdl, it->second);
+    }
+
+    void flush(connection_hdl hdl, session& s) {
+        /*
+         * Hand queued messages to websocketpp while the connection has room.
+         *
+         * websocketpp gathers every frame queued while a write is in flight
+         * into a single write, so handing over a batch at once lets many
+         * messages go out in one syscall.
+         */
+        if (s.closing) {
+            return;
+        }
+
+        if (s.queue.take_snapshot_request()) {
+            m_snapshot_metric->add();
+            s.queue.push(top_of_book());
+        }
+
+        if (s.queue.depth() == 0) {
+            return;
+        }
+
+        websocketpp::lib::error_code ec;
+        server::connection_ptr con = m_server.get_con_from_hdl(hdl, ec);
+        if (ec) {
+            return;
+        }
+
+        size_t buffered = con->get_buffered_amount();
+        if (buffered >= MAX_BUFFERED_BYTES) {
+            return;
+        }
+
+        std::vector<std::string> batch;
+        s.queue.pop_batch(batch, MAX_BUFFERED_BYTES - buffered);
+
+        for (auto& message : batch) {
+            if (s.compressed) {
+                // Compressed by websocketpp if the client negotiated it
+                server::message_ptr msg = con->get_message(websocketpp::frame::opcode::text, message.size());
+                msg->set_payload(message);
+                msg->set_compressed(true);
+                ec = con->send(msg);
+            } else {
+                ec = con->send(message, websocketpp::frame::opcode::text);
+            }
+
+            if (ec) {
+                std::cerr << "Failed to send message: " << ec.message() << std::endl;
+                return;
+            }
+        }
+    }
+
+    void flush_all() {
+        if (m_pending_tops > 0) {
+            send_pending_tops();
+        }
+
+        long depth = 0;
+        for (auto& it : m_sessions) {
+            flush(it.first, it.second);
+            depth += it.second.queue.depth();
+        }
+
+        m_queue_depth_metric->set(depth);
+
+        if (m_trade_arena) {
+            m_arena_metric->set(m_trade_arena->get_used());
+        }
+
+        if (m_gateway) {
+            m_tcp_dropped_metric->set(m_gateway->get_dropped_replies());
+        }
+    }
+
+    void reply(request& r, const std::string& message) {
+        if (r.ipc_gateway != 0) {
+            publish_ipc_reply(r.ipc_gateway, r.ipc_session, message);
+        } else if (r.tcp_session != 0) {
+            m_gateway->send(r.tcp_session, message);
+        } else {
+            send(r.hdl, message);
+        }
+    }
+
+    void broadcast(const std::string& message, bool top = false) {
+        /*
+         * Queue a message for every session. Top of book updates to market
+         * data sessions are conflated when an interval is configured.
+         */
+        bool conflate = top && m_config.md_conflate_ms > 0;
+        auto now = std::chrono::steady_clock::now();
+
+        for (auto& it : m_sessions) {
+            if (conflate && it.second.market_data) {
+                conflate_top(it.first, it.second, message, now);
+            } else {
+                deliver(it.first, it.second, message);
+            }
+        }
+
+        // Co-located readers follow everything on the event ring
+        if (m_ipc_events) {
+            publish_ipc_event(message);
+        }
+    }
+
+    void conflate_top(connection_hdl hdl, session& s, const std::string& top,
+                      std::chrono::steady_clock::time_point now) {
+        // Send straight away if the interval has passed, otherwise hold on
+        //     to the latest state until it has
+        if (now - s.last_top >= std::chrono::milliseconds(m_config.md_conflate_ms)) {
+            if (!s.pending_top.empty()) {
+                s.pending_top.clear();
+                m_pending_tops--;
+            }
+
+            s.last_top = now;
+            deliver(hdl, s, top);
+            return;
+        }
+
+        if (s.pending_top.empty()) {
+            m_pending_tops++;
+        }
+        s.pending_top = top;
+    }
+
+    void send_pending_tops() {
+        auto now = std::chrono::steady_clock::now();
+        auto interval = std::chrono::milliseconds(m_config.md_conflate_ms);
+
+        m_pending_tops = 0;
+        for (auto& it : m_sessions) {
+            session& s = it.second;
+            if (s.pending_top.empty()) {
+                continue;
+            }
+
+            if (now - s.last_top < interval) {
+                m_pending_tops++;
+                continue;
+            }
+
+            s.last_top = now;
+            deliver(it.first, s, s.pending_top);
+            s.pending_top.clear();
+            flush(it.first, s);
+        }
+    }
+
+    void handle_request(request& r) {
+        /*
+         * Queries are answered straight away. Everything else changes the
+         * exchange, so it is given the next event sequence and sent to the
+         * standbys before it is applied, along with the time it was applied
+         * at so that standbys make the same risk decisions.
+         */
+        if (is_query(r.payload)) {
+            handle_query(r);
+            return;
+        }
+
+        // Only operator sessions may run the market, which is checked
+        //     here as standbys apply whatever the primary sent them
+        if (!exchange::may_send(session_role(r), exchange::message_type(r.payload))) {
+            reply(r, exchange::NOT_PERMITTED_REPLY);
+            return;
+        }
+
+        // Sessions may only cancel their own orders. Refused before the
+        //     cancel becomes an event, as standbys don't know the sessions
+        if (is_cancel(r.payload) && !owns_order(r)) {
+            reply(r, "c|" + r.payload.substr(2) + "|R");
+            return;
+        }
+
+        Timestamp now = m_clock->now();
+
+        if (m_replication) {
+            exchange::ReplicationEvent e;
+            e.sequence = m_event_sequence + 1;
+            e.time = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+            e.payload = r.payload;
+
+            // Anything standbys can't be told about isn't applied either
+            if (!m_replication->publish(e)) {
+                reply(r, "REJ|REPLICATION");
+                delete r.order;
+                return;
+            }
+        }
+
+        m_event_sequence++;
+        apply(r, now);
+
+        if (m_replication && m_event_sequence % CHECKSUM_INTERVAL == 0) {
+            publish_checksum(now);
+        }
+    }
+
+    exchange::SessionRole session_role(const request& r) {
+        // Gateway sessions only ever enter orders
+        if (r.tcp_session != 0 || r.ipc_gateway != 0) {
+            return exchange::ORDER_ENTRY_SESSION;
+        }
+
+        auto it = m_sessions.find(r.hdl);
+        return it == m_sessions.end() ? exchange::ORDER_ENTRY_SESSION : it->second.role;
+    }
+
+    void apply_event(const exchange::ReplicationEvent& e) {
+        /*
+         * Apply an event from the primary exactly as the primary did. The
+         * standby has no sessions, so replies and market data go nowhere.
+         */
+        m_event_sequence = e.sequence;
+
+        if (m_replication) {
+            m_replication->publish(e);
+        }
+
+        if (e.payload.compare(0, 3, "ck|") == 0) {
+            uint64_t checksum = std::stoull(e.payload.substr(3));
+            if (checksum != ex.checksum()) {
+                std::cerr << "Books differ from the primary at event " << e.sequence << std::endl;
+                m_mismatch_metric->add();
+            }
+            return;
+        }
+
+        request r;
+        r.payload = e.payload;
+        if (!decode(r)) {
+            return;
+        }
+
+        Timestamp now(std::chrono::duration_cast<Timestamp::duration>(std::chrono::nanoseconds(e.time)));
+        apply(r, now);
+    }
+
+    void publish_checksum(Timestamp now) {
+        exchange::ReplicationEvent e;
+        e.sequence = ++m_event_sequence;
+        e.time = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        e.payload = "ck|" + std::to_string(ex.checksum());
+
+        m_replication->publish(e);
+    }
+
+    void apply(request& r, Timestamp now) {
+        m_event_clock.set(now);
+
+        if (is_cancel(r.payload)) {
+            handle_cancel(r);
+        } else if (is_market_control(r.payload)) {
+            handle_market_control(r);
+        } else {
+            handle_order(r, now);
+        }
+
+        release_finished_orders();
+    }
+
+    void release_finished_orders() {
+        /*
+         * Free the orders the books finished with during the last event.
+         * The books may still touch an order until the event is over, so
+         * they are only noted by the listener hooks and freed here. Orders
+         * without a route have already been freed.
+         */
+        for (exchange::Order* o : m_finished_orders) {
+            auto it = m_order_routes.find(o);
+            if (it == m_order_routes.end()) {
+                continue;
+            }
+
+            m_live_orders.erase(it->second.id);
+            m_order_routes.erase(it);
+            delete o;
+        }
+
+        m_finished_orders.clear();
+    }
+
+    static bool same_origin(const request& a, const request& b) {
+        // Websocket handles are compared by the connection they refer to
+        std::owner_less<connection_hdl> before;
+        return a.ipc_gateway == b.ipc_gateway && a.ipc_session == b.ipc_session &&
+               a.tcp_session == b.tcp_session && !before(a.hdl, b.hdl) && !before(b.hdl, a.hdl);
+    }
+
+    bool owns_order(const request& r) {
+        /*
+         * Returns true when a cancel comes from the session that sent the
+         * order it cancels. Unknown IDs are left to handle_cancel.
+         */
+        uint64_t id = std::strtoull(r.payload.c_str() + 2, nullptr, 10);
+
+        auto live = m_live_orders.find(id);
+        if (live == m_live_orders.end()) {
+            return true;
+        }
+
+        auto route = m_order_routes.find(live->second);
+        return route != m_order_routes.end() && same_origin(route->second.origin, r);
+    }
+
+    void handle_query(request& r) {
+        if (r.payload == "bb") {
+            double best_bid = ob->get_best_bid();
 
             std::stringstream m_ss;
             m_ss << "bb|" << std::fixed << std::setprecision(4) << best_bid;
 
-            m_server.send(hdl, m_ss.str(), websocketpp::frame::opcode::text);
-            return;
-        } else if (msg->get_payload() == "bo") {
-            double best_offer = ob.get_best_offer();
+            reply(r, m_ss.str());
+        } else if (r.payload == "bo") {
+            double best_offer = ob->get_best_offer();
 
             std::stringstream m_ss;
             m_ss << "bo|" << std::fixed << std::setprecision(4) << best_offer;
 
-            m_server.send(hdl, m_ss.str(), websocketpp::frame::opcode::text);
-            return;
-        } else if (msg->get_payload() == "bbbo") {
-            double best_bid = ob.get_best_bid();
-            double best_offer = ob.get_best_offer();
-            long long current_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            reply(r, m_ss.str());
+        } else if (r.payload == "bbbo") {
+            reply(r, top_of_book());
+        } else if (r.payload.compare(0, 3, "br|") == 0) {
+            handle_bars(r);
+        } else if (r.payload.compare(0, 3, "st|") == 0) {
+            handle_stats(r);
+        }
+    }
+
+    void handle_order(request& r, Timestamp now) {
+        exchange::Order* o = r.order;
+
+        // The order can fill as soon as it reaches the book, so it is given
+        //     its ID and route before it is submitted
+        order_route& route = m_order_routes[o];
+        route.id = m_next_order_id;
+        route.origin = r;
+        route.origin.payload.clear();
+        route.origin.order = nullptr;
+
+        exchange::RiskResult risk_result = exchange::RISK_OK;
+        if (!ex.submit_order(*o, now, &risk_result)) {
+            // Without its route the order is skipped when finished orders
+            //     are released, so it is only freed here
+            m_order_routes.erase(o);
 
+            // Orders that pass the risk checks can still be refused by the
+            //     book, e.g. post-only orders that cross or a closed market
             std::stringstream m_ss;
-            m_ss << "bbbo" << std::fixed << std::setprecision(4)
-                 << '|' << best_bid
-                 << '|' << best_offer
-                 << '|' << current_ms;
+            m_ss << "REJ|" << ((risk_result == exchange::RISK_OK) ? "BOOK"
+                               : exchange::RiskChecker::describe(risk_result));
+            reply(r, m_ss.str());
 
-            m_server.send(hdl, m_ss.str(), websocketpp::frame::opcode::text);
+            // Rejected orders never reach the book so nothing refers to them
+            delete o;
             return;
         }
 
-        exchange::Order* o;
-        bool success;
+        // Orders that are still live can be cancelled by their ID later
+        uint64_t id = m_next_order_id++;
+        exchange::OrderStatus status = o->get_status();
+        if (status == exchange::UNFILLED || status == exchange::PARTIALLY_FILLED) {
+            m_live_orders[id] = o;
+        }
 
-        std::tie(o, success) = exchange::Order::deserialize(msg->get_payload());
+        // Send a private ACK back to the sender of the message
+        reply(r, "ACK|" + std::to_string(id));
+        send_fills();
 
-        if (!success) {
-            std::cout << "Failed to decode order " << (msg->get_payload()) << std::endl;
+        publish_market_data();
+    }
+
+    void handle_cancel(request& r) {
+        std::string id_field = r.payload.substr(2);
+        std::stringstream ss(id_field);
+        uint64_t id = 0;
+        ss >> id;
+
+        auto it = m_live_orders.find(id);
+        if (it == m_live_orders.end()) {
+            reply(r, "c|" + id_field + "|R");
             return;
         }
 
-        {
-            ob.submit_order(*o);
-            std::lock_guard<std::mutex> lock(mu);
-            i++;
+        // Orders leave the live orders once filled, so this is only a
+        //     safeguard
+        exchange::Order* o = it->second;
+        exchange::OrderStatus status = o->get_status();
+        if (status != exchange::UNFILLED && status != exchange::PARTIALLY_FILLED) {
+            reply(r, "c|" + id_field + "|R");
+            return;
         }
 
-        // Send a private ACK back to the sender of the message
-        m_server.send(hdl, std::string("ACK"), websocketpp::frame::opcode::text);
+        // Freed along with the other finished orders once the event is over
+        o->cancel();
+        m_finished_orders.push_back(o);
+
+        reply(r, "c|" + id_field + "|A");
+        publish_market_data();
+    }
+
+    void handle_market_control(request& r) {
+        /*
+         * au|ABC starts an auction call for ABC, op|ABC uncrosses it and
+         * opens continuous trading and cl|ABC uncrosses it and closes the
+         * market. Opening and closing are announced to every session.
+         */
+        std::string type = r.payload.substr(0, 2);
+        std::string instrument = r.payload.substr(3);
+
+        exchange::Orderbook* book = ex.get_orderbook(instrument);
+        if (book == nullptr) {
+            reply(r, "REJ|UNKNOWN_INSTRUMENT");
+            return;
+        }
+
+        if (type == "au") {
+            book->start_auction();
+        } else if (type == "op") {
+            book->uncross(exchange::CONTINUOUS);
+        } else {
+            book->uncross(exchange::CLOSED);
+
+            // Hand the last trades of the session to the writer straight away
+            //     rather than when the next batch fills
+            m_exporter.flush();
+        }
+
+        reply(r, "ACK");
+        send_fills();
+
+        if (type != "au") {
+            broadcast(r.payload);
+        }
+
+        publish_market_data();
+    }
+
+    void send_fills() {
+        for (auto& fill : m_pending_fills) {
+            reply(fill.first, fill.second);
+        }
+        m_pending_fills.clear();
+    }
+
+    void handle_bars(request& r) {
+        /*
+         * br|ABC|60|10 asks for the last 10 one minute bars of ABC. Bars
+         * are kept as trades happen, so a query only touches the bars it
+         * returns.
+         */
+        std::stringstream ss(r.payload.substr(3));
+        std::string instrument;
+        std::getline(ss, instrument, '|');
+
+        long interval = 0;
+        char sep;
+        size_t count = DEFAULT_BAR_COUNT;
+        ss >> interval;
+        if (ss >> sep) {
+            ss >> count;
+        }
+
+        if (ex.get_orderbook(instrument) == nullptr) {
+            reply(r, "REJ|UNKNOWN_INSTRUMENT");
+            return;
+        }
+
+        std::vector<exchange::Bar> bars;
+        if (!m_bars.get_bars(instrument, interval * 1000, count, bars)) {
+            reply(r, "REJ|UNKNOWN_INTERVAL");
+            return;
+        }
 
-        // Broadcast a message to all connections
         std::stringstream m_ss;
-        m_ss << "The new number is " << i;
+        m_ss << "br|" << instrument << '|' << interval
+             << std::fixed << std::setprecision(4);
+        for (auto& bar : bars) {
+            m_ss << '|' << bar.start_ms
+                 << ',' << bar.open << ',' << bar.high
+                 << ',' << bar.low << ',' << bar.close
+                 << ',' << bar.volume << ',' << bar.vwap();
+        }
 
-        for (auto it : m_connections) {
-            try {
-                m_server.send(it, m_ss.str(), websocketpp::frame::opcode::text);
-            } catch (websocketpp::exception) {
-                std::cerr << "Failed to send sequence update message" << std::endl;
-            }
+        reply(r, m_ss.str());
+    }
+
+    void handle_stats(request& r) {
+        std::string instrument = r.payload.substr(3);
+        if (ex.get_orderbook(instrument) == nullptr) {
+            reply(r, "REJ|UNKNOWN_INSTRUMENT");
+            return;
         }
+
+        exchange::TradeStats stats = m_bars.get_stats(instrument);
+
+        std::stringstream m_ss;
+        m_ss << "st|" << instrument << std::fixed << std::setprecision(4)
+             << '|' << stats.last
+             << '|' << stats.volume
+             << '|' << stats.vwap();
+
+        reply(r, m_ss.str());
     }
 
-    void run(uint16_t port) {
-        m_server.listen(port);
-        m_server.start_accept();
-        m_server.run();
+    void publish_market_data() {
+        // Broadcast any new trades and the new top of book to all connections
+        for (auto& t : m_new_trades) {
+            broadcast(t);
+        }
+        m_new_trades.clear();
+
+        broadcast(top_of_book(), true);
+        flush_all();
     }
-private:
-    typedef std::set<connection_hdl,std::owner_less<connection_hdl>> con_list;
 
+    server_config m_config;
     server m_server;
-    con_list m_connections;
 
-    int i;
-    std::mutex mu;
+    // Metrics are updated from any thread and read by the metrics thread
+    exchange::MetricsRegistry m_metrics;
+    exchange::Metric* m_requests_metric;
+    exchange::Metric* m_connections_metric;
+    exchange::Metric* m_queue_depth_metric;
+    exchange::Metric* m_snapshot_metric;
+    exchange::Metric* m_disconnect_metric;
+    exchange::Metric* m_arena_metric;
+    exchange::Metric* m_mismatch_metric;
+    exchange::Metric* m_ipc_dropped_metric;
+    exchange::Metric* m_tcp_dropped_metric;
+    std::unique_ptr<exchange::MetricsServer> m_metrics_server;
+
+    // Everything below is only touched by the matching thread
+    session_list m_sessions;
+
+    // Market data sessions holding back a conflated top of book
+    size_t m_pending_tops = 0;
+    std::vector<std::string> m_new_trades;
+
+    exchange::BarAggregator m_bars;
+    exchange::TradeExporter m_exporter;
+
+    std::unique_ptr<exchange::Arena> m_trade_arena;
+    std::unique_ptr<exchange::MdPublisher> m_feed;
+    std::unique_ptr<exchange::TcpGateway> m_gateway;
+    std::unique_ptr<exchange::ReplicationPublisher> m_replication;
+
+    std::unique_ptr<exchange::ShmRing> m_ipc_events;
+    std::vector<std::unique_ptr<ipc_gateway_rings>> m_ipc_gateways;
+    size_t m_ipc_turn = 0;
+
+    // Sequence of the last event applied to the exchange
+    uint64_t m_event_sequence = 0;
+
+    std::unique_ptr<exchange::Clock> m_clock;
+    exchange::VirtualClock m_event_clock;
+
+    uint64_t m_next_order_id = 1;
+    std::unordered_map<uint64_t, exchange::Order*> m_live_orders;
+
+    // Routes of the orders that can still fill, which also own the orders,
+    //     and fills waiting to be sent once the message that caused them
+    //     has been replied to
+    std::unordered_map<const exchange::Order*, order_route> m_order_routes;
+
+    // Orders the books are done with during the current event
+    std::vector<exchange::Order*> m_finished_orders;
+    std::vector<std::pair<request, std::string>> m_pending_fills;
 
-    exchange::Orderbook ob;
+    exchange::MpscQueue<request> m_requests;
+    exchange::Doorbell m_doorbell;
+    std::atomic<bool> m_running;
+
+    exchange::Exchange ex;
+    exchange::Orderbook* ob;
 };
 
-int main() {
-    broadcast_server server;
-    std::cout << "Started server running on port " << PORT << std::endl;
+bool parse_option(const std::string& arg, const std::string& name, std::string& value) {
+    /*
+     * Matches command line arguments of the form --name=value.
+     */
+    std::string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+bool parse_layout(const std::string& value, exchange::BookLayout& layout) {
+    if (value == "tree") {
+        layout = exchange::TREE_LAYOUT;
+    } else if (value == "ladder") {
+        layout = exchange::LADDER_LAYOUT;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+bool parse_policy(const std::string& value, exchange::SlowConsumerPolicy& policy) {
+    if (value == "snapshot") {
+        policy = exchange::DROP_TO_SNAPSHOT;
+    } else if (value == "disconnect") {
+        policy = exchange::DISCONNECT;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv) {
+    server_config config;
+
+    // Leave a core free for the matching thread
+    config.io_threads = std::max(1, (int) std::thread::hardware_concurrency() - 1);
+
+    for (int a = 1; a < argc; a++) {
+        std::string arg(argv[a]);
+        std::string value;
+
+        if (parse_option(arg, "io-threads", value)) {
+            config.io_threads = std::max(1, std::stoi(value));
+        } else if (parse_option(arg, "md-queue-size", value)) {
+            config.md_queue_size = std::stoul(value);
+        } else if (parse_option(arg, "order-queue-size", value)) {
+            config.order_queue_size = std::stoul(value);
+        } else if (parse_option(arg, "md-group", value)) {
+            config.md_group = value;
+        } else if (parse_option(arg, "md-port", value)) {
+            config.md_port = std::stoi(value);
+        } else if (parse_option(arg, "md-request-port", value)) {
+            config.md_request_port = std::stoi(value);
+        } else if (parse_option(arg, "md-interface", value)) {
+            config.md_interface = value;
+        } else if (parse_option(arg, "tcp-port", value)) {
+            config.tcp_port = std::stoi(value);
+        } else if (parse_option(arg, "bar-intervals", value)) {
+            config.bar_intervals.clear();
+
+            std::stringstream intervals(value);
+            std::string interval;
+            while (std::getline(intervals, interval, ',')) {
+                config.bar_intervals.push_back(std::max(1L, std::stol(interval)));
+            }
+        } else if (parse_option(arg, "metrics-port", value)) {
+            config.metrics_port = std::stoi(value);
+        } else if (parse_option(arg, "replication-port", value)) {
+            config.replication_port = std::stoi(value);
+        } else if (parse_option(arg, "replication-log-mb", value)) {
+            config.replication_log_mb = std::stoul(value);
+        } else if (parse_option(arg, "standby-of", value)) {
+            config.standby_of = value;
+        } else if (parse_option(arg, "ipc-ring", value)) {
+            config.ipc_ring = value;
+        } else if (parse_option(arg, "ipc-gateways", value)) {
+            config.ipc_gateways = std::stoul(value);
+        } else if (arg == "--md-deflate") {
+            config.md_deflate = true;
+        } else if (parse_option(arg, "md-conflate-ms", value)) {
+            config.md_conflate_ms = std::max(0L, std::stol(value));
+        } else if (arg == "--tcp-busy-poll") {
+            config.tcp_busy_poll = true;
+        } else if (parse_option(arg, "matching-cpu", value)) {
+            config.matching_cpu = std::stoi(value);
+        } else if (parse_option(arg, "gateway-cpu", value)) {
+            config.gateway_cpu = std::stoi(value);
+        } else if (parse_option(arg, "spin-limit", value)) {
+            config.spin_limit = std::stol(value);
+        } else if (parse_option(arg, "trade-arena-mb", value)) {
+            config.trade_arena_mb = std::stoul(value);
+        } else if (parse_option(arg, "warm-up", value)) {
+            config.warm_up_orders = std::stoi(value);
+        } else if (parse_option(arg, "export-file", value)) {
+            config.export_file = value;
+        } else if (arg == "--export-orders") {
+            config.export_orders = true;
+        } else if (arg == "--tsc-clock") {
+            config.tsc_clock = true;
+        } else if (arg == "--lock-memory") {
+            config.lock_memory = true;
+        } else if (arg == "--busy-wait") {
+            config.busy_wait = true;
+        } else if (arg == "--low-latency") {
+            config.spin_limit = LOW_LATENCY_SPIN_LIMIT;
+            config.lock_memory = true;
+            config.trade_arena_mb = LOW_LATENCY_TRADE_ARENA_MB;
+            config.warm_up_orders = LOW_LATENCY_WARM_UP_ORDERS;
+            config.tcp_busy_poll = true;
+            config.tsc_clock = true;
+            config.busy_wait = true;
+        } else if (arg == "--opening-auction") {
+            config.opening_auction = true;
+        } else if (arg == "--operator-sessions") {
+            config.operator_sessions = true;
+        } else if (parse_option(arg, "book-layout", value) && parse_layout(value, config.book.layout)) {
+            continue;
+        } else if (parse_option(arg, "ticks-per-unit", value)) {
+            config.book.ticks_per_unit = std::max(1L, std::stol(value));
+        } else if (parse_option(arg, "ladder-max-ticks", value)) {
+            config.book.ladder_max_ticks = std::max(64L, std::stol(value));
+        } else if (parse_option(arg, "md-policy", value) && parse_policy(value, config.md_policy)) {
+            continue;
+        } else if (parse_option(arg, "order-policy", value) && parse_policy(value, config.order_policy)) {
+            continue;
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    // Locked before anything big is allocated so that later allocations
+    //     are faulted in and locked as they are mapped
+    if (config.lock_memory) {
+        exchange::lock_memory();
+    }
+
+    broadcast_server server(config);
+
+    if (!config.standby_of.empty()) {
+        // host:port, or just the port of a primary on this host
+        std::string address = REPLICATION_ADDRESS;
+        std::string port = config.standby_of;
+        size_t colon = port.rfind(':');
+        if (colon != std::string::npos) {
+            address = port.substr(0, colon);
+            port = port.substr(colon + 1);
+        }
+
+        std::cout << "Following primary at " << address << ':' << port << std::endl;
+        server.follow(address, std::stoi(port));
+    }
+
+    std::cout << "Started server running on port " << PORT
+              << " with " << config.io_threads << " io threads" << std::endl;
     server.run(PORT);
 }
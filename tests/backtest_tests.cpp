@@ -0,0 +1,190 @@
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "backtest.h"
+#include "orderbook.h"
+
+using namespace exchange;
+
+static std::string tape_text(const Backtest& backtest) {
+    std::stringstream ss;
+    for (auto& entry : backtest.get_tape()) {
+        ss << entry.event << ' ' << Trade::serialize(*entry.trade) << '\n';
+    }
+    return ss.str();
+}
+
+static std::string random_recording(int instruments, int lines, unsigned seed) {
+    /*
+     * Orders around 100.00 that often cross, with cancels of earlier
+     * orders mixed in, across several instruments.
+     */
+    std::mt19937 random(seed);
+    std::stringstream ss;
+    long long time = 1000000000;
+    int sent = 0;
+
+    for (int i = 1; i <= lines; i++) {
+        time += random() % 1000;
+        ss << time << ' ';
+
+        if (sent > 10 && random() % 5 == 0) {
+            ss << "c|" << (1 + random() % sent) << '\n';
+            continue;
+        }
+
+        sent++;
+        ss << "o|SYM" << random() % instruments << '|' << 99.95 + (random() % 11) * 0.01 << '|'
+           << 1 + random() % 50 << '|' << (random() % 2 ? "BUY" : "SELL") << "|c" << random() % 8;
+        if (random() % 10 == 0) {
+            ss << "|IOC";
+        }
+        ss << '\n';
+    }
+
+    return ss.str();
+}
+
+TEST(BacktestTest, partitions_by_instrument) {
+    Backtest backtest;
+
+    ASSERT_TRUE(backtest.add("1000 o|ABC|100.0000|10|SELL|alice"));
+    ASSERT_TRUE(backtest.add("2000 o|XYZ|50.0000|5|SELL|alice"));
+    ASSERT_TRUE(backtest.add("o|ABC|100.0000|4|BUY|bob"));
+    ASSERT_TRUE(backtest.add("3000 o|XYZ|50.0000|5|BUY|bob"));
+    ASSERT_TRUE(backtest.add("4000 c|1"));
+    ASSERT_TRUE(backtest.add("5000 c|2"));
+
+    // Queries and cancels of orders the recording doesn't have
+    ASSERT_FALSE(backtest.add("bbbo"));
+    ASSERT_FALSE(backtest.add("c|9"));
+
+    ASSERT_EQ(6, backtest.get_event_count());
+    ASSERT_EQ(2, backtest.get_skipped_count());
+    ASSERT_EQ(2, backtest.get_instrument_count());
+
+    backtest.run(2);
+
+    // Trades come out in the order of the events that made them
+    auto& tape = backtest.get_tape();
+    ASSERT_EQ(2, tape.size());
+    ASSERT_EQ(2, tape[0].event);
+    ASSERT_EQ("ABC", tape[0].trade->get_instrument());
+    ASSERT_EQ(4, tape[0].trade->get_size());
+    ASSERT_EQ(3, tape[1].event);
+    ASSERT_EQ("XYZ", tape[1].trade->get_instrument());
+
+    // Lines without a time take the time of the line before
+    ASSERT_EQ(2000, std::chrono::duration_cast<std::chrono::nanoseconds>(
+        tape[0].trade->get_trade_time().time_since_epoch()).count());
+
+    auto& stats = backtest.get_stats();
+    ASSERT_EQ(2, stats.size());
+    ASSERT_EQ("ABC", stats[0].instrument);
+    ASSERT_EQ(2, stats[0].orders);
+    ASSERT_EQ(1, stats[0].cancels);
+    ASSERT_EQ(4, stats[0].volume);
+    ASSERT_DOUBLE_EQ(100.0, stats[0].get_vwap());
+
+    // The XYZ order filled before it could be cancelled
+    ASSERT_EQ("XYZ", stats[1].instrument);
+    ASSERT_EQ(0, stats[1].cancels);
+    ASSERT_EQ(1, stats[1].cancels_rejected);
+}
+
+TEST(BacktestTest, replays_auctions) {
+    std::stringstream recording;
+    recording << "au|ABC\n"
+              << "o|ABC|101.0000|10|BUY|alice\n"
+              << "o|ABC|99.0000|10|SELL|bob\n"
+              << "op|ABC\n"
+              << "cl|ABC\n"
+              << "o|ABC|100.0000|10|BUY|alice\n";
+
+    Backtest backtest;
+    ASSERT_EQ(6, backtest.load(recording));
+    backtest.run(1);
+
+    auto& stats = backtest.get_stats();
+    ASSERT_EQ(1, stats[0].trades);
+    ASSERT_EQ(10, stats[0].volume);
+    ASSERT_EQ(1, stats[0].rejected);
+    ASSERT_EQ(3, backtest.get_tape()[0].event);
+}
+
+TEST(BacktestTest, results_do_not_depend_on_threads) {
+    std::string recording = random_recording(20, 20000, 7);
+
+    std::stringstream serial_input(recording);
+    Backtest serial;
+    serial.load(serial_input);
+    serial.run(1);
+
+    std::stringstream parallel_input(recording);
+    Backtest parallel;
+    parallel.load(parallel_input);
+    parallel.run(4);
+
+    ASSERT_EQ(20, parallel.get_instrument_count());
+    ASSERT_GT(serial.get_tape().size(), 1000);
+    ASSERT_EQ(tape_text(serial), tape_text(parallel));
+
+    ASSERT_EQ(serial.get_stats().size(), parallel.get_stats().size());
+    for (size_t i = 0; i < serial.get_stats().size(); i++) {
+        auto& a = serial.get_stats()[i];
+        auto& b = parallel.get_stats()[i];
+        ASSERT_EQ(a.instrument, b.instrument);
+        ASSERT_EQ(a.orders, b.orders);
+        ASSERT_EQ(a.cancels, b.cancels);
+        ASSERT_EQ(a.trades, b.trades);
+        ASSERT_EQ(a.volume, b.volume);
+        ASSERT_EQ(a.last, b.last);
+    }
+
+    // Running again gives the same results
+    parallel.run(3);
+    ASSERT_EQ(tape_text(serial), tape_text(parallel));
+}
+
+TEST(BacktestTest, matches_a_single_book) {
+    std::string recording = random_recording(1, 5000, 11);
+
+    std::stringstream input(recording);
+    Backtest backtest;
+    backtest.load(input);
+    backtest.run(2);
+
+    // The same orders submitted one at a time to an ordinary book
+    Orderbook ob("SYM0");
+    std::vector<Order*> orders;
+    std::stringstream lines(recording);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::string payload = line.substr(line.find(' ') + 1);
+        if (payload[0] == 'o') {
+            orders.push_back(Order::deserialize(payload).first);
+            ob.submit_order(*orders.back());
+        } else {
+            Order* o = orders[std::stoul(payload.substr(2)) - 1];
+            if (o->get_status() == UNFILLED || o->get_status() == PARTIALLY_FILLED) {
+                o->cancel();
+            }
+        }
+    }
+
+    auto& tape = backtest.get_tape();
+    std::vector<Trade*>& trades = *ob.get_trades();
+    ASSERT_EQ(trades.size(), tape.size());
+    for (size_t i = 0; i < trades.size(); i++) {
+        ASSERT_EQ(trades[i]->get_price(), tape[i].trade->get_price());
+        ASSERT_EQ(trades[i]->get_size(), tape[i].trade->get_size());
+        ASSERT_EQ(trades[i]->get_maker().get_name(), tape[i].trade->get_maker().get_name());
+    }
+
+    for (auto o : orders) { delete o; }
+    for (auto t : trades) { delete t; }
+}
@@ -0,0 +1,87 @@
+#include <chrono>
+#include <vector>
+
+#include "bars.h"
+#include "gtest/gtest.h"
+
+using namespace exchange;
+
+Trade trade_at(long time_ms, double price, int size) {
+    Client bob("bob");
+    Client alice("alice");
+
+    Trade t("ABC", price, size, BUY, alice, bob);
+    t.set_trade_time(Timestamp(std::chrono::milliseconds(time_ms)));
+
+    return t;
+}
+
+TEST(BarsTest, builds_bars_per_interval) {
+    BarAggregator bars({1000, 60000}, 100);
+
+    bars.on_trade(trade_at(120000, 10.0, 5));
+    bars.on_trade(trade_at(120500, 12.0, 5));
+    bars.on_trade(trade_at(120900, 9.0, 10));
+    bars.on_trade(trade_at(122100, 11.0, 20));
+
+    std::vector<Bar> seconds;
+    ASSERT_TRUE(bars.get_bars("ABC", 1000, 10, seconds));
+    ASSERT_EQ(2, seconds.size());
+
+    ASSERT_EQ(120000, seconds[0].start_ms);
+    ASSERT_EQ(10.0, seconds[0].open);
+    ASSERT_EQ(12.0, seconds[0].high);
+    ASSERT_EQ(9.0, seconds[0].low);
+    ASSERT_EQ(9.0, seconds[0].close);
+    ASSERT_EQ(20, seconds[0].volume);
+    ASSERT_DOUBLE_EQ(10.0, seconds[0].vwap());
+
+    // The second without trades has no bar
+    ASSERT_EQ(122000, seconds[1].start_ms);
+    ASSERT_EQ(20, seconds[1].volume);
+
+    std::vector<Bar> minutes;
+    ASSERT_TRUE(bars.get_bars("ABC", 60000, 10, minutes));
+    ASSERT_EQ(1, minutes.size());
+    ASSERT_EQ(120000, minutes[0].start_ms);
+    ASSERT_EQ(10.0, minutes[0].open);
+    ASSERT_EQ(11.0, minutes[0].close);
+    ASSERT_EQ(40, minutes[0].volume);
+
+    TradeStats stats = bars.get_stats("ABC");
+    ASSERT_EQ(11.0, stats.last);
+    ASSERT_EQ(40, stats.volume);
+    ASSERT_DOUBLE_EQ(420.0 / 40, stats.vwap());
+}
+
+TEST(BarsTest, returns_most_recent_bars) {
+    BarAggregator bars({1000}, 3);
+
+    for (int i = 0; i < 5; i++) {
+        bars.on_trade(trade_at(i * 1000, 10.0 + i, 1));
+    }
+
+    // Only the last three bars are kept
+    std::vector<Bar> out;
+    ASSERT_TRUE(bars.get_bars("ABC", 1000, 10, out));
+    ASSERT_EQ(3, out.size());
+    ASSERT_EQ(2000, out[0].start_ms);
+    ASSERT_EQ(4000, out[2].start_ms);
+
+    out.clear();
+    ASSERT_TRUE(bars.get_bars("ABC", 1000, 2, out));
+    ASSERT_EQ(2, out.size());
+    ASSERT_EQ(3000, out[0].start_ms);
+}
+
+TEST(BarsTest, unknown_intervals_and_instruments) {
+    BarAggregator bars({1000}, 10);
+    bars.on_trade(trade_at(0, 10.0, 1));
+
+    std::vector<Bar> out;
+    ASSERT_FALSE(bars.get_bars("ABC", 5000, 10, out));
+
+    ASSERT_TRUE(bars.get_bars("XYZ", 1000, 10, out));
+    ASSERT_EQ(0, out.size());
+    ASSERT_EQ(0, bars.get_stats("XYZ").volume);
+}
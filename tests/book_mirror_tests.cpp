@@ -0,0 +1,104 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "book_mirror.h"
+#include "md_feed.h"
+#include "orderbook.h"
+
+using namespace exchange;
+
+static MdMessage level(OrderSide side, double price, int quantity) {
+    MdMessage m;
+    m.type = MD_LEVEL;
+    m.instrument = "ABC";
+    m.side = side;
+    m.price = price;
+    m.quantity = quantity;
+    return m;
+}
+
+TEST(BookMirrorTest, applies_level_changes) {
+    BookMirror mirror;
+    ASSERT_EQ(0.0, mirror.get_best_bid("ABC"));
+
+    mirror.apply(level(BUY, 99.99, 10));
+    mirror.apply(level(BUY, 99.98, 20));
+    mirror.apply(level(SELL, 100.01, 5));
+    mirror.apply(level(SELL, 100.02, 7));
+
+    ASSERT_DOUBLE_EQ(99.99, mirror.get_best_bid("ABC"));
+    ASSERT_DOUBLE_EQ(100.01, mirror.get_best_offer("ABC"));
+    ASSERT_EQ(20, mirror.get_quantity_at("ABC", BUY, 99.98));
+
+    // A level with nothing left is gone
+    mirror.apply(level(SELL, 100.01, 0));
+    ASSERT_DOUBLE_EQ(100.02, mirror.get_best_offer("ABC"));
+    ASSERT_EQ(0, mirror.get_quantity_at("ABC", SELL, 100.01));
+
+    std::vector<std::pair<double, int>> depth;
+    ASSERT_EQ(2, mirror.get_depth("ABC", BUY, 5, depth));
+    ASSERT_DOUBLE_EQ(99.99, depth[0].first);
+    ASSERT_EQ(10, depth[0].second);
+    ASSERT_DOUBLE_EQ(99.98, depth[1].first);
+
+    MdMessage trade = level(SELL, 99.99, 3);
+    trade.type = MD_TRADE;
+    mirror.apply(trade);
+    ASSERT_DOUBLE_EQ(99.99, mirror.get_last_price("ABC"));
+    ASSERT_EQ(0.0, mirror.get_last_price("XYZ"));
+}
+
+class CountingListener : public MarketDataListener {
+    public:
+        void on_level(const std::string&, OrderSide, double, int) override { levels++; }
+        void on_trade(const std::string&, OrderSide, double, int) override { trades++; }
+
+        int levels = 0;
+        int trades = 0;
+};
+
+TEST(BookMirrorTest, mirrors_a_book_over_the_feed) {
+    const uint16_t FEED_PORT = 47131;
+    const uint16_t REQUEST_PORT = 47132;
+
+    MdPublisher publisher(1024);
+    ASSERT_TRUE(publisher.open("239.255.0.1", FEED_PORT, "127.0.0.1", REQUEST_PORT));
+
+    CountingListener listener;
+    MarketDataClient client(listener);
+    ASSERT_TRUE(client.open("239.255.0.1", FEED_PORT, "127.0.0.1", "127.0.0.1", REQUEST_PORT));
+
+    Client alice("alice");
+    Client bob("bob");
+    Orderbook ob("ABC");
+    ob.add_listener(&publisher);
+
+    std::vector<Order*> orders;
+    for (int i = 0; i < 10; i++) {
+        orders.push_back(new Order("ABC", 99.95 + i * 0.01, 10, (i < 5) ? BUY : SELL, alice));
+        ob.submit_order(*orders.back());
+    }
+
+    Order sweep("ABC", 100.01, 15, BUY, bob);
+    ob.submit_order(sweep);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (listener.trades < 2 && std::chrono::steady_clock::now() < deadline) {
+        client.poll();
+        publisher.poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const BookMirror& mirror = client.get_mirror();
+    ASSERT_EQ(2, listener.trades);
+    ASSERT_DOUBLE_EQ(ob.get_best_bid(), mirror.get_best_bid("ABC"));
+    ASSERT_DOUBLE_EQ(ob.get_best_offer(), mirror.get_best_offer("ABC"));
+    ASSERT_EQ(ob.get_quantity_at(SELL, 100.01), mirror.get_quantity_at("ABC", SELL, 100.01));
+    ASSERT_DOUBLE_EQ(100.01, mirror.get_last_price("ABC"));
+
+    for (auto o : orders) { delete o; }
+}
@@ -0,0 +1,183 @@
+#include <random>
+#include <vector>
+
+#include "book_side.h"
+#include "gtest/gtest.h"
+
+using namespace exchange;
+
+TEST(BookSideTest, ranks_prices_by_side) {
+    ASSERT_TRUE(SideTraits<BUY>::better(10.0, 9.0));
+    ASSERT_FALSE(SideTraits<BUY>::better(9.0, 10.0));
+    ASSERT_TRUE(SideTraits<SELL>::better(9.0, 10.0));
+    ASSERT_FALSE(SideTraits<SELL>::better(10.0, 9.0));
+
+    // A buy limited at 10 reaches offers at or below 10
+    ASSERT_TRUE(BookSide<SELL>::reaches(9.5, 10.0));
+    ASSERT_TRUE(BookSide<SELL>::reaches(10.0, 10.0));
+    ASSERT_FALSE(BookSide<SELL>::reaches(10.5, 10.0));
+
+    // A sell limited at 10 reaches bids at or above 10
+    ASSERT_TRUE(BookSide<BUY>::reaches(10.5, 10.0));
+    ASSERT_FALSE(BookSide<BUY>::reaches(9.5, 10.0));
+}
+
+TEST(BookSideTest, market_orders_reach_every_price) {
+    Client bob("bob");
+    Order buy("ABC", 0.0, 10, BUY, bob);
+    buy.set_type(MARKET);
+    Order sell("ABC", 0.0, 10, SELL, bob);
+    sell.set_type(MARKET);
+
+    ASSERT_TRUE(BookSide<SELL>::reaches(1e9, BookSide<SELL>::limit_of(buy)));
+    ASSERT_TRUE(BookSide<BUY>::reaches(0.01, BookSide<BUY>::limit_of(sell)));
+}
+
+TEST(BookSideTest, keeps_time_priority_within_levels) {
+    Client bob("bob");
+    Order first("ABC", 10.0, 5, BUY, bob);
+    Order second("ABC", 10.0, 7, BUY, bob);
+    Order better("ABC", 10.5, 3, BUY, bob);
+
+    BookSide<BUY> bids;
+    ASSERT_EQ(5, bids.add(first));
+    ASSERT_EQ(12, bids.add(second));
+    ASSERT_EQ(3, bids.add(better));
+
+    ASSERT_EQ(10.5, bids.best_price());
+    ASSERT_EQ(&better, bids.best_order());
+
+    // Filling the only order at 10.5 empties the level
+    ASSERT_EQ(0, bids.fill_best(3));
+    ASSERT_EQ(&first, bids.best_order());
+
+    ASSERT_EQ(10, bids.fill_best(2));
+    ASSERT_EQ(&first, bids.best_order());
+    ASSERT_EQ(7, bids.fill_best(3));
+    ASSERT_EQ(&second, bids.best_order());
+}
+
+TEST(BookSideTest, can_remove_orders) {
+    Client bob("bob");
+    Order a("ABC", 10.0, 5, SELL, bob);
+    Order b("ABC", 10.0, 7, SELL, bob);
+    Order elsewhere("ABC", 11.0, 1, SELL, bob);
+
+    BookSide<SELL> asks;
+    asks.add(a);
+    asks.add(b);
+
+    int quantity = 0;
+    ASSERT_FALSE(asks.remove(elsewhere, &quantity));
+
+    ASSERT_TRUE(asks.remove(a, &quantity));
+    ASSERT_EQ(7, quantity);
+    ASSERT_EQ(&b, asks.best_order());
+
+    ASSERT_TRUE(asks.remove(b, &quantity));
+    ASSERT_EQ(0, quantity);
+    ASSERT_TRUE(asks.empty());
+    ASSERT_EQ(nullptr, asks.best_order());
+}
+
+static BookConfig ladder_config(size_t ticks) {
+    BookConfig config;
+    config.layout = LADDER_LAYOUT;
+    config.ticks_per_unit = 100;
+    config.ladder_ticks = ticks;
+    return config;
+}
+
+TEST(BookSideTest, ladder_finds_levels_across_words) {
+    Client bob("bob");
+    Order near("ABC", 100.00, 5, BUY, bob);
+    Order far("ABC", 98.50, 7, BUY, bob);
+    Order farther("ABC", 91.00, 1, BUY, bob);
+
+    LadderSide<BUY> bids(ladder_config(64));
+    ASSERT_TRUE(bids.accepts(100.01));
+    ASSERT_FALSE(bids.accepts(100.005));
+
+    // Each order is more than a word of ticks from the last, and the
+    //     last is outside the ladder so it has to grow
+    bids.add(near);
+    bids.add(far);
+    bids.add(farther);
+    ASSERT_EQ(3, bids.get_level_count());
+    ASSERT_EQ(100.00, bids.best_price());
+    ASSERT_EQ(7, bids.quantity_at(98.50));
+    ASSERT_EQ(0, bids.quantity_at(99.00));
+
+    std::vector<double> prices;
+    for (auto& level : bids) { prices.push_back(level.first); }
+    ASSERT_EQ(std::vector<double>({100.00, 98.50, 91.00}), prices);
+
+    // Emptying the best level moves on to the next one
+    ASSERT_EQ(0, bids.fill_best(5));
+    ASSERT_EQ(98.50, bids.best_price());
+
+    int quantity = 0;
+    ASSERT_TRUE(bids.remove(far, &quantity));
+    ASSERT_EQ(&farther, bids.best_order());
+    ASSERT_TRUE(bids.remove(farther, &quantity));
+    ASSERT_TRUE(bids.empty());
+}
+
+// The same random adds, removes and fills applied to both layouts
+//     leave the same levels in the same order
+template <OrderSide S>
+void check_ladder_matches_tree() {
+    Client bob("bob");
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> tick(9000, 11000);
+
+    std::vector<Order> orders;
+    orders.reserve(2000);
+    for (int i = 0; i < 2000; i++) {
+        orders.emplace_back("ABC", tick(random) / 100.0, 1 + i % 9, S, bob);
+    }
+    std::vector<Order> copies = orders;
+
+    BookSide<S> tree;
+    LadderSide<S> ladder(ladder_config(128));
+
+    for (size_t i = 0; i < orders.size(); i++) {
+        ASSERT_EQ(tree.add(orders[i]), ladder.add(copies[i]));
+
+        if (i % 3 == 0) {
+            int tree_quantity = 0;
+            int ladder_quantity = 0;
+            ASSERT_TRUE(tree.remove(orders[i / 2], &tree_quantity) ==
+                        ladder.remove(copies[i / 2], &ladder_quantity));
+            ASSERT_EQ(tree_quantity, ladder_quantity);
+        }
+
+        ASSERT_EQ(tree.empty(), ladder.empty());
+        if (tree.empty()) { continue; }
+
+        if (i % 5 == 0) {
+            int size = tree.best_order()->effective_size();
+            ASSERT_EQ(tree.fill_best(size), ladder.fill_best(size));
+        }
+
+        if (!tree.empty()) {
+            ASSERT_EQ(tree.best_price(), ladder.best_price());
+        }
+    }
+
+    ASSERT_EQ(tree.get_level_count(), ladder.get_level_count());
+    ASSERT_EQ(tree.get_order_count(), ladder.get_order_count());
+
+    auto level = ladder.begin();
+    for (auto& expected : tree) {
+        ASSERT_EQ(expected.first, level->first);
+        ASSERT_EQ(expected.second.quantity, level->second.quantity);
+        ++level;
+    }
+    ASSERT_TRUE(level == ladder.end());
+}
+
+TEST(BookSideTest, ladder_matches_tree) {
+    check_ladder_matches_tree<BUY>();
+    check_ladder_matches_tree<SELL>();
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "clock.h"
+#include "exchange.h"
+#include "orderbook.h"
+
+using namespace exchange;
+
+TEST(ClockTest, virtual_clock_only_moves_when_told) {
+    VirtualClock clock(Timestamp(std::chrono::seconds(100)));
+    ASSERT_EQ(Timestamp(std::chrono::seconds(100)), clock.now());
+    ASSERT_EQ(clock.now(), clock.now());
+
+    clock.advance(std::chrono::milliseconds(250));
+    ASSERT_EQ(Timestamp(std::chrono::milliseconds(100250)), clock.now());
+
+    clock.set(Timestamp(std::chrono::seconds(5)));
+    ASSERT_EQ(Timestamp(std::chrono::seconds(5)), clock.now());
+}
+
+TEST(ClockTest, cached_clock_reads_its_source_on_refresh) {
+    VirtualClock source(Timestamp(std::chrono::seconds(1)));
+    CachedClock clock(source);
+    ASSERT_EQ(Timestamp(std::chrono::seconds(1)), clock.now());
+
+    source.advance(std::chrono::seconds(1));
+    ASSERT_EQ(Timestamp(std::chrono::seconds(1)), clock.now());
+
+    ASSERT_EQ(Timestamp(std::chrono::seconds(2)), clock.refresh());
+    ASSERT_EQ(Timestamp(std::chrono::seconds(2)), clock.now());
+}
+
+TEST(ClockTest, tsc_clock_follows_the_system_clock) {
+    TscClock clock(std::chrono::milliseconds(5));
+
+    Timestamp previous = clock.now();
+    for (int i = 0; i < 1000; i++) {
+        Timestamp next = clock.now();
+        ASSERT_LE(previous, next);
+        previous = next;
+    }
+
+    auto difference = clock.now() - std::chrono::high_resolution_clock::now();
+    ASSERT_LT(difference, std::chrono::milliseconds(5));
+    ASSERT_GT(difference, std::chrono::milliseconds(-5));
+}
+
+TEST(ClockTest, books_stamp_orders_and_trades_with_their_clock) {
+    VirtualClock clock(Timestamp(std::chrono::seconds(10)));
+    Client alice("alice");
+    Client bob("bob");
+
+    Orderbook ob("ABC");
+    ob.set_clock(&clock);
+
+    Order sell("ABC", 100.00, 10, SELL, alice);
+    ob.submit_order(sell);
+    ASSERT_EQ(Timestamp(std::chrono::seconds(10)), sell.get_order_time());
+
+    clock.advance(std::chrono::seconds(1));
+    Order buy("ABC", 100.00, 10, BUY, bob);
+    ASSERT_EQ(Timestamp(), buy.get_order_time());
+    ob.submit_order(buy);
+
+    ASSERT_EQ(Timestamp(std::chrono::seconds(11)), buy.get_order_time());
+    ASSERT_EQ(1, ob.get_trades()->size());
+    ASSERT_EQ(11000, ob.get_trades()->front()->get_trade_time_ms());
+}
+
+TEST(ClockTest, exchange_gives_its_clock_to_every_book) {
+    VirtualClock clock(Timestamp(std::chrono::seconds(20)));
+    Client alice("alice");
+    Client bob("bob");
+
+    Exchange ex;
+    Orderbook* abc = ex.add_instrument("ABC");
+    ex.set_clock(&clock);
+    Orderbook* xyz = ex.add_instrument("XYZ");
+
+    Order first("ABC", 100.00, 10, SELL, alice);
+    Order second("XYZ", 50.00, 10, SELL, bob);
+    ASSERT_TRUE(ex.submit_order(first));
+    ASSERT_TRUE(ex.submit_order(second));
+
+    ASSERT_EQ(Timestamp(std::chrono::seconds(20)), first.get_order_time());
+    ASSERT_EQ(Timestamp(std::chrono::seconds(20)), second.get_order_time());
+    ASSERT_EQ(abc, ex.get_orderbook("ABC"));
+    ASSERT_EQ(xyz, ex.get_orderbook("XYZ"));
+}
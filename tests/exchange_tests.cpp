@@ -1,7 +1,100 @@
+#include <vector>
+
 #include "gtest/gtest.h"
+#include "clock.h"
 #include "exchange.h"
 
 TEST(ExchangeTest, statusIsReady) {
     exchange::Exchange e;
     ASSERT_STREQ("Ready.", e.get_status().c_str());
 }
+
+TEST(ExchangeTest, routes_orders_to_books) {
+    exchange::Exchange e;
+    exchange::Orderbook* ob = e.add_instrument("ABC");
+
+    ASSERT_EQ(ob, e.get_orderbook("ABC"));
+    ASSERT_EQ(nullptr, e.get_orderbook("CBA"));
+
+    exchange::Client bob("bob");
+    exchange::Order o1("ABC", 100.00, 5, exchange::BUY, bob);
+    exchange::Order o2("CBA", 100.00, 5, exchange::BUY, bob);
+
+    ASSERT_TRUE(e.submit_order(o1));
+    ASSERT_EQ(100.00, ob->get_best_bid());
+
+    ASSERT_FALSE(e.submit_order(o2));
+    ASSERT_EQ(exchange::REJECTED, o2.get_status());
+}
+
+TEST(ExchangeTest, applies_risk_checks) {
+    exchange::Exchange e;
+    exchange::Orderbook* ob = e.add_instrument("ABC");
+
+    exchange::RiskLimits limits;
+    limits.max_order_size = 10;
+    e.get_risk().set_limits(limits);
+
+    exchange::Client bob("bob");
+    exchange::Order o1("ABC", 100.00, 11, exchange::BUY, bob);
+
+    exchange::RiskResult result;
+    ASSERT_FALSE(e.submit_order(o1, &result));
+    ASSERT_EQ(exchange::RISK_ORDER_SIZE, result);
+    ASSERT_EQ(exchange::REJECTED, o1.get_status());
+    ASSERT_EQ(0.0, ob->get_best_bid());
+
+    // Cancelling a resting order releases its open quantity
+    exchange::Order o2("ABC", 100.00, 10, exchange::BUY, bob);
+    ASSERT_TRUE(e.submit_order(o2, &result));
+    ASSERT_EQ(10, e.get_risk().get_open_quantity("bob", exchange::BUY));
+
+    o2.cancel();
+    ASSERT_EQ(0, e.get_risk().get_open_quantity("bob", exchange::BUY));
+}
+
+TEST(ExchangeTest, replays_with_recorded_times) {
+    exchange::RiskLimits limits;
+    limits.max_messages_per_second = 2;
+
+    exchange::Exchange primary;
+    exchange::Exchange replica;
+    primary.add_instrument("ABC");
+    replica.add_instrument("ABC");
+    primary.get_risk().set_limits(limits);
+    replica.get_risk().set_limits(limits);
+
+    exchange::Client bob("bob");
+    std::vector<exchange::Order> first;
+    for (int i = 0; i < 4; i++) {
+        first.emplace_back("ABC", 100.00 - i, 1, exchange::BUY, bob);
+    }
+    std::vector<exchange::Order> second = first;
+
+    // The third order goes over the rate and the fourth comes once the
+    //     throttle's window has moved on
+    Timestamp start = std::chrono::high_resolution_clock::now();
+    std::vector<Timestamp> times = {start, start, start + std::chrono::milliseconds(500),
+                                    start + std::chrono::milliseconds(1200)};
+    std::vector<bool> accepted;
+    for (size_t i = 0; i < first.size(); i++) {
+        accepted.push_back(primary.submit_order(first[i], times[i]));
+    }
+    ASSERT_EQ(std::vector<bool>({true, true, false, true}), accepted);
+
+    // Replayed once the replica's clock has moved well past them, the
+    //     throttle sees the times of the original messages. At the time
+    //     of the replay all four would fall in one window.
+    Timestamp later = start + std::chrono::seconds(5);
+    exchange::VirtualClock replay_clock(later);
+    replica.set_clock(&replay_clock);
+    for (size_t i = 0; i < second.size(); i++) {
+        ASSERT_EQ(accepted[i], replica.submit_order(second[i], times[i]));
+    }
+
+    ASSERT_EQ(primary.checksum(), replica.checksum());
+
+    exchange::Order o1("ABC", 95.00, 1, exchange::BUY, bob);
+    ASSERT_TRUE(replica.submit_order(o1, later));
+    ASSERT_NE(primary.checksum(), replica.checksum());
+}
@@ -0,0 +1,143 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "low_latency.h"
+#include "orderbook.h"
+
+using namespace exchange;
+
+TEST(LowLatencyTest, spins_then_yields) {
+    WaitStrategy wait(3);
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(wait.is_spinning());
+        wait.idle();
+    }
+    ASSERT_TRUE(wait.is_spinning());
+    wait.idle();
+    ASSERT_FALSE(wait.is_spinning());
+
+    wait.reset();
+    ASSERT_TRUE(wait.is_spinning());
+}
+
+TEST(LowLatencyTest, doorbell_wakes_a_sleeping_consumer) {
+    Doorbell doorbell;
+    std::atomic<bool> work(false);
+
+    std::thread producer([&doorbell, &work]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        work.store(true);
+        doorbell.ring();
+    });
+
+    // Woken by the producer long before the time runs out
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        doorbell.prepare();
+        if (work.load()) {
+            doorbell.cancel();
+            break;
+        }
+        doorbell.wait(start + std::chrono::seconds(10));
+    }
+    producer.join();
+
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST(LowLatencyTest, doorbell_sleeps_until_the_deadline) {
+    Doorbell doorbell;
+
+    // Nobody is sleeping, so ringing does nothing
+    doorbell.ring();
+
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(5);
+    doorbell.prepare();
+    doorbell.wait(until);
+    ASSERT_GE(std::chrono::steady_clock::now(), until);
+}
+
+TEST(LowLatencyTest, arena_allocates_aligned_until_full) {
+    Arena arena(4096, false);
+    ASSERT_TRUE(arena.is_valid());
+    ASSERT_EQ(4096, arena.get_capacity());
+
+    void* a = arena.allocate(3, 1);
+    void* b = arena.allocate(16, 16);
+    ASSERT_NE(nullptr, a);
+    ASSERT_NE(nullptr, b);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(b) % 16);
+    ASSERT_EQ(32, arena.get_used());
+
+    ASSERT_EQ(nullptr, arena.allocate(4096, 1));
+    ASSERT_NE(nullptr, arena.allocate(4096 - 32, 1));
+    ASSERT_EQ(nullptr, arena.allocate(1, 1));
+}
+
+TEST(LowLatencyTest, hugepage_arena_rounds_up) {
+    // Falls back to normal pages when no hugepages are reserved
+    Arena arena(1, true);
+    ASSERT_TRUE(arena.is_valid());
+    ASSERT_EQ(2 * 1024 * 1024, arena.get_capacity());
+}
+
+TEST(LowLatencyTest, book_allocates_trades_from_arena) {
+    Arena arena(2 * sizeof(Trade), false);
+    Client bob("bob");
+    Client alice("alice");
+    Order o1("ABC", 100.00, 10, SELL, alice);
+    Order o2("ABC", 100.00, 10, BUY, bob);
+    Orderbook ob("ABC");
+    ob.set_trade_arena(&arena);
+    ob.reserve_trades(16);
+
+    ob.submit_order(o1);
+    ob.submit_order(o2);
+
+    ASSERT_EQ(1, ob.get_trades()->size());
+    ASSERT_GT(arena.get_used(), sizeof(Trade));
+    ASSERT_LT(arena.get_used(), 2 * sizeof(Trade));
+    ASSERT_EQ(100.00, ob.get_trades()->at(0)->get_price());
+}
+
+struct Counted {
+    Counted(std::vector<int>* destroyed, int id) : destroyed(destroyed), id(id) {}
+    ~Counted() { destroyed->push_back(id); }
+
+    std::vector<int>* destroyed;
+    int id;
+};
+
+TEST(LowLatencyTest, arena_destroys_what_it_creates) {
+    std::vector<int> destroyed;
+    {
+        Arena arena(4096, false);
+        ASSERT_NE(nullptr, arena.create<Counted>(&destroyed, 1));
+        ASSERT_NE(nullptr, arena.create<Counted>(&destroyed, 2));
+
+        // An object that doesn't fit leaves the arena as it was
+        typedef std::array<char, 4096> Page;
+        size_t used = arena.get_used();
+        ASSERT_EQ(nullptr, arena.create<Page>());
+        ASSERT_EQ(used, arena.get_used());
+        ASSERT_TRUE(destroyed.empty());
+    }
+
+    ASSERT_EQ((std::vector<int>{2, 1}), destroyed);
+}
+
+TEST(LowLatencyTest, can_pin_threads) {
+    ASSERT_TRUE(pin_thread(-1));
+
+    // Pinned on another thread so the rest of the tests can use every CPU
+    bool pinned = false;
+    std::thread t([&pinned]() { pinned = pin_thread(0); });
+    t.join();
+    ASSERT_TRUE(pinned);
+}
@@ -0,0 +1,275 @@
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "md_feed.h"
+
+using namespace exchange;
+
+// Receives whatever a publisher sends to a port so tests can choose which
+//     packets a subscriber gets to see
+class PacketSink {
+    public:
+        PacketSink(uint16_t port) {
+            fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+            sockaddr_in local;
+            std::memset(&local, 0, sizeof(local));
+            local.sin_family = AF_INET;
+            local.sin_port = htons(port);
+            inet_pton(AF_INET, "127.0.0.1", &local.sin_addr);
+            bind(fd, (sockaddr*) &local, sizeof(local));
+
+            timeval timeout = {1, 0};
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        }
+
+        ~PacketSink() { close(fd); }
+
+        std::vector<char> receive() {
+            std::vector<char> packet(MD_PACKET_SIZE);
+            ssize_t size = recv(fd, packet.data(), packet.size(), 0);
+            packet.resize(size < 0 ? 0 : size);
+
+            return packet;
+        }
+    private:
+        int fd;
+};
+
+// Polls until the condition holds or a second has passed
+template <typename F>
+bool wait_for(F condition, MdPublisher* publisher, MdSubscriber& subscriber) {
+    for (int i = 0; i < 1000; i++) {
+        if (publisher != nullptr) { publisher->poll(); }
+        subscriber.poll();
+
+        if (condition()) { return true; }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return false;
+}
+
+TEST(MdFeedTest, can_encode_and_decode_messages) {
+    MdMessage m;
+    m.sequence = 1234567890123ULL;
+    m.type = MD_TRADE;
+    m.instrument = "ABC";
+    m.side = SELL;
+    m.price = 101.2345;
+    m.quantity = 500;
+
+    char packet[MD_PACKET_SIZE];
+    encode_md_message(m, packet);
+
+    MdMessage decoded;
+    ASSERT_TRUE(decode_md_message(packet, MD_PACKET_SIZE, decoded));
+    ASSERT_EQ(m.sequence, decoded.sequence);
+    ASSERT_EQ(MD_TRADE, decoded.type);
+    ASSERT_EQ("ABC", decoded.instrument);
+    ASSERT_EQ(SELL, decoded.side);
+    ASSERT_DOUBLE_EQ(101.2345, decoded.price);
+    ASSERT_EQ(500, decoded.quantity);
+
+    // Truncated packets are refused
+    ASSERT_FALSE(decode_md_message(packet, MD_PACKET_SIZE - 1, decoded));
+}
+
+TEST(MdFeedTest, retransmit_buffer_keeps_latest_packets) {
+    RetransmitBuffer buffer(4);
+    char packet[MD_PACKET_SIZE];
+
+    ASSERT_EQ(nullptr, buffer.get(1));
+
+    for (uint64_t s = 1; s <= 6; s++) {
+        MdMessage m;
+        m.sequence = s;
+        m.type = MD_LEVEL;
+        encode_md_message(m, packet);
+        buffer.store(s, packet);
+    }
+
+    // Only the last four sequence numbers are still held
+    ASSERT_EQ(3, buffer.first_available());
+    ASSERT_EQ(nullptr, buffer.get(2));
+    ASSERT_EQ(nullptr, buffer.get(7));
+
+    MdMessage m;
+    ASSERT_TRUE(decode_md_message(buffer.get(5), MD_PACKET_SIZE, m));
+    ASSERT_EQ(5, m.sequence);
+}
+
+TEST(MdFeedTest, retransmit_buffer_always_has_room) {
+    RetransmitBuffer buffer(0);
+    char packet[MD_PACKET_SIZE];
+
+    MdMessage m;
+    m.sequence = 1;
+    encode_md_message(m, packet);
+    buffer.store(1, packet);
+
+    ASSERT_EQ(1, buffer.first_available());
+    ASSERT_TRUE(decode_md_message(buffer.get(1), MD_PACKET_SIZE, m));
+    ASSERT_EQ(1, m.sequence);
+}
+
+TEST(MdFeedTest, refuses_instruments_with_long_names) {
+    const uint16_t SINK_PORT = 47141;
+    const uint16_t REQUEST_PORT = 47142;
+
+    PacketSink sink(SINK_PORT);
+
+    MdPublisher publisher(16);
+    ASSERT_TRUE(publisher.open("127.0.0.1", SINK_PORT, "127.0.0.1", REQUEST_PORT));
+
+    // Cut to eight characters it would look like ABCDEFGH on the feed
+    publisher.on_level_change("ABCDEFGHI", BUY, 100.00, 10);
+    publisher.on_level_change("ABCDEFGH", BUY, 100.00, 20);
+    ASSERT_EQ(1, publisher.get_sequence());
+    ASSERT_EQ(1, publisher.get_unpublishable());
+
+    std::vector<char> packet = sink.receive();
+    MdMessage m;
+    ASSERT_TRUE(decode_md_message(packet.data(), packet.size(), m));
+    ASSERT_EQ("ABCDEFGH", m.instrument);
+    ASSERT_EQ(20, m.quantity);
+}
+
+TEST(MdFeedTest, subscriber_recovers_gaps) {
+    const uint16_t SINK_PORT = 47101;
+    const uint16_t SUBSCRIBER_PORT = 47102;
+    const uint16_t REQUEST_PORT = 47103;
+
+    PacketSink sink(SINK_PORT);
+
+    MdPublisher publisher(16);
+    ASSERT_TRUE(publisher.open("127.0.0.1", SINK_PORT, "127.0.0.1", REQUEST_PORT));
+
+    std::vector<MdMessage> received;
+    MdSubscriber subscriber([&received](const MdMessage& m) { received.push_back(m); });
+    ASSERT_TRUE(subscriber.open("127.0.0.1", SUBSCRIBER_PORT, "127.0.0.1", "127.0.0.1", REQUEST_PORT));
+
+    publisher.on_level_change("ABC", BUY, 100.00, 10);
+    publisher.on_level_change("ABC", BUY, 100.00, 20);
+    publisher.on_level_change("ABC", SELL, 101.00, 5);
+    ASSERT_EQ(3, publisher.get_sequence());
+
+    std::vector<char> p1 = sink.receive();
+    std::vector<char> p2 = sink.receive();
+    std::vector<char> p3 = sink.receive();
+
+    // The second packet is lost so the third is held back
+    subscriber.handle_packet(p1.data(), p1.size());
+    subscriber.handle_packet(p3.data(), p3.size());
+
+    ASSERT_EQ(1, received.size());
+    ASSERT_EQ(1, subscriber.get_pending());
+
+    // The subscriber asked for the gap and gets it back from the publisher
+    ASSERT_TRUE(wait_for([&received]() { return received.size() == 3; }, &publisher, subscriber));
+    ASSERT_EQ(1, publisher.get_retransmitted());
+
+    ASSERT_EQ(2, received[1].sequence);
+    ASSERT_EQ(20, received[1].quantity);
+    ASSERT_EQ(3, received[2].sequence);
+    ASSERT_EQ(SELL, received[2].side);
+    ASSERT_EQ(0, subscriber.get_pending());
+}
+
+TEST(MdFeedTest, subscriber_skips_unrecoverable_gaps) {
+    const uint16_t SINK_PORT = 47111;
+    const uint16_t SUBSCRIBER_PORT = 47112;
+    const uint16_t REQUEST_PORT = 47113;
+
+    PacketSink sink(SINK_PORT);
+
+    // Only two messages are kept for retransmission
+    MdPublisher publisher(2);
+    ASSERT_TRUE(publisher.open("127.0.0.1", SINK_PORT, "127.0.0.1", REQUEST_PORT));
+
+    std::vector<MdMessage> received;
+    MdSubscriber subscriber([&received](const MdMessage& m) { received.push_back(m); });
+    ASSERT_TRUE(subscriber.open("127.0.0.1", SUBSCRIBER_PORT, "127.0.0.1", "127.0.0.1", REQUEST_PORT));
+
+    std::vector<std::vector<char>> packets;
+    for (int i = 1; i <= 5; i++) {
+        publisher.on_level_change("ABC", BUY, 100.00, i);
+        packets.push_back(sink.receive());
+    }
+
+    // Messages 2 and 3 are lost and have already left the buffer
+    subscriber.handle_packet(packets[0].data(), packets[0].size());
+    subscriber.handle_packet(packets[3].data(), packets[3].size());
+    subscriber.handle_packet(packets[4].data(), packets[4].size());
+
+    ASSERT_TRUE(wait_for([&subscriber]() { return subscriber.get_lost() == 2; }, &publisher, subscriber));
+
+    ASSERT_EQ(3, received.size());
+    ASSERT_EQ(4, received[1].sequence);
+    ASSERT_EQ(5, received[2].sequence);
+    ASSERT_EQ(6, subscriber.get_next_sequence());
+}
+
+TEST(MdFeedTest, publishes_over_loopback_multicast) {
+    const uint16_t FEED_PORT = 47121;
+    const uint16_t REQUEST_PORT = 47122;
+
+    MdPublisher publisher(16);
+    ASSERT_TRUE(publisher.open("239.255.0.1", FEED_PORT, "127.0.0.1", REQUEST_PORT));
+
+    std::vector<MdMessage> received;
+    MdSubscriber subscriber([&received](const MdMessage& m) { received.push_back(m); });
+    ASSERT_TRUE(subscriber.open("239.255.0.1", FEED_PORT, "127.0.0.1", "127.0.0.1", REQUEST_PORT));
+
+    Client bob("bob");
+    Client alice("alice");
+    publisher.on_trade(Trade("ABC", 100.00, 5, BUY, alice, bob));
+
+    ASSERT_TRUE(wait_for([&received]() { return received.size() == 1; }, nullptr, subscriber));
+    ASSERT_EQ(MD_TRADE, received[0].type);
+    ASSERT_EQ(5, received[0].quantity);
+}
+
+TEST(MdFeedTest, subscriber_recovers_gaps_over_multicast) {
+    const uint16_t FEED_PORT = 47151;
+    const uint16_t REQUEST_PORT = 47152;
+
+    MdPublisher publisher(16);
+    ASSERT_TRUE(publisher.open("239.255.0.2", FEED_PORT, "127.0.0.1", REQUEST_PORT));
+
+    // Another member of the group picks up the feed so the test can choose
+    //     which messages the subscriber sees
+    std::vector<MdMessage> tapped;
+    MdSubscriber tap([&tapped](const MdMessage& m) { tapped.push_back(m); });
+    ASSERT_TRUE(tap.open("239.255.0.2", FEED_PORT, "127.0.0.1", "127.0.0.1", REQUEST_PORT));
+
+    publisher.on_level_change("ABC", BUY, 100.00, 10);
+    publisher.on_level_change("ABC", BUY, 100.00, 20);
+    publisher.on_level_change("ABC", SELL, 101.00, 5);
+    ASSERT_TRUE(wait_for([&tapped]() { return tapped.size() == 3; }, nullptr, tap));
+
+    // Joins after the messages were sent, then sees all but the second
+    std::vector<MdMessage> received;
+    MdSubscriber subscriber([&received](const MdMessage& m) { received.push_back(m); });
+    ASSERT_TRUE(subscriber.open("239.255.0.2", FEED_PORT, "127.0.0.1", "127.0.0.1", REQUEST_PORT));
+
+    char packet[MD_PACKET_SIZE];
+    encode_md_message(tapped[0], packet);
+    subscriber.handle_packet(packet, sizeof(packet));
+    encode_md_message(tapped[2], packet);
+    subscriber.handle_packet(packet, sizeof(packet));
+    ASSERT_EQ(1, subscriber.get_pending());
+
+    // The retransmission is sent to the subscriber rather than the group
+    ASSERT_TRUE(wait_for([&received]() { return received.size() == 3; }, &publisher, subscriber));
+    ASSERT_EQ(1, publisher.get_retransmitted());
+    ASSERT_EQ(20, received[1].quantity);
+    ASSERT_EQ(0, subscriber.get_pending());
+}
@@ -0,0 +1,29 @@
+#include "gtest/gtest.h"
+#include "messages.h"
+
+using namespace exchange;
+
+TEST(MessagesTest, tells_message_types_apart) {
+    ASSERT_EQ(ORDER_MESSAGE, message_type("o|ABC|100.0000|5|BUY|bob"));
+    ASSERT_EQ(CANCEL_MESSAGE, message_type("c|12"));
+    ASSERT_EQ(QUERY_MESSAGE, message_type("bbbo"));
+    ASSERT_EQ(QUERY_MESSAGE, message_type("br|ABC|60|10"));
+    ASSERT_EQ(MARKET_CONTROL_MESSAGE, message_type("au|ABC"));
+    ASSERT_EQ(MARKET_CONTROL_MESSAGE, message_type("op|ABC"));
+    ASSERT_EQ(MARKET_CONTROL_MESSAGE, message_type("cl|ABC"));
+}
+
+TEST(MessagesTest, only_operators_control_the_market) {
+    // Order entry sessions are rejected with NOT_PERMITTED_REPLY
+    ASSERT_FALSE(may_send(ORDER_ENTRY_SESSION, message_type("au|ABC")));
+    ASSERT_FALSE(may_send(ORDER_ENTRY_SESSION, message_type("op|ABC")));
+    ASSERT_FALSE(may_send(ORDER_ENTRY_SESSION, message_type("cl|ABC")));
+    ASSERT_EQ("REJ|NOT_PERMITTED", NOT_PERMITTED_REPLY);
+
+    ASSERT_TRUE(may_send(OPERATOR_SESSION, message_type("op|ABC")));
+
+    // Everything else is open to every session
+    ASSERT_TRUE(may_send(ORDER_ENTRY_SESSION, message_type("o|ABC|100.0000|5|BUY|bob")));
+    ASSERT_TRUE(may_send(ORDER_ENTRY_SESSION, message_type("c|12")));
+    ASSERT_TRUE(may_send(ORDER_ENTRY_SESSION, message_type("bbbo")));
+}
@@ -0,0 +1,132 @@
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#include "orderbook.h"
+
+using namespace exchange;
+
+TEST(MetricsTest, renders_prometheus_text) {
+    MetricsRegistry registry;
+    Metric& orders = registry.counter("orders_total", "Orders seen");
+    Metric& buy = registry.gauge("resting", "Resting orders", "side=\"buy\"");
+    Metric& sell = registry.gauge("resting", "Resting orders", "side=\"sell\"");
+
+    orders.add();
+    orders.add(2);
+    buy.set(5);
+    sell.set(7);
+
+    // Registering again hands back the same metric
+    ASSERT_EQ(&orders, &registry.counter("orders_total", "Orders seen"));
+
+    std::string expected =
+        "# HELP orders_total Orders seen\n"
+        "# TYPE orders_total counter\n"
+        "orders_total 3\n"
+        "# HELP resting Resting orders\n"
+        "# TYPE resting gauge\n"
+        "resting{side=\"buy\"} 5\n"
+        "resting{side=\"sell\"} 7\n";
+    ASSERT_EQ(expected, registry.render());
+}
+
+TEST(MetricsTest, books_update_their_metrics) {
+    MetricsRegistry registry;
+    Client bob("bob");
+    Client alice("alice");
+    Order o1("ABC", 100.00, 10, SELL, alice);
+    Order o2("ABC", 101.00, 10, SELL, alice);
+    Order o3("ABC", 100.00, 4, BUY, bob);
+    Order o4("ABC", 99.00, 4, BUY, bob);
+    Orderbook ob("ABC");
+    ob.set_metrics(registry);
+
+    ob.submit_order(o1);
+    ob.submit_order(o2);
+    ob.submit_order(o3);
+    ob.submit_order(o4);
+
+    std::string book = "instrument=\"ABC\"";
+    ASSERT_EQ(4, registry.counter("exchange_orders_total", "", book).get());
+    ASSERT_EQ(1, registry.counter("exchange_trades_total", "", book).get());
+    ASSERT_EQ(4, registry.counter("exchange_traded_volume_total", "", book).get());
+
+    // Gauges wait for the book to be asked to update them
+    ASSERT_EQ(0, registry.gauge("exchange_resting_orders", "", book + ",side=\"sell\"").get());
+    ob.update_metrics();
+
+    ASSERT_EQ(1, registry.gauge("exchange_resting_orders", "", book + ",side=\"buy\"").get());
+    ASSERT_EQ(2, registry.gauge("exchange_resting_orders", "", book + ",side=\"sell\"").get());
+    ASSERT_EQ(2, registry.gauge("exchange_price_levels", "", book + ",side=\"sell\"").get());
+    ASSERT_EQ(1, registry.gauge("exchange_stored_trades", "", book).get());
+    ASSERT_EQ((long) ob.get_memory_usage(), registry.gauge("exchange_book_memory_bytes", "", book).get());
+
+    // Cancels update the gauges too
+    o2.cancel();
+    ob.update_metrics();
+    ASSERT_EQ(1, registry.gauge("exchange_price_levels", "", book + ",side=\"sell\"").get());
+}
+
+TEST(MetricsServerTest, serves_metrics) {
+    MetricsRegistry registry;
+    registry.counter("orders_total", "Orders seen").add(42);
+
+    MetricsServer server(registry);
+    ASSERT_TRUE(server.listen("127.0.0.1", 0));
+    std::thread loop([&server]() { server.run(); });
+
+    auto scrape = [&server](const std::string& request) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(server.get_port());
+        inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        if (connect(fd, (sockaddr*) &address, sizeof(address)) != 0) {
+            close(fd);
+            return std::string();
+        }
+
+        send(fd, request.data(), request.size(), 0);
+
+        std::string response;
+        char data[1024];
+        ssize_t received;
+        while ((received = recv(fd, data, sizeof(data), 0)) > 0) {
+            response.append(data, received);
+        }
+        close(fd);
+
+        return response;
+    };
+
+    std::string response = scrape("GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    ASSERT_EQ(0, response.find("HTTP/1.0 200 OK\r\n"));
+    ASSERT_NE(std::string::npos, response.find("\r\n\r\n# HELP orders_total Orders seen\n"));
+    ASSERT_NE(std::string::npos, response.find("orders_total 42\n"));
+
+    response = scrape("GET / HTTP/1.1\r\n\r\n");
+    ASSERT_EQ(0, response.find("HTTP/1.0 404 Not Found\r\n"));
+
+    server.stop();
+    loop.join();
+}
+
+TEST(MetricsServerTest, stops_before_running) {
+    MetricsRegistry registry;
+    MetricsServer server(registry);
+    ASSERT_TRUE(server.listen("127.0.0.1", 0));
+
+    server.stop();
+    std::thread loop([&server]() { server.run(); });
+    loop.join();
+}
@@ -0,0 +1,81 @@
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mpsc_queue.h"
+
+using namespace exchange;
+
+TEST(MpscQueueTest, pops_in_push_order) {
+    MpscQueue<int> q(4);
+    int value;
+
+    ASSERT_FALSE(q.try_pop(value));
+
+    ASSERT_TRUE(q.try_push(1));
+    ASSERT_TRUE(q.try_push(2));
+    ASSERT_TRUE(q.try_push(3));
+
+    ASSERT_TRUE(q.try_pop(value));
+    ASSERT_EQ(1, value);
+    ASSERT_TRUE(q.try_pop(value));
+    ASSERT_EQ(2, value);
+    ASSERT_TRUE(q.try_pop(value));
+    ASSERT_EQ(3, value);
+    ASSERT_FALSE(q.try_pop(value));
+}
+
+TEST(MpscQueueTest, rejects_push_when_full) {
+    MpscQueue<int> q(3);
+
+    // Capacity is rounded up to a power of two
+    ASSERT_EQ(4, q.capacity());
+
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(q.try_push(i));
+    }
+    ASSERT_FALSE(q.try_push(4));
+
+    // Popping makes room again
+    int value;
+    ASSERT_TRUE(q.try_pop(value));
+    ASSERT_TRUE(q.try_push(4));
+}
+
+TEST(MpscQueueTest, many_producers_one_consumer) {
+    const int PRODUCERS = 4;
+    const int PER_PRODUCER = 10000;
+
+    MpscQueue<int> q(64);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([&q, p]() {
+            for (int i = 0; i < PER_PRODUCER; i++) {
+                while (!q.try_push(p * PER_PRODUCER + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Values from each producer must arrive in the order they were pushed
+    std::vector<int> last(PRODUCERS, -1);
+    int received = 0;
+    while (received < PRODUCERS * PER_PRODUCER) {
+        int value;
+        if (!q.try_pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        int producer = value / PER_PRODUCER;
+        ASSERT_LT(last[producer], value);
+        last[producer] = value;
+        received++;
+    }
+
+    for (auto& t : producers) {
+        t.join();
+    }
+}
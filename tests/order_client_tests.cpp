@@ -0,0 +1,169 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "order.h"
+#include "order_client.h"
+#include "tcp_gateway.h"
+
+using namespace exchange;
+
+class RecordingListener : public OrderClientListener {
+    public:
+        void on_ack(uint64_t client_order_id, uint64_t order_id) override {
+            events.push_back("ack " + std::to_string(client_order_id) + " " + std::to_string(order_id));
+        }
+        void on_reject(uint64_t client_order_id, const std::string& reason) override {
+            events.push_back("reject " + std::to_string(client_order_id) + " " + reason);
+        }
+        void on_fill(uint64_t client_order_id, double, int size, int remaining) override {
+            events.push_back("fill " + std::to_string(client_order_id) + " " + std::to_string(size) +
+                             " " + std::to_string(remaining));
+        }
+        void on_cancel(uint64_t client_order_id, bool accepted) override {
+            events.push_back("cancel " + std::to_string(client_order_id) + (accepted ? " A" : " R"));
+        }
+        void on_reply(const std::string& query, const std::string& reply) override {
+            events.push_back(query + " " + reply);
+        }
+
+        std::vector<std::string> events;
+};
+
+TEST(OrderClientTest, pipelines_orders_and_matches_replies) {
+    // Stands in for the exchange, replying to each message in turn
+    std::vector<std::string> received;
+    TcpGateway* gateway_ptr = nullptr;
+    TcpGateway gateway([&](uint64_t session, const std::string& payload) {
+        received.push_back(payload);
+
+        if (received.size() == 1) {
+            gateway_ptr->send(session, "ACK|100");
+            gateway_ptr->send(session, "f|100|100.0000|5|5");
+        } else if (received.size() == 2) {
+            gateway_ptr->send(session, "REJ|PRICE_BAND");
+        } else if (received.size() == 3) {
+            gateway_ptr->send(session, "ACK|101");
+        } else if (payload == "bbbo") {
+            gateway_ptr->send(session, "bbbo|99.0000|101.0000|0");
+        } else if (payload == "c|101") {
+            gateway_ptr->send(session, "c|101|A");
+        } else if (payload == "c|100") {
+            gateway_ptr->send(session, "f|100|100.0000|5|0");
+            gateway_ptr->send(session, "c|100|R");
+        }
+    }, false);
+    gateway_ptr = &gateway;
+
+    ASSERT_TRUE(gateway.listen("127.0.0.1", 0));
+    std::thread loop([&gateway]() { gateway.run(); });
+
+    RecordingListener listener;
+    OrderClient client(listener);
+    ASSERT_TRUE(client.connect("127.0.0.1", gateway.get_port()));
+
+    Client bot("bot");
+    Order buy("ABC", 100.00, 10, BUY, bot);
+    Order far("ABC", 150.00, 10, BUY, bot);
+    Order sell("ABC", 101.00, 10, SELL, bot);
+    sell.set_time_in_force(IOC);
+
+    // Everything is sent before any reply has arrived
+    ASSERT_EQ(1, client.submit(buy));
+    ASSERT_EQ(2, client.submit(far));
+    ASSERT_EQ(3, client.submit(sell));
+    ASSERT_TRUE(client.query("bbbo"));
+    ASSERT_EQ(4, client.get_outstanding());
+
+    // Cancelled before its ACK, so the cancel waits for it
+    ASSERT_TRUE(client.cancel(3));
+    ASSERT_FALSE(client.cancel(7));
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (listener.events.size() < 6 && std::chrono::steady_clock::now() < deadline) {
+        client.poll();
+    }
+
+    ASSERT_EQ(100, client.get_order_id(1));
+    ASSERT_TRUE(client.cancel(1));
+
+    while (listener.events.size() < 8 && std::chrono::steady_clock::now() < deadline) {
+        client.poll();
+    }
+
+    gateway.stop();
+    loop.join();
+
+    ASSERT_EQ("o|ABC|101.0000|10|SELL|bot|IOC", received[2]);
+
+    std::vector<std::string> expected = {
+        "ack 1 100", "fill 1 5 5", "reject 2 PRICE_BAND", "ack 3 101", "bbbo bbbo|99.0000|101.0000|0",
+        "cancel 3 A", "fill 1 5 0", "cancel 1 R"
+    };
+    ASSERT_EQ(expected, listener.events);
+    ASSERT_EQ(0, client.get_outstanding());
+    ASSERT_EQ(0, client.get_order_id(1));
+}
+
+TEST(OrderClientTest, refuses_messages_when_not_connected) {
+    RecordingListener listener;
+    OrderClient client(listener);
+
+    Client bot("bot");
+    Order buy("ABC", 100.00, 10, BUY, bot);
+
+    ASSERT_EQ(0, client.submit(buy));
+    ASSERT_FALSE(client.query("bbbo"));
+    ASSERT_EQ(0, client.poll());
+}
+
+TEST(OrderClientTest, keeps_replies_in_step_after_unreadable_messages) {
+    // Answers like the exchange: REJ|PARSE for anything it can't read
+    TcpGateway* gateway_ptr = nullptr;
+    uint64_t next_id = 1;
+    TcpGateway gateway([&](uint64_t session, const std::string& payload) {
+        if (payload == "nonsense") {
+            gateway_ptr->send(session, "REJ|PARSE");
+        } else if (payload.find("|noid") != std::string::npos) {
+            gateway_ptr->send(session, "ACK|");
+        } else {
+            gateway_ptr->send(session, "ACK|" + std::to_string(next_id++));
+        }
+    }, false);
+    gateway_ptr = &gateway;
+
+    ASSERT_TRUE(gateway.listen("127.0.0.1", 0));
+    std::thread loop([&gateway]() { gateway.run(); });
+
+    RecordingListener listener;
+    OrderClient client(listener);
+    ASSERT_TRUE(client.connect("127.0.0.1", gateway.get_port()));
+
+    Client bot("bot");
+    Client noid("noid");
+    Order first("ABC", 100.00, 10, BUY, bot);
+    Order second("ABC", 100.00, 10, BUY, noid);
+    Order third("ABC", 100.00, 10, SELL, bot);
+
+    ASSERT_TRUE(client.query("nonsense"));
+    ASSERT_EQ(1, client.submit(first));
+    ASSERT_EQ(2, client.submit(second));
+    ASSERT_EQ(3, client.submit(third));
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (listener.events.size() < 4 && std::chrono::steady_clock::now() < deadline) {
+        client.poll();
+    }
+
+    gateway.stop();
+    loop.join();
+
+    // An ACK without an ID can't be mapped, so it's reported as a reject
+    std::vector<std::string> expected = {
+        "nonsense REJ|PARSE", "ack 1 1", "reject 2 ACK|", "ack 3 2"
+    };
+    ASSERT_EQ(expected, listener.events);
+    ASSERT_EQ(0, client.get_outstanding());
+}
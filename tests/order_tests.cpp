@@ -3,6 +3,7 @@
 
 #include "gtest/gtest.h"
 #include "order.h"
+#include "orderbook.h"
 
 using namespace exchange;
 
@@ -42,15 +43,23 @@ TEST(OrderTest, price_order_respected) {
 
 TEST(OrderTest, time_order_respected) {
     Client bob("bob");
-    Order buy_early("ABC", 50.00, 2, BUY, bob);
+    Orderbook ob("ABC");
+
+    // Time priority is the order orders reach the book in, not the
+    //   order they were created in
     Order buy_later("ABC", 50.00, 2, BUY, bob);
+    Order buy_early("ABC", 50.00, 2, BUY, bob);
+    ob.submit_order(buy_early);
+    ob.submit_order(buy_later);
 
     // Early orders are more aggresive than late orders and should sort
     //   larger as a result.
     ASSERT_LT(buy_early, buy_later);
 
-    Order sell_early("ABC", 50.00, 2, SELL, bob);
-    Order sell_later("ABC", 50.00, 2, SELL, bob);
+    Order sell_later("ABC", 55.00, 2, SELL, bob);
+    Order sell_early("ABC", 55.00, 2, SELL, bob);
+    ob.submit_order(sell_early);
+    ob.submit_order(sell_later);
 
     ASSERT_LT(sell_early, sell_later);
 }
@@ -193,3 +202,67 @@ TEST(OrderTest, can_deserialize_orders) {
     ASSERT_STREQ("alice", o2->get_client().get_name().c_str());
 }
 
+
+TEST(OrderTest, can_serialize_execution_instructions) {
+    Client bob("bob");
+    Order o1("ABC", 10.00, 10, BUY, bob);
+    o1.set_time_in_force(IOC);
+    o1.set_type(MARKET);
+
+    std::string expected1 = "o|ABC|10.0000|10|BUY|bob|MKT,IOC";
+    ASSERT_STREQ(expected1.c_str(), Order::serialize(o1).c_str());
+
+    Order o2("ABC", 10.00, 10, SELL, bob);
+    o2.set_post_only(true);
+
+    std::string expected2 = "o|ABC|10.0000|10|SELL|bob|POST";
+    ASSERT_STREQ(expected2.c_str(), Order::serialize(o2).c_str());
+}
+
+TEST(OrderTest, can_deserialize_execution_instructions) {
+    bool result;
+    Order* o;
+
+    std::tie(o, result) = Order::deserialize("o|ABC|10.0000|10|BUY|bob|FOK");
+    ASSERT_TRUE(result);
+    ASSERT_STREQ("bob", o->get_client().get_name().c_str());
+    ASSERT_EQ(FOK, o->get_time_in_force());
+    ASSERT_EQ(LIMIT, o->get_type());
+    ASSERT_FALSE(o->is_post_only());
+
+    std::tie(o, result) = Order::deserialize("o|ABC|0|10|SELL|bob|MKT,IOC");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(IOC, o->get_time_in_force());
+    ASSERT_TRUE(o->is_market());
+
+    std::tie(o, result) = Order::deserialize("o|ABC|10.0000|10|SELL|bob|POST");
+    ASSERT_TRUE(result);
+    ASSERT_EQ(GTC, o->get_time_in_force());
+    ASSERT_TRUE(o->is_post_only());
+
+    std::tie(o, result) = Order::deserialize("o|ABC|10.0000|10|SELL|bob|XYZ");
+    ASSERT_FALSE(result);
+}
+
+TEST(OrderTest, can_serialize_stop_orders) {
+    Client bob("bob");
+    Order o("ABC", 0.00, 10, SELL, bob);
+    o.set_type(MARKET);
+    o.set_stop_price(95.5);
+
+    std::string expected = "o|ABC|0.0000|10|SELL|bob|MKT,STOP=95.5000";
+    ASSERT_STREQ(expected.c_str(), Order::serialize(o).c_str());
+
+    bool result;
+    Order* d;
+    std::tie(d, result) = Order::deserialize(expected);
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(d->is_market());
+    ASSERT_TRUE(d->is_stop());
+    ASSERT_EQ(95.5, d->get_stop_price());
+
+    std::tie(d, result) = Order::deserialize("o|ABC|10.0000|10|SELL|bob|STOP=abc");
+    ASSERT_FALSE(result);
+    std::tie(d, result) = Order::deserialize("o|ABC|10.0000|10|SELL|bob|STOP=-1");
+    ASSERT_FALSE(result);
+}
@@ -1,3 +1,5 @@
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "orderbook.h"
 
@@ -188,3 +190,466 @@ TEST(OrderbookTest, cant_match_filled_orders) {
     ASSERT_EQ(1, ob.get_trades()->size());
     ASSERT_EQ(UNFILLED, o3.get_status());
 }
+
+TEST(OrderbookTest, tracks_level_quantities) {
+    Client bob("bob");
+    Order o1("ABC", 100.00, 5, BUY, bob);
+    Order o2("ABC", 100.00, 7, BUY, bob);
+    Order o3("ABC", 99.00, 3, BUY, bob);
+    Orderbook ob("ABC");
+
+    ob.submit_order(o1);
+    ob.submit_order(o2);
+    ob.submit_order(o3);
+
+    ASSERT_EQ(12, ob.get_quantity_at(BUY, 100.00));
+    ASSERT_EQ(3, ob.get_quantity_at(BUY, 99.00));
+    ASSERT_EQ(0, ob.get_quantity_at(SELL, 100.00));
+
+    // Cancelling an order removes its quantity from the level
+    o2.cancel();
+    ASSERT_EQ(5, ob.get_quantity_at(BUY, 100.00));
+
+    // Fills reduce the level and empty levels disappear
+    Client alice("alice");
+    Order o4("ABC", 100.00, 5, SELL, alice);
+    ob.submit_order(o4);
+
+    ASSERT_EQ(0, ob.get_quantity_at(BUY, 100.00));
+    ASSERT_EQ(99.00, ob.get_best_bid());
+}
+
+TEST(OrderbookTest, ioc_remainder_is_cancelled) {
+    Client bob("bob");
+    Client alice("alice");
+    Order o1("ABC", 100.00, 5, SELL, alice);
+    Order o2("ABC", 100.00, 8, BUY, bob);
+    o2.set_time_in_force(IOC);
+    Orderbook ob("ABC");
+
+    ob.submit_order(o1);
+    ASSERT_TRUE(ob.submit_order(o2));
+
+    // The available 5 units trade and the remaining 3 do not rest
+    ASSERT_EQ(1, ob.get_trades()->size());
+    ASSERT_EQ(5, ob.get_trades()->at(0)->get_size());
+    ASSERT_EQ(CANCELLED, o2.get_status());
+    ASSERT_EQ(3, o2.effective_size());
+    ASSERT_EQ(nullptr, ob.get_best_buy());
+    ASSERT_EQ(0.0, ob.get_best_bid());
+}
+
+TEST(OrderbookTest, fok_fills_completely_or_not_at_all) {
+    Client bob("bob");
+    Client alice("alice");
+    Order o1("ABC", 100.00, 5, SELL, alice);
+    Order o2("ABC", 101.00, 5, SELL, alice);
+    Order o3("ABC", 102.00, 5, SELL, alice);
+    Orderbook ob("ABC");
+
+    ob.submit_order(o1);
+    ob.submit_order(o2);
+    ob.submit_order(o3);
+
+    // Only 10 units are available at or below 101.00
+    Order o4("ABC", 101.00, 11, BUY, bob);
+    o4.set_time_in_force(FOK);
+    ASSERT_TRUE(ob.submit_order(o4));
+
+    ASSERT_EQ(CANCELLED, o4.get_status());
+    ASSERT_EQ(0, ob.get_trades()->size());
+    ASSERT_EQ(5, ob.get_quantity_at(SELL, 100.00));
+
+    Order o5("ABC", 101.00, 10, BUY, bob);
+    o5.set_time_in_force(FOK);
+    ASSERT_TRUE(ob.submit_order(o5));
+
+    ASSERT_EQ(FILLED, o5.get_status());
+    ASSERT_EQ(2, ob.get_trades()->size());
+    ASSERT_EQ(102.00, ob.get_best_offer());
+}
+
+TEST(OrderbookTest, post_only_rejected_when_crossing) {
+    Client bob("bob");
+    Client alice("alice");
+    Order o1("ABC", 100.00, 5, SELL, alice);
+    Order o2("ABC", 100.00, 5, BUY, bob);
+    o2.set_post_only(true);
+    Order o3("ABC", 99.00, 5, BUY, bob);
+    o3.set_post_only(true);
+    Orderbook ob("ABC");
+
+    ob.submit_order(o1);
+
+    ASSERT_FALSE(ob.submit_order(o2));
+    ASSERT_EQ(REJECTED, o2.get_status());
+    ASSERT_EQ(0, ob.get_trades()->size());
+
+    // A post-only order that doesn't cross rests as normal
+    ASSERT_TRUE(ob.submit_order(o3));
+    ASSERT_EQ(99.00, ob.get_best_bid());
+}
+
+TEST(OrderbookTest, market_orders_sweep_levels) {
+    Client bob("bob");
+    Client alice("alice");
+    Order o1("ABC", 100.00, 5, SELL, alice);
+    Order o2("ABC", 105.00, 5, SELL, alice);
+    Order o3("ABC", 0.00, 12, BUY, bob);
+    o3.set_type(MARKET);
+    Orderbook ob("ABC");
+
+    ob.submit_order(o1);
+    ob.submit_order(o2);
+    ASSERT_TRUE(ob.submit_order(o3));
+
+    // Trades happen at each resting price regardless of the market order price
+    ASSERT_EQ(2, ob.get_trades()->size());
+    ASSERT_EQ(100.00, ob.get_trades()->at(0)->get_price());
+    ASSERT_EQ(105.00, ob.get_trades()->at(1)->get_price());
+
+    // The unfilled remainder of a market order never rests
+    ASSERT_EQ(CANCELLED, o3.get_status());
+    ASSERT_EQ(2, o3.effective_size());
+    ASSERT_EQ(0.0, ob.get_best_bid());
+}
+
+TEST(OrderbookTest, auction_collects_then_uncrosses) {
+    Client bob("bob");
+    Client alice("alice");
+    Order b1("ABC", 102.00, 10, BUY, bob);
+    Order b2("ABC", 101.00, 10, BUY, bob);
+    Order b3("ABC", 100.00, 10, BUY, bob);
+    Order s1("ABC", 99.00, 15, SELL, alice);
+    Order s2("ABC", 100.00, 10, SELL, alice);
+    Order s3("ABC", 101.00, 10, SELL, alice);
+    Orderbook ob("ABC");
+
+    ob.start_auction();
+    ASSERT_EQ(AUCTION, ob.get_phase());
+
+    for (Order* o : {&b1, &b2, &b3, &s1, &s2, &s3}) {
+        ASSERT_TRUE(ob.submit_order(*o));
+    }
+
+    // Nothing trades during the call even though the book is crossed
+    ASSERT_EQ(0, ob.get_trades()->size());
+    ASSERT_EQ(102.00, ob.get_best_bid());
+    ASSERT_EQ(99.00, ob.get_best_offer());
+
+    // 100.00 executes the most volume
+    std::pair<double, int> equilibrium = ob.get_equilibrium();
+    ASSERT_EQ(100.00, equilibrium.first);
+    ASSERT_EQ(25, equilibrium.second);
+
+    ASSERT_EQ(25, ob.uncross(CONTINUOUS));
+    ASSERT_EQ(CONTINUOUS, ob.get_phase());
+
+    // Every trade happens at the equilibrium price
+    int volume = 0;
+    for (auto t : *ob.get_trades()) {
+        ASSERT_EQ(100.00, t->get_price());
+        volume += t->get_size();
+    }
+    ASSERT_EQ(25, volume);
+
+    ASSERT_EQ(FILLED, b1.get_status());
+    ASSERT_EQ(FILLED, b2.get_status());
+    ASSERT_EQ(5, b3.effective_size());
+    ASSERT_EQ(FILLED, s1.get_status());
+    ASSERT_EQ(FILLED, s2.get_status());
+    ASSERT_EQ(UNFILLED, s3.get_status());
+
+    ASSERT_EQ(100.00, ob.get_best_bid());
+    ASSERT_EQ(101.00, ob.get_best_offer());
+    ASSERT_EQ(5, ob.get_quantity_at(BUY, 100.00));
+    ASSERT_EQ(&b3, ob.get_best_buy());
+
+    // The book matches continuously again after the uncross
+    Order s4("ABC", 100.00, 5, SELL, alice);
+    ob.submit_order(s4);
+    ASSERT_EQ(FILLED, s4.get_status());
+}
+
+TEST(OrderbookTest, auction_breaks_ties_by_imbalance) {
+    Client bob("bob");
+    Client alice("alice");
+    Order b1("ABC", 101.00, 10, BUY, bob);
+    Order b2("ABC", 100.00, 5, BUY, bob);
+    Order s1("ABC", 100.00, 10, SELL, alice);
+    Orderbook ob("ABC");
+
+    ob.start_auction();
+    ob.submit_order(b1);
+    ob.submit_order(b2);
+    ob.submit_order(s1);
+
+    // Both prices execute 10 but 101.00 leaves no imbalance
+    std::pair<double, int> equilibrium = ob.get_equilibrium();
+    ASSERT_EQ(101.00, equilibrium.first);
+    ASSERT_EQ(10, equilibrium.second);
+}
+
+TEST(OrderbookTest, auction_without_cross_executes_nothing) {
+    Client bob("bob");
+    Client alice("alice");
+    Order b1("ABC", 99.00, 10, BUY, bob);
+    Order s1("ABC", 100.00, 10, SELL, alice);
+    Orderbook ob("ABC");
+
+    ob.start_auction();
+    ob.submit_order(b1);
+    ob.submit_order(s1);
+
+    ASSERT_EQ(0, ob.uncross(CONTINUOUS));
+    ASSERT_EQ(0, ob.get_trades()->size());
+    ASSERT_EQ(99.00, ob.get_best_bid());
+}
+
+TEST(OrderbookTest, auction_and_closed_reject_orders) {
+    Client bob("bob");
+    Orderbook ob("ABC");
+
+    ob.start_auction();
+
+    Order o1("ABC", 100.00, 10, BUY, bob);
+    o1.set_time_in_force(IOC);
+    ASSERT_FALSE(ob.submit_order(o1));
+    ASSERT_EQ(REJECTED, o1.get_status());
+
+    Order o2("ABC", 100.00, 10, BUY, bob);
+    o2.set_type(MARKET);
+    ASSERT_FALSE(ob.submit_order(o2));
+
+    ob.uncross(CLOSED);
+    ASSERT_EQ(CLOSED, ob.get_phase());
+
+    Order o3("ABC", 100.00, 10, BUY, bob);
+    ASSERT_FALSE(ob.submit_order(o3));
+    ASSERT_EQ(REJECTED, o3.get_status());
+}
+
+TEST(OrderbookTest, stops_wait_until_triggered) {
+    Client bob("bob");
+    Client alice("alice");
+    Order s1("ABC", 0.00, 5, BUY, bob);
+    s1.set_type(MARKET);
+    s1.set_stop_price(101.00);
+    Order o1("ABC", 100.00, 5, SELL, alice);
+    Order o2("ABC", 100.00, 5, BUY, alice);
+    Order o3("ABC", 101.00, 10, SELL, alice);
+    Order o4("ABC", 101.00, 5, BUY, alice);
+    Orderbook ob("ABC");
+
+    ASSERT_TRUE(ob.submit_order(s1));
+    ASSERT_EQ(1, ob.get_stop_count());
+    ASSERT_EQ(0.0, ob.get_best_bid());
+
+    // A trade below the stop price leaves the stop waiting
+    ob.submit_order(o1);
+    ob.submit_order(o2);
+    ASSERT_EQ(1, ob.get_trades()->size());
+    ASSERT_EQ(UNFILLED, s1.get_status());
+
+    // A trade at the stop price triggers it as a market order
+    ob.submit_order(o3);
+    ob.submit_order(o4);
+    ASSERT_EQ(0, ob.get_stop_count());
+    ASSERT_EQ(3, ob.get_trades()->size());
+    ASSERT_TRUE(s1.is_triggered());
+    ASSERT_EQ(FILLED, s1.get_status());
+    ASSERT_EQ(0, ob.get_quantity_at(SELL, 101.00));
+}
+
+TEST(OrderbookTest, stop_limits_rest_once_triggered) {
+    Client bob("bob");
+    Client alice("alice");
+    Order s1("ABC", 98.00, 5, SELL, bob);
+    s1.set_stop_price(99.00);
+    Order o1("ABC", 99.00, 5, BUY, alice);
+    Order o2("ABC", 99.00, 5, SELL, alice);
+    Orderbook ob("ABC");
+
+    ob.submit_order(s1);
+    ob.submit_order(o1);
+    ob.submit_order(o2);
+
+    // Nothing is left to trade with, so the triggered stop limit rests
+    ASSERT_TRUE(s1.is_triggered());
+    ASSERT_EQ(98.00, ob.get_best_offer());
+    ASSERT_EQ(5, ob.get_quantity_at(SELL, 98.00));
+}
+
+TEST(OrderbookTest, stops_cascade_in_trigger_order) {
+    Client bob("bob");
+    Client alice("alice");
+
+    // Sell stops below the market, each of which trades down to the next
+    //     bid and triggers the stop below it
+    std::vector<Order> bids;
+    std::vector<Order> stops;
+    for (int i = 0; i < 5; i++) {
+        bids.emplace_back("ABC", 99.00 - i, 5, BUY, alice);
+        stops.emplace_back("ABC", 0.00, 5, SELL, bob);
+        stops.back().set_type(MARKET);
+        stops.back().set_stop_price(99.00 - i);
+    }
+    Order trigger("ABC", 99.00, 5, SELL, alice);
+    Orderbook ob("ABC");
+
+    // Stops are submitted out of price order to show they trigger in
+    //     stop price order
+    for (int i = 4; i >= 0; i--) {
+        ob.submit_order(stops[i]);
+    }
+    for (auto& o : bids) {
+        ob.submit_order(o);
+    }
+
+    ob.submit_order(trigger);
+
+    // The first trade at 99 only covers the trigger, the remaining bids
+    //     at 98 to 95 go to the first four stops
+    ASSERT_EQ(5, ob.get_trades()->size());
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQ(99.00 - i, ob.get_trades()->at(i)->get_price());
+    }
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(FILLED, stops[i].get_status());
+    }
+
+    // The last stop triggered at 95 but had nothing left to sell to
+    ASSERT_EQ(CANCELLED, stops[4].get_status());
+    ASSERT_EQ(0, ob.get_stop_count());
+}
+
+TEST(OrderbookTest, can_cancel_waiting_stop) {
+    Client bob("bob");
+    Client alice("alice");
+    Order s1("ABC", 0.00, 5, BUY, bob);
+    s1.set_type(MARKET);
+    s1.set_stop_price(100.00);
+    Order o1("ABC", 100.00, 5, SELL, alice);
+    Order o2("ABC", 100.00, 5, BUY, alice);
+    Orderbook ob("ABC");
+
+    ob.submit_order(s1);
+    s1.cancel();
+    ASSERT_EQ(0, ob.get_stop_count());
+
+    ob.submit_order(o1);
+    ob.submit_order(o2);
+    ASSERT_EQ(1, ob.get_trades()->size());
+    ASSERT_FALSE(s1.is_triggered());
+    ASSERT_EQ(CANCELLED, s1.get_status());
+}
+
+TEST(OrderbookTest, priority_follows_arrival_not_clock) {
+    Client bob("bob");
+    Client alice("alice");
+
+    // o2 is created first but reaches the book second
+    Order o2("ABC", 100.00, 5, SELL, alice);
+    Order o1("ABC", 100.00, 5, SELL, bob);
+    Order o3("ABC", 100.00, 5, BUY, alice);
+    Orderbook ob("ABC");
+
+    ob.submit_order(o1);
+    ob.submit_order(o2);
+    ASSERT_EQ(1, o1.get_sequence());
+    ASSERT_EQ(2, o2.get_sequence());
+    ASSERT_TRUE(o1 < o2);
+
+    ob.submit_order(o3);
+    ASSERT_EQ(FILLED, o1.get_status());
+    ASSERT_EQ(UNFILLED, o2.get_status());
+}
+
+TEST(OrderbookTest, checksum_matches_for_same_orders) {
+    Client bob("bob");
+    Client alice("alice");
+    Orderbook primary("ABC");
+    Orderbook replica("ABC");
+
+    std::vector<Order> first;
+    std::vector<Order> second;
+    for (int i = 0; i < 10; i++) {
+        first.emplace_back("ABC", 100.00 + (i % 4), 5 + i, (i % 3 == 0) ? BUY : SELL, (i % 2) ? bob : alice);
+    }
+    first[9].set_stop_price(90.00);
+    first[9].set_type(MARKET);
+    second = first;
+
+    for (auto& o : first) { primary.submit_order(o); }
+    for (auto& o : second) { replica.submit_order(o); }
+
+    ASSERT_EQ(primary.checksum(), replica.checksum());
+
+    // Any difference in the books changes it
+    Order extra("ABC", 90.00, 1, BUY, bob);
+    replica.submit_order(extra);
+    ASSERT_NE(primary.checksum(), replica.checksum());
+}
+
+TEST(OrderbookTest, ladder_books_match_like_tree_books) {
+    Client bob("bob");
+    Client alice("alice");
+
+    BookConfig config;
+    config.layout = LADDER_LAYOUT;
+    Orderbook tree("ABC");
+    Orderbook ladder("ABC", config);
+
+    std::vector<Order> first;
+    for (int i = 0; i < 40; i++) {
+        double price = 100.00 + ((i * 7) % 11 - 5) / 100.0;
+        first.emplace_back("ABC", price, 1 + i % 6, (i % 2) ? BUY : SELL, (i % 3) ? bob : alice);
+    }
+    std::vector<Order> second = first;
+
+    for (size_t i = 0; i < first.size(); i++) {
+        ASSERT_EQ(tree.submit_order(first[i]), ladder.submit_order(second[i]));
+    }
+
+    ASSERT_EQ(tree.get_trades()->size(), ladder.get_trades()->size());
+    ASSERT_EQ(tree.get_best_bid(), ladder.get_best_bid());
+    ASSERT_EQ(tree.get_best_offer(), ladder.get_best_offer());
+    ASSERT_EQ(tree.checksum(), ladder.checksum());
+
+    // Prices between ticks have no level on a ladder
+    Order between("ABC", 99.995, 1, BUY, bob);
+    ASSERT_FALSE(ladder.submit_order(between));
+    ASSERT_EQ(REJECTED, between.get_status());
+}
+
+TEST(OrderbookTest, ladder_books_reject_prices_beyond_their_span) {
+    Client bob("bob");
+
+    BookConfig config;
+    config.layout = LADDER_LAYOUT;
+    config.ladder_max_ticks = 4096;
+    Orderbook ladder("ABC", config);
+
+    Order near("ABC", 100.00, 10, BUY, bob);
+    ASSERT_TRUE(ladder.submit_order(near));
+
+    // Far enough away that a ladder reaching it would need billions of
+    //     ticks, so the book refuses it rather than allocating them
+    Order far("ABC", 10000000.00, 10, BUY, bob);
+    ASSERT_FALSE(ladder.submit_order(far));
+    ASSERT_EQ(REJECTED, far.get_status());
+
+    // Within the span of the levels already on the side is fine
+    Order within("ABC", 120.00, 10, BUY, bob);
+    ASSERT_TRUE(ladder.submit_order(within));
+    ASSERT_EQ(120.00, ladder.get_best_bid());
+    ASSERT_EQ(10, ladder.get_quantity_at(BUY, 100.00));
+
+    // Once the side is empty the ladder moves to the new price
+    near.cancel();
+    within.cancel();
+    Order moved("ABC", 10000000.00, 10, BUY, bob);
+    ASSERT_TRUE(ladder.submit_order(moved));
+    ASSERT_EQ(10000000.00, ladder.get_best_bid());
+    ASSERT_LE(ladder.get_memory_usage(), 1024 * 1024);
+}
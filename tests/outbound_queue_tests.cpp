@@ -0,0 +1,69 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "outbound_queue.h"
+
+using namespace exchange;
+
+TEST(OutboundQueueTest, batches_by_bytes) {
+    OutboundQueue q(10, DISCONNECT);
+
+    ASSERT_TRUE(q.push("aaaa"));
+    ASSERT_TRUE(q.push("bbbb"));
+    ASSERT_TRUE(q.push("cccc"));
+    ASSERT_EQ(3, q.depth());
+    ASSERT_EQ(12, q.get_bytes());
+
+    std::vector<std::string> batch;
+    ASSERT_EQ(2, q.pop_batch(batch, 8));
+    ASSERT_EQ("aaaa", batch[0]);
+    ASSERT_EQ("bbbb", batch[1]);
+    ASSERT_EQ(1, q.depth());
+    ASSERT_EQ(4, q.get_bytes());
+
+    // Nothing is taken when there is no room in the socket
+    ASSERT_EQ(0, q.pop_batch(batch, 0));
+
+    ASSERT_EQ(1, q.pop_batch(batch, 100));
+    ASSERT_EQ("cccc", batch[2]);
+    ASSERT_EQ(0, q.depth());
+    ASSERT_EQ(3, q.get_high_water());
+}
+
+TEST(OutboundQueueTest, drops_to_snapshot_when_full) {
+    OutboundQueue q(2, DROP_TO_SNAPSHOT);
+
+    ASSERT_TRUE(q.push("1"));
+    ASSERT_TRUE(q.push("2"));
+    ASSERT_FALSE(q.take_snapshot_request());
+
+    // The third message overflows the queue and everything is dropped
+    ASSERT_FALSE(q.push("3"));
+    ASSERT_EQ(0, q.depth());
+    ASSERT_EQ(3, q.get_dropped());
+    ASSERT_FALSE(q.is_disconnected());
+
+    // The snapshot is only requested once
+    ASSERT_TRUE(q.take_snapshot_request());
+    ASSERT_FALSE(q.take_snapshot_request());
+
+    ASSERT_TRUE(q.push("snapshot"));
+    ASSERT_EQ(1, q.depth());
+}
+
+TEST(OutboundQueueTest, disconnects_when_full) {
+    OutboundQueue q(2, DISCONNECT);
+
+    ASSERT_TRUE(q.push("1"));
+    ASSERT_TRUE(q.push("2"));
+    ASSERT_FALSE(q.push("3"));
+
+    ASSERT_TRUE(q.is_disconnected());
+    ASSERT_FALSE(q.take_snapshot_request());
+
+    // Nothing more is queued for a disconnected consumer
+    ASSERT_FALSE(q.push("4"));
+    ASSERT_EQ(0, q.depth());
+    ASSERT_EQ(4, q.get_dropped());
+}
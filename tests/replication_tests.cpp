@@ -0,0 +1,149 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "replication.h"
+
+using namespace exchange;
+
+static ReplicationEvent make_event(uint64_t sequence, const std::string& payload) {
+    ReplicationEvent e;
+    e.sequence = sequence;
+    e.time = 1000 * (int64_t) sequence;
+    e.payload = payload;
+    return e;
+}
+
+// Poll both ends until the subscriber has seen count events or gives up
+static void pump(ReplicationPublisher& publisher, ReplicationSubscriber& subscriber,
+                 std::vector<ReplicationEvent>& received, size_t count) {
+    for (int i = 0; i < 1000 && received.size() < count && subscriber.is_connected(); i++) {
+        publisher.poll();
+        subscriber.poll([&received](const ReplicationEvent& e) { received.push_back(e); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+TEST(ReplicationTest, encodes_events) {
+    ReplicationEvent e = make_event(7, "ABC|100|10|BUY|bob");
+
+    std::string frame = encode_event(e);
+    FrameDecoder decoder;
+    decoder.append(frame.data(), frame.size());
+
+    std::string payload;
+    ASSERT_TRUE(decoder.next(payload));
+
+    ReplicationEvent decoded;
+    ASSERT_TRUE(decode_event(payload, decoded));
+    ASSERT_EQ(7, decoded.sequence);
+    ASSERT_EQ(7000, decoded.time);
+    ASSERT_EQ("ABC|100|10|BUY|bob", decoded.payload);
+
+    ASSERT_FALSE(decode_event("short", decoded));
+}
+
+TEST(ReplicationTest, streams_events_in_sequence) {
+    ReplicationPublisher publisher;
+    ASSERT_TRUE(publisher.listen("127.0.0.1", 0));
+
+    // Events from before the standby connects are kept for it
+    ASSERT_TRUE(publisher.publish(make_event(1, "a")));
+    ASSERT_TRUE(publisher.publish(make_event(2, "b")));
+    ASSERT_FALSE(publisher.publish(make_event(4, "d")));
+
+    ReplicationSubscriber subscriber;
+    ASSERT_TRUE(subscriber.connect("127.0.0.1", publisher.get_port(), 1));
+
+    std::vector<ReplicationEvent> received;
+    pump(publisher, subscriber, received, 2);
+    ASSERT_TRUE(publisher.publish(make_event(3, "c")));
+    pump(publisher, subscriber, received, 3);
+
+    ASSERT_EQ(3, received.size());
+    ASSERT_EQ("a", received[0].payload);
+    ASSERT_EQ("c", received[2].payload);
+    ASSERT_EQ(4, subscriber.get_next_sequence());
+    ASSERT_EQ(1, publisher.get_standby_count());
+}
+
+TEST(ReplicationTest, resumes_from_requested_sequence) {
+    ReplicationPublisher publisher;
+    ASSERT_TRUE(publisher.listen("127.0.0.1", 0));
+    for (uint64_t s = 1; s <= 5; s++) {
+        publisher.publish(make_event(s, std::to_string(s)));
+    }
+
+    ReplicationSubscriber subscriber;
+    ASSERT_TRUE(subscriber.connect("127.0.0.1", publisher.get_port(), 4));
+
+    std::vector<ReplicationEvent> received;
+    pump(publisher, subscriber, received, 2);
+
+    ASSERT_EQ(2, received.size());
+    ASSERT_EQ(4, received[0].sequence);
+    ASSERT_EQ("5", received[1].payload);
+}
+
+TEST(ReplicationTest, drops_the_oldest_segments) {
+    // Segments are at least big enough for the largest frame, so a few
+    //     2 KB events fill each one
+    ReplicationPublisher publisher(0, 2);
+    ASSERT_TRUE(publisher.listen("127.0.0.1", 0));
+
+    std::string filler(2000, 'x');
+    uint64_t s = 0;
+    while (publisher.get_first_sequence() == 1) {
+        ASSERT_TRUE(publisher.publish(make_event(++s, filler)));
+    }
+    ASSERT_EQ(2, publisher.get_segment_count());
+    ASSERT_EQ(s, publisher.get_sequence());
+
+    // Events that have gone can't be sent
+    ReplicationSubscriber late;
+    ASSERT_TRUE(late.connect("127.0.0.1", publisher.get_port(), 1));
+    std::vector<ReplicationEvent> received;
+    pump(publisher, late, received, 1);
+    ASSERT_FALSE(late.is_connected());
+    ASSERT_TRUE(received.empty());
+
+    // Everything still kept is sent, across segments
+    uint64_t first = publisher.get_first_sequence();
+    ReplicationSubscriber subscriber;
+    ASSERT_TRUE(subscriber.connect("127.0.0.1", publisher.get_port(), first));
+    pump(publisher, subscriber, received, s - first + 1);
+    ASSERT_EQ(s - first + 1, received.size());
+    ASSERT_EQ(first, received.front().sequence);
+
+    // A standby that has everything keeps following as segments are dropped
+    uint64_t kept = s;
+    while (publisher.get_first_sequence() <= kept) {
+        ASSERT_TRUE(publisher.publish(make_event(++s, filler)));
+        pump(publisher, subscriber, received, s - first + 1);
+    }
+    ASSERT_TRUE(subscriber.is_connected());
+    ASSERT_EQ(s + 1, subscriber.get_next_sequence());
+}
+
+TEST(ReplicationTest, notices_primary_going_away) {
+    std::unique_ptr<ReplicationPublisher> publisher(new ReplicationPublisher());
+    ASSERT_TRUE(publisher->listen("127.0.0.1", 0));
+    publisher->publish(make_event(1, "a"));
+
+    ReplicationSubscriber subscriber;
+    ASSERT_TRUE(subscriber.connect("127.0.0.1", publisher->get_port(), 1));
+
+    std::vector<ReplicationEvent> received;
+    pump(*publisher, subscriber, received, 1);
+    ASSERT_EQ(1, received.size());
+
+    publisher.reset();
+    for (int i = 0; i < 1000 && subscriber.is_connected(); i++) {
+        subscriber.poll([&received](const ReplicationEvent& e) { received.push_back(e); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_FALSE(subscriber.is_connected());
+}
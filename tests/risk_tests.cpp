@@ -0,0 +1,144 @@
+#include <chrono>
+#include <limits>
+
+#include "gtest/gtest.h"
+#include "orderbook.h"
+#include "risk.h"
+
+using namespace exchange;
+
+const double NO_OFFER = std::numeric_limits<double>::max();
+
+TEST(RiskTest, no_limits_by_default) {
+    RiskChecker risk;
+    Client bob("bob");
+    Order o("ABC", 1000000.00, 1000000, BUY, bob);
+
+    Timestamp now = std::chrono::high_resolution_clock::now();
+    ASSERT_EQ(RISK_OK, risk.check(o, 100.00, 101.00, now));
+    ASSERT_EQ(1000000, risk.get_open_quantity("bob", BUY));
+}
+
+TEST(RiskTest, rejects_large_orders) {
+    RiskLimits limits;
+    limits.max_order_size = 100;
+    RiskChecker risk(limits);
+    Client bob("bob");
+
+    Timestamp now = std::chrono::high_resolution_clock::now();
+
+    Order o1("ABC", 100.00, 100, BUY, bob);
+    ASSERT_EQ(RISK_OK, risk.check(o1, 0.0, NO_OFFER, now));
+
+    Order o2("ABC", 100.00, 101, BUY, bob);
+    ASSERT_EQ(RISK_ORDER_SIZE, risk.check(o2, 0.0, NO_OFFER, now));
+
+    // Rejected orders don't count towards open quantity
+    ASSERT_EQ(100, risk.get_open_quantity("bob", BUY));
+}
+
+TEST(RiskTest, rejects_prices_outside_band) {
+    RiskLimits limits;
+    limits.price_band = 0.1;
+    RiskChecker risk(limits);
+    Client bob("bob");
+
+    Timestamp now = std::chrono::high_resolution_clock::now();
+
+    // With an empty book there is no reference price
+    Order o1("ABC", 500.00, 1, BUY, bob);
+    ASSERT_EQ(RISK_OK, risk.check(o1, 0.0, NO_OFFER, now));
+
+    // The mid price of 100.00 is the reference when both sides exist
+    Order o2("ABC", 109.00, 1, BUY, bob);
+    ASSERT_EQ(RISK_OK, risk.check(o2, 99.00, 101.00, now));
+
+    Order o3("ABC", 111.00, 1, BUY, bob);
+    ASSERT_EQ(RISK_PRICE_BAND, risk.check(o3, 99.00, 101.00, now));
+
+    Order o4("ABC", 89.00, 1, SELL, bob);
+    ASSERT_EQ(RISK_PRICE_BAND, risk.check(o4, 99.00, NO_OFFER, now));
+
+    // Market orders have no price to check
+    Order o5("ABC", 0.00, 1, SELL, bob);
+    o5.set_type(MARKET);
+    ASSERT_EQ(RISK_OK, risk.check(o5, 99.00, 101.00, now));
+}
+
+TEST(RiskTest, limits_open_quantity_per_side) {
+    RiskLimits limits;
+    limits.max_open_quantity = 10;
+    RiskChecker risk(limits);
+    Client bob("bob");
+
+    Timestamp now = std::chrono::high_resolution_clock::now();
+
+    Order o1("ABC", 100.00, 8, BUY, bob);
+    Order o2("ABC", 100.00, 3, BUY, bob);
+    Order o3("ABC", 100.00, 10, SELL, bob);
+
+    ASSERT_EQ(RISK_OK, risk.check(o1, 0.0, NO_OFFER, now));
+    ASSERT_EQ(RISK_OPEN_EXPOSURE, risk.check(o2, 0.0, NO_OFFER, now));
+    ASSERT_EQ(RISK_OK, risk.check(o3, 0.0, NO_OFFER, now));
+
+    // Closing the first order frees up its quantity
+    risk.on_order_closed(o1);
+    ASSERT_EQ(0, risk.get_open_quantity("bob", BUY));
+    ASSERT_EQ(RISK_OK, risk.check(o2, 0.0, NO_OFFER, now));
+}
+
+TEST(RiskTest, tracks_positions_from_trades) {
+    RiskLimits limits;
+    limits.max_position = 10;
+    RiskChecker risk(limits);
+    Client bob("bob");
+    Client alice("alice");
+
+    Order o1("ABC", 100.00, 6, SELL, alice);
+    Order o2("ABC", 100.00, 6, BUY, bob);
+    Orderbook ob("ABC");
+    ob.add_listener(&risk);
+
+    Timestamp now = std::chrono::high_resolution_clock::now();
+
+    ASSERT_EQ(RISK_OK, risk.check(o1, ob.get_best_bid(), ob.get_best_offer(), now));
+    ob.submit_order(o1);
+    ASSERT_EQ(RISK_OK, risk.check(o2, ob.get_best_bid(), ob.get_best_offer(), now));
+    ob.submit_order(o2);
+
+    ASSERT_EQ(6, risk.get_position("bob"));
+    ASSERT_EQ(-6, risk.get_position("alice"));
+
+    // Looking up a client that hasn't traded doesn't need to change anything
+    const RiskChecker& reader = risk;
+    ASSERT_EQ(0, reader.get_position("carol"));
+    ASSERT_EQ(0, reader.get_open_quantity("carol", SELL));
+    ASSERT_EQ(0, risk.get_open_quantity("bob", BUY));
+    ASSERT_EQ(0, risk.get_open_quantity("alice", SELL));
+
+    // Another 5 would take bob to a position of 11
+    Order o3("ABC", 100.00, 5, BUY, bob);
+    ASSERT_EQ(RISK_POSITION, risk.check(o3, ob.get_best_bid(), ob.get_best_offer(), now));
+
+    // Selling reduces the position so is allowed
+    Order o4("ABC", 100.00, 5, SELL, bob);
+    ASSERT_EQ(RISK_OK, risk.check(o4, ob.get_best_bid(), ob.get_best_offer(), now));
+}
+
+TEST(RiskTest, throttles_message_rate) {
+    RiskLimits limits;
+    limits.max_messages_per_second = 2;
+    RiskChecker risk(limits);
+    Client bob("bob");
+    Order o("ABC", 100.00, 1, BUY, bob);
+
+    Timestamp start = std::chrono::high_resolution_clock::now();
+
+    ASSERT_EQ(RISK_OK, risk.check(o, 0.0, NO_OFFER, start));
+    ASSERT_EQ(RISK_OK, risk.check(o, 0.0, NO_OFFER, start));
+    ASSERT_EQ(RISK_THROTTLED, risk.check(o, 0.0, NO_OFFER, start));
+
+    // A new window starts after a second
+    Timestamp later = start + std::chrono::seconds(1);
+    ASSERT_EQ(RISK_OK, risk.check(o, 0.0, NO_OFFER, later));
+}
@@ -0,0 +1,184 @@
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "shm_ring.h"
+
+using namespace exchange;
+
+static std::string read_message(ShmRing& ring, uint64_t sequence) {
+    const char* data;
+    size_t size;
+    if (ring.peek(sequence, &data, &size) != SHM_READY) {
+        return "";
+    }
+
+    return std::string(data, size);
+}
+
+TEST(ShmRingTest, routes_messages) {
+    std::string message = encode_routed(3, 42, "bbbo");
+    ASSERT_EQ(ROUTE_HEADER_SIZE + 4, message.size());
+
+    uint32_t gateway;
+    uint64_t session;
+    const char* payload;
+    size_t size;
+    ASSERT_TRUE(decode_routed(message.data(), message.size(), &gateway, &session, &payload, &size));
+    ASSERT_EQ(3, gateway);
+    ASSERT_EQ(42, session);
+    ASSERT_EQ("bbbo", std::string(payload, size));
+
+    ASSERT_FALSE(decode_routed(message.data(), 5, &gateway, &session, &payload, &size));
+}
+
+TEST(ShmRingTest, shares_messages_between_mappings) {
+    ShmRing writer;
+    ASSERT_TRUE(writer.create("localtrader_test_share", 4, 64, false));
+    ASSERT_EQ(4, writer.get_slot_count());
+    ASSERT_LE(64, writer.get_max_message_size());
+
+    // Another mapping of the same file, as another process would have
+    ShmRing reader;
+    ASSERT_TRUE(reader.open("localtrader_test_share"));
+    ASSERT_EQ(4, reader.get_slot_count());
+
+    const char* data;
+    size_t size;
+    ASSERT_EQ(SHM_EMPTY, reader.peek(1, &data, &size));
+
+    ASSERT_TRUE(writer.publish("first"));
+    ASSERT_TRUE(writer.publish("second"));
+    ASSERT_FALSE(writer.publish(std::string(writer.get_max_message_size() + 1, 'x')));
+
+    ASSERT_EQ(2, reader.get_last_sequence());
+    ASSERT_EQ("first", read_message(reader, 1));
+    ASSERT_EQ("second", read_message(reader, 2));
+    ASSERT_TRUE(reader.is_current(1));
+
+    writer.unlink();
+    ShmRing gone;
+    ASSERT_FALSE(gone.open("localtrader_test_share"));
+}
+
+TEST(ShmRingTest, ungated_readers_are_overrun) {
+    ShmRing ring;
+    ASSERT_TRUE(ring.create("localtrader_test_overrun", 4, 64, false));
+
+    for (int i = 1; i <= 6; i++) {
+        ASSERT_TRUE(ring.publish(std::to_string(i)));
+    }
+
+    const char* data;
+    size_t size;
+    ASSERT_EQ(SHM_OVERRUN, ring.peek(1, &data, &size));
+    ASSERT_FALSE(ring.is_current(2));
+    ASSERT_EQ("3", read_message(ring, 3));
+    ASSERT_EQ("6", read_message(ring, 6));
+
+    ring.unlink();
+}
+
+TEST(ShmRingTest, gated_ring_waits_for_release) {
+    ShmRing ring;
+    ASSERT_TRUE(ring.create("localtrader_test_gated", 4, 64, true));
+
+    for (int i = 1; i <= 4; i++) {
+        ASSERT_TRUE(ring.publish(std::to_string(i)));
+    }
+    ASSERT_FALSE(ring.publish("5"));
+
+    ASSERT_EQ("1", read_message(ring, 1));
+    ring.release(1);
+    ASSERT_TRUE(ring.publish("5"));
+    ASSERT_EQ("2", read_message(ring, 2));
+    ASSERT_EQ("5", read_message(ring, 5));
+
+    ring.unlink();
+}
+
+TEST(ShmRingTest, recovers_from_a_publisher_that_died) {
+    ShmRing ring;
+    ASSERT_TRUE(ring.create("localtrader_test_recover", 4, 64, true));
+    ASSERT_TRUE(ring.publish("1"));
+
+    // Claim the next slot behind the ring's back, as a publisher that died
+    //     before writing its message would have left it. The claimed
+    //     count is on the header's second cache line.
+    int fd = shm_open("/localtrader_test_recover", O_RDWR, 0);
+    ASSERT_LE(0, fd);
+    void* memory = mmap(nullptr, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_NE(MAP_FAILED, memory);
+    reinterpret_cast<std::atomic<uint64_t>*>(static_cast<char*>(memory) + 64)->fetch_add(1);
+    munmap(memory, 4096);
+
+    const char* data;
+    size_t size;
+    ASSERT_EQ(2, ring.get_last_sequence());
+    ASSERT_EQ(SHM_EMPTY, ring.peek(2, &data, &size));
+
+    // The publisher that takes over finishes it as an empty message
+    ShmRing publisher;
+    ASSERT_TRUE(publisher.open("localtrader_test_recover"));
+    publisher.recover();
+    ASSERT_EQ(SHM_READY, ring.peek(2, &data, &size));
+    ASSERT_EQ(0, size);
+
+    ASSERT_TRUE(publisher.publish("3"));
+    ASSERT_EQ("3", read_message(ring, 3));
+
+    // Finished messages are left alone
+    publisher.recover();
+    ASSERT_EQ("3", read_message(ring, 3));
+
+    ring.unlink();
+}
+
+TEST(ShmRingTest, sequences_many_publishers) {
+    ShmRing ring;
+    ASSERT_TRUE(ring.create("localtrader_test_publishers", 64, 32, true));
+
+    const int PUBLISHERS = 4;
+    const int MESSAGES = 10000;
+
+    std::vector<std::thread> publishers;
+    for (int p = 0; p < PUBLISHERS; p++) {
+        publishers.emplace_back([&ring, p]() {
+            for (int i = 0; i < MESSAGES; i++) {
+                std::string message = std::to_string(p) + ":" + std::to_string(i);
+                while (!ring.publish(message)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Every message arrives exactly once, in order for each publisher
+    std::vector<int> next(PUBLISHERS, 0);
+    std::set<std::string> seen;
+    for (uint64_t sequence = 1; sequence <= (uint64_t) PUBLISHERS * MESSAGES; sequence++) {
+        std::string message;
+        while ((message = read_message(ring, sequence)).empty()) {
+            std::this_thread::yield();
+        }
+        ring.release(sequence);
+
+        size_t colon = message.find(':');
+        int p = std::stoi(message.substr(0, colon));
+        ASSERT_EQ(next[p]++, std::stoi(message.substr(colon + 1)));
+        ASSERT_TRUE(seen.insert(message).second);
+    }
+
+    for (auto& t : publishers) {
+        t.join();
+    }
+    ring.unlink();
+}
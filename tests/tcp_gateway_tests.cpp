@@ -0,0 +1,229 @@
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "tcp_gateway.h"
+
+using namespace exchange;
+
+TEST(FrameDecoderTest, splits_frames) {
+    FrameDecoder decoder;
+    std::string payload;
+
+    std::string stream = encode_frame("bb") + encode_frame("o|ABC|100.0000|5|BUY|bob");
+    ASSERT_EQ(FRAME_HEADER_SIZE + 2, encode_frame("bb").size());
+
+    // Frames split across reads are put back together
+    decoder.append(stream.data(), 5);
+    ASSERT_FALSE(decoder.next(payload));
+
+    decoder.append(stream.data() + 5, stream.size() - 5);
+    ASSERT_TRUE(decoder.next(payload));
+    ASSERT_EQ("bb", payload);
+    ASSERT_TRUE(decoder.next(payload));
+    ASSERT_EQ("o|ABC|100.0000|5|BUY|bob", payload);
+    ASSERT_FALSE(decoder.next(payload));
+}
+
+TEST(FrameDecoderTest, refuses_oversized_frames) {
+    FrameDecoder decoder;
+    std::string payload;
+
+    std::string frame = encode_frame(std::string(MAX_FRAME_SIZE + 1, 'x'));
+    decoder.append(frame.data(), frame.size());
+
+    ASSERT_FALSE(decoder.next(payload));
+    ASSERT_TRUE(decoder.is_corrupt());
+    ASSERT_FALSE(decoder.append("more", 4));
+}
+
+std::string read_frame(int fd) {
+    FrameDecoder decoder;
+    std::string payload;
+    char data[256];
+
+    while (!decoder.next(payload)) {
+        ssize_t received = recv(fd, data, 1, 0);
+        if (received <= 0) {
+            return "";
+        }
+        decoder.append(data, received);
+    }
+
+    return payload;
+}
+
+void gateway_echo_test(bool busy_poll) {
+    TcpGateway* gateway_ptr = nullptr;
+    TcpGateway gateway([&gateway_ptr](uint64_t session, const std::string& payload) {
+        gateway_ptr->send(session, "ACK|" + payload);
+    }, busy_poll);
+    gateway_ptr = &gateway;
+
+    ASSERT_TRUE(gateway.listen("127.0.0.1", 0));
+    std::thread loop([&gateway]() { gateway.run(); });
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(gateway.get_port());
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    ASSERT_EQ(0, connect(fd, (sockaddr*) &address, sizeof(address)));
+
+    // Two frames in one write followed by a frame split over two writes
+    std::string first = encode_frame("one") + encode_frame("two");
+    std::string second = encode_frame("three");
+    ASSERT_EQ((ssize_t) first.size(), send(fd, first.data(), first.size(), 0));
+    ASSERT_EQ(3, send(fd, second.data(), 3, 0));
+    ASSERT_EQ((ssize_t) second.size() - 3, send(fd, second.data() + 3, second.size() - 3, 0));
+
+    ASSERT_EQ("ACK|one", read_frame(fd));
+    ASSERT_EQ("ACK|two", read_frame(fd));
+    ASSERT_EQ("ACK|three", read_frame(fd));
+
+    close(fd);
+    gateway.stop();
+    loop.join();
+}
+
+TEST(TcpGatewayTest, handles_sessions) {
+    gateway_echo_test(false);
+}
+
+TEST(TcpGatewayTest, handles_sessions_busy_polling) {
+    gateway_echo_test(true);
+}
+
+TEST(TcpGatewayTest, stops_before_running) {
+    TcpGateway gateway([](uint64_t, const std::string&) {}, false);
+    ASSERT_TRUE(gateway.listen("127.0.0.1", 0));
+
+    // Stopped before the thread gets going, so run() returns straight away
+    gateway.stop();
+    std::thread loop([&gateway]() { gateway.run(); });
+    loop.join();
+}
+
+TEST(TcpGatewayTest, writes_large_backlogs_in_order) {
+    const int REPLIES = 200;
+
+    TcpGateway* gateway_ptr = nullptr;
+    TcpGateway gateway([&gateway_ptr](uint64_t session, const std::string&) {
+        // More than the socket takes at once, so most of it goes out in
+        //     partial writes as the client reads
+        for (int r = 0; r < REPLIES; r++) {
+            gateway_ptr->send(session, std::to_string(r) + "|" + std::string(4000, 'a' + r % 26));
+        }
+    }, false);
+    gateway_ptr = &gateway;
+
+    ASSERT_TRUE(gateway.listen("127.0.0.1", 0));
+    std::thread loop([&gateway]() { gateway.run(); });
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(gateway.get_port());
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    ASSERT_EQ(0, connect(fd, (sockaddr*) &address, sizeof(address)));
+
+    std::string request = encode_frame("flood");
+    ASSERT_EQ((ssize_t) request.size(), send(fd, request.data(), request.size(), 0));
+
+    for (int r = 0; r < REPLIES; r++) {
+        ASSERT_EQ(std::to_string(r) + "|" + std::string(4000, 'a' + r % 26), read_frame(fd));
+    }
+
+    close(fd);
+    gateway.stop();
+    loop.join();
+
+    ASSERT_EQ(0, gateway.get_slow_disconnects());
+}
+
+TEST(TcpGatewayTest, disconnects_slow_sessions) {
+    const size_t MAX_WRITE_BUFFER = 64 * 1024;
+
+    TcpGateway* gateway_ptr = nullptr;
+    TcpGateway gateway([&gateway_ptr](uint64_t session, const std::string&) {
+        // All queued before the gateway writes any, so the cap is passed
+        //     however much the socket would take
+        for (int r = 0; r < 100; r++) {
+            gateway_ptr->send(session, std::string(4000, 'x'));
+        }
+    }, false, MAX_WRITE_BUFFER);
+    gateway_ptr = &gateway;
+
+    ASSERT_TRUE(gateway.listen("127.0.0.1", 0));
+    std::thread loop([&gateway]() { gateway.run(); });
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(gateway.get_port());
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    ASSERT_EQ(0, connect(fd, (sockaddr*) &address, sizeof(address)));
+
+    std::string request = encode_frame("flood");
+    ASSERT_EQ((ssize_t) request.size(), send(fd, request.data(), request.size(), 0));
+
+    // The gateway closes the session without sending anything
+    char data[256];
+    ASSERT_EQ(0, recv(fd, data, sizeof(data), 0));
+
+    close(fd);
+    gateway.stop();
+    loop.join();
+
+    ASSERT_EQ(1, gateway.get_slow_disconnects());
+    ASSERT_EQ(0u, gateway.get_session_count());
+}
+
+TEST(TcpGatewayTest, disconnects_sessions_when_replies_overflow) {
+    const size_t REPLY_QUEUE_SIZE = 4;
+
+    TcpGateway* gateway_ptr = nullptr;
+    TcpGateway gateway([&gateway_ptr](uint64_t session, const std::string&) {
+        // Sent from the gateway thread, so nothing drains the queue and
+        //     the sends past its size have to give up rather than wait
+        for (int r = 0; r < 10; r++) {
+            gateway_ptr->send(session, "FILL|" + std::to_string(r));
+        }
+    }, false, TCP_MAX_WRITE_BUFFER, REPLY_QUEUE_SIZE);
+    gateway_ptr = &gateway;
+
+    ASSERT_TRUE(gateway.listen("127.0.0.1", 0));
+    std::thread loop([&gateway]() { gateway.run(); });
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(gateway.get_port());
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    ASSERT_EQ(0, connect(fd, (sockaddr*) &address, sizeof(address)));
+
+    std::string request = encode_frame("flood");
+    ASSERT_EQ((ssize_t) request.size(), send(fd, request.data(), request.size(), 0));
+
+    // The session is closed rather than sent replies with a gap in them
+    char data[256];
+    ASSERT_EQ(0, recv(fd, data, sizeof(data), 0));
+
+    close(fd);
+    gateway.stop();
+    loop.join();
+
+    ASSERT_EQ(6, gateway.get_dropped_replies());
+    ASSERT_EQ(0, gateway.get_slow_disconnects());
+    ASSERT_EQ(0u, gateway.get_session_count());
+}
@@ -0,0 +1,53 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "thread_pool.h"
+
+using namespace exchange;
+
+TEST(ThreadPoolTest, runs_every_task) {
+    WorkStealingPool pool(4);
+    ASSERT_EQ(4, pool.get_thread_count());
+
+    std::atomic<int> sum{0};
+    for (int i = 1; i <= 100; i++) {
+        pool.submit([&sum, i]() { sum += i; });
+    }
+
+    pool.wait();
+    ASSERT_EQ(5050, sum.load());
+
+    // The pool takes more work once it has waited
+    pool.submit([&sum]() { sum += 1; });
+    pool.wait();
+    ASSERT_EQ(5051, sum.load());
+}
+
+TEST(ThreadPoolTest, steals_work_queued_behind_a_long_task) {
+    WorkStealingPool pool(2);
+
+    std::atomic<bool> release{false};
+    std::atomic<int> done{0};
+
+    // Half of the short tasks are queued behind the long one, so they only
+    //     finish while it runs if the other thread steals them
+    pool.submit([&release]() {
+        while (!release) { std::this_thread::yield(); }
+    });
+    for (int i = 0; i < 9; i++) {
+        pool.submit([&done]() { done++; });
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (done < 9 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+
+    ASSERT_EQ(9, done.load());
+    release = true;
+    pool.wait();
+
+    ASSERT_GT(pool.get_steals(), 0);
+}
@@ -0,0 +1,133 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "clock.h"
+#include "orderbook.h"
+#include "trade_export.h"
+
+using namespace exchange;
+
+static std::string export_path(const std::string& name) {
+    return "/tmp/localtrader_" + name + ".ltx";
+}
+
+TEST(TradeExportTest, trades_and_orders_read_back_as_written) {
+    std::string path = export_path("read_back");
+    VirtualClock clock(Timestamp(std::chrono::seconds(1000)));
+    Client alice("alice");
+    Client bob("bob");
+
+    // A small batch size so the rows span several blocks
+    TradeExporter exporter(3);
+    ASSERT_TRUE(exporter.open(path, true));
+
+    Orderbook ob("ABC");
+    ob.set_clock(&clock);
+    ob.add_listener(&exporter);
+
+    std::vector<Order*> orders;
+    for (int i = 0; i < 5; i++) {
+        orders.push_back(new Order("ABC", 100.00 + i * 0.01, 10, SELL, alice));
+        ob.submit_order(*orders.back());
+    }
+
+    clock.advance(std::chrono::microseconds(1500));
+    Order sweep("ABC", 100.03, 45, BUY, bob);
+    sweep.set_time_in_force(IOC);
+    ob.submit_order(sweep);
+
+    exporter.close();
+    ASSERT_EQ(5, exporter.get_rows_written());
+
+    std::vector<ExportedTrade> trades;
+    std::vector<ExportedOrder> closed;
+    ExportReader reader;
+    ASSERT_TRUE(reader.open(path));
+    while (reader.read_block(trades, closed)) {}
+
+    ASSERT_EQ(4, trades.size());
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ("ABC", trades[i].instrument);
+        ASSERT_DOUBLE_EQ(100.00 + i * 0.01, trades[i].price);
+        ASSERT_EQ(10, trades[i].size);
+        ASSERT_EQ(BUY, trades[i].side);
+        ASSERT_EQ("alice", trades[i].maker);
+        ASSERT_EQ("bob", trades[i].taker);
+        ASSERT_EQ(1000001500000LL, trades[i].time_ns);
+    }
+
+    // The remainder of the IOC
+    ASSERT_EQ(1, closed.size());
+    ASSERT_EQ("bob", closed[0].client);
+    ASSERT_DOUBLE_EQ(100.03, closed[0].price);
+    ASSERT_EQ(5, closed[0].size);
+    ASSERT_EQ(CANCELLED, closed[0].status);
+    ASSERT_EQ(sweep.get_sequence(), closed[0].sequence);
+
+    for (auto o : orders) { delete o; }
+    std::remove(path.c_str());
+}
+
+TEST(TradeExportTest, orders_are_left_out_unless_asked_for) {
+    std::string path = export_path("no_orders");
+    Client alice("alice");
+
+    TradeExporter exporter;
+    ASSERT_TRUE(exporter.open(path, false));
+
+    Orderbook ob("ABC");
+    ob.add_listener(&exporter);
+
+    Order o("ABC", 100.00, 10, SELL, alice);
+    o.set_time_in_force(IOC);
+    ob.submit_order(o);
+
+    exporter.close();
+    ASSERT_EQ(0, exporter.get_rows_written());
+
+    std::vector<ExportedTrade> trades;
+    std::vector<ExportedOrder> closed;
+    ExportReader reader;
+    ASSERT_TRUE(reader.open(path));
+    ASSERT_FALSE(reader.read_block(trades, closed));
+
+    std::remove(path.c_str());
+}
+
+TEST(TradeExportTest, repeated_values_encode_compactly) {
+    std::string path = export_path("compact");
+    Client alice("alice");
+    Client bob("bob");
+
+    TradeExporter exporter;
+    ASSERT_TRUE(exporter.open(path, false));
+
+    Timestamp time(std::chrono::seconds(1540176957));
+    for (int i = 0; i < 1000; i++) {
+        exporter.on_trade(Trade("ABC", 100.00 + (i % 3) * 0.01, 10, BUY, alice, bob,
+                                time + std::chrono::microseconds(i)));
+    }
+    exporter.close();
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    long size = file.tellg();
+
+    // Far less than the text each trade serializes to
+    ASSERT_LT(size, 10 * 1000);
+
+    std::vector<ExportedTrade> trades;
+    std::vector<ExportedOrder> closed;
+    ExportReader reader;
+    ASSERT_TRUE(reader.open(path));
+    while (reader.read_block(trades, closed)) {}
+
+    ASSERT_EQ(1000, trades.size());
+    ASSERT_DOUBLE_EQ(100.02, trades[998].price);
+    ASSERT_EQ(1540176957000999000LL, trades[999].time_ns);
+
+    std::remove(path.c_str());
+}